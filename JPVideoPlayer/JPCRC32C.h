@@ -0,0 +1,24 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Compute the CRC-32C (Castagnoli) checksum of given bytes.
+ * Use the CRC32 instructions on ARMv8 and SSE4.2 if available, fall back to a table driven implementation otherwise.
+ *
+ * @param crc    The checksum of previous bytes, pass 0 for the first bytes.
+ * @param bytes  The bytes.
+ * @param length The length of bytes.
+ *
+ * @return The checksum.
+ */
+FOUNDATION_EXTERN uint32_t JPCRC32CUpdate(uint32_t crc, const void *bytes, size_t length);
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPCRC32C.h"
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#elif defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+
+uint32_t JPCRC32CUpdate(uint32_t crc, const void *bytes, size_t length) {
+    const uint8_t *p = bytes;
+    crc = ~crc;
+    while (length && ((uintptr_t)p & 7)) {
+        crc = __crc32cb(crc, *p++);
+        length--;
+    }
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(uint64_t));
+        crc = __crc32cd(crc, word);
+        p += 8;
+        length -= 8;
+    }
+    while (length--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return ~crc;
+}
+
+#elif defined(__SSE4_2__)
+
+uint32_t JPCRC32CUpdate(uint32_t crc, const void *bytes, size_t length) {
+    const uint8_t *p = bytes;
+    uint64_t crc64 = (uint32_t)~crc;
+    while (length && ((uintptr_t)p & 7)) {
+        crc64 = _mm_crc32_u8((uint32_t)crc64, *p++);
+        length--;
+    }
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(uint64_t));
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        length -= 8;
+    }
+    while (length--) {
+        crc64 = _mm_crc32_u8((uint32_t)crc64, *p++);
+    }
+    return ~(uint32_t)crc64;
+}
+
+#else
+
+// slicing-by-8 tables of the reflected polynomial 0x82F63B78.
+static uint32_t JPCRC32CTable[8][256];
+
+static void JPCRC32CInitTable(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+        }
+        JPCRC32CTable[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = JPCRC32CTable[0][i];
+        for (int k = 1; k < 8; k++) {
+            crc = JPCRC32CTable[0][crc & 0xFF] ^ (crc >> 8);
+            JPCRC32CTable[k][i] = crc;
+        }
+    }
+}
+
+uint32_t JPCRC32CUpdate(uint32_t crc, const void *bytes, size_t length) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        JPCRC32CInitTable();
+    });
+
+    const uint8_t *p = bytes;
+    crc = ~crc;
+    while (length >= 8) {
+        uint32_t low, high;
+        memcpy(&low, p, sizeof(uint32_t));
+        memcpy(&high, p + 4, sizeof(uint32_t));
+        low = CFSwapInt32LittleToHost(low) ^ crc;
+        high = CFSwapInt32LittleToHost(high);
+        crc = JPCRC32CTable[7][low & 0xFF] ^ JPCRC32CTable[6][(low >> 8) & 0xFF] ^
+              JPCRC32CTable[5][(low >> 16) & 0xFF] ^ JPCRC32CTable[4][low >> 24] ^
+              JPCRC32CTable[3][high & 0xFF] ^ JPCRC32CTable[2][(high >> 8) & 0xFF] ^
+              JPCRC32CTable[1][(high >> 16) & 0xFF] ^ JPCRC32CTable[0][high >> 24];
+        p += 8;
+        length -= 8;
+    }
+    while (length--) {
+        crc = JPCRC32CTable[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#endif
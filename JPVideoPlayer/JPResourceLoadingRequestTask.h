@@ -14,6 +14,7 @@
 
 @class AVAssetResourceLoadingRequest,
        JPVideoPlayerCacheFile,
+       JPVideoPlayerDownloader,
        JPResourceLoadingRequestTask;
 
 NS_ASSUME_NONNULL_BEGIN
@@ -56,9 +57,14 @@ didCompleteWithError:(NSError *)error;
 @property (nonatomic, weak) id<JPResourceLoadingRequestTaskDelegate> delegate;
 
 /**
- * The loadingRequest passed in when this class initialize.
+ * The queue the delegate methods called on, main queue if nil.
  */
-@property (nonatomic, strong, readonly) AVAssetResourceLoadingRequest *loadingRequest;
+@property (nonatomic, strong, nullable) dispatch_queue_t delegateQueue;
+
+/**
+ * The loadingRequest passed in when this class initialize, nil for a read-ahead task which only store data to cache file.
+ */
+@property (nonatomic, strong, readonly, nullable) AVAssetResourceLoadingRequest *loadingRequest;
 
 /**
  * The range passed in when this class initialize.
@@ -99,7 +105,7 @@ didCompleteWithError:(NSError *)error;
  *
  * @return A instance of this class.
  */
-+ (instancetype)requestTaskWithLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest
++ (instancetype)requestTaskWithLoadingRequest:(AVAssetResourceLoadingRequest *_Nullable)loadingRequest
                                  requestRange:(NSRange)requestRange
                                     cacheFile:(JPVideoPlayerCacheFile *)cacheFile
                                     customURL:(NSURL *)customURL
@@ -116,7 +122,7 @@ didCompleteWithError:(NSError *)error;
  *
  * @return A instance of this class.
  */
-- (instancetype)initWithLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest
+- (instancetype)initWithLoadingRequest:(AVAssetResourceLoadingRequest *_Nullable)loadingRequest
                           requestRange:(NSRange)requestRange
                              cacheFile:(JPVideoPlayerCacheFile *)cacheFile
                              customURL:(NSURL *)customURL
@@ -146,7 +152,7 @@ didCompleteWithError:(NSError *)error;
 - (void)requestDidCompleteWithError:(NSError *_Nullable)error NS_REQUIRES_SUPER;
 
 /**
- * Begins the execution of the task, execute on main queue.
+ * Begins the execution of the task on current queue.
  */
 - (void)start NS_REQUIRES_SUPER;
 
@@ -166,10 +172,67 @@ didCompleteWithError:(NSError *)error;
 
 @interface JPResourceLoadingRequestLocalTask: JPResourceLoadingRequestTask
 
+/**
+ * Fill the content information of loading request with the response headers stored in cache file.
+ *
+ * @param loadingRequest The loadingRequest from `AVPlayer`.
+ * @param requestRange   The range the loading request asked.
+ * @param cacheFile      The cache file which stored the response headers.
+ *
+ * @return NO if the cache file have no response headers.
+ */
++ (BOOL)fillContentInformationOfLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest
+                                  requestRange:(NSRange)requestRange
+                                     cacheFile:(JPVideoPlayerCacheFile *)cacheFile;
+
+/**
+ * The size of the first piece of data read from cache file and responded [defaults to 32 KB].
+ * The following pieces grow to `maximumReadChunkSize`, so the first bytes arrive quickly and a large range
+ * takes less read and respond calls.
+ */
+@property (nonatomic, assign) NSUInteger minimumReadChunkSize;
+
+/**
+ * The maximum size of a piece of data read from cache file and responded [defaults to 1 MB].
+ */
+@property (nonatomic, assign) NSUInteger maximumReadChunkSize;
+
 @end
 
 @interface JPResourceLoadingRequestWebTask: JPResourceLoadingRequestTask
 
+/**
+ * Convenience method to fetch a read-ahead task, which download given range into cache file at low priority
+ * and respond nothing.
+ *
+ * @param requestRange The range need request from web.
+ * @param cacheFile    The cache file take responsibility for save video data to disk and read cached video from disk.
+ * @param customURL    The url custom passed in.
+ *
+ * @return A instance of this class.
+ */
++ (instancetype)readAheadTaskWithRequestRange:(NSRange)requestRange
+                                    cacheFile:(JPVideoPlayerCacheFile *)cacheFile
+                                    customURL:(NSURL *)customURL;
+
+/**
+ * The priority class of the download [defaults to `JPVideoPlayerDownloadPriorityPlaying`].
+ * The downloader start the data task when the class have a free slot. Must set before the task start.
+ */
+@property (assign, nonatomic) JPVideoPlayerDownloadPriority downloadPriority;
+
+/**
+ * A flag represent the task download for the resource loader itself instead of a loading request, such as a read-ahead task.
+ * An internal task is cancelled often, its completion is not reported to the delegate of downloader and no download
+ * notification is posted for it.
+ */
+@property (assign, nonatomic, getter=isInternal) BOOL internal;
+
+/**
+ * The downloader schedule the data task of this task, the data task is resumed at once if nil.
+ */
+@property (weak, nonatomic, nullable) JPVideoPlayerDownloader *downloader;
+
 /**
  * The operation's task.
  */
@@ -192,6 +255,59 @@ didCompleteWithError:(NSError *)error;
  */
 @property (weak, nonatomic, nullable) NSURLSession *unownedSession;
 
+/**
+ * A flag represent the task is started ahead of the tasks before it in the same loading request,
+ * the received data is stored to cache file and staged in memory instead of responding to the loading request.
+ * The staged data in memory is limited, the data task is suspended when reach the limit until `stopStagingResponse`,
+ * a task receive data from `sourceTask` stop receiving and fail with the shared download stopped error instead.
+ * Must set before the task start.
+ */
+@property (assign, nonatomic) BOOL stagesResponse;
+
+/**
+ * The web task of other loading request already downloading the range of this task. If set, this task receive
+ * the data from it instead of opening a new connection. Must set before the task start.
+ */
+@property (strong, nonatomic, nullable) JPResourceLoadingRequestWebTask *sourceTask;
+
+/**
+ * The offset of the next byte this task will receive.
+ */
+@property (assign, nonatomic, readonly) NSUInteger currentOffset;
+
+/**
+ * The length of data received from `sourceTask`.
+ */
+@property (assign, nonatomic, readonly) NSUInteger sharedDataLength;
+
+/**
+ * The offset this task download to, `NSUIntegerMax` for a request to the end of file.
+ * A detached task stop at the end of its byte budget.
+ */
+@property (assign, nonatomic, readonly) NSUInteger endOffset;
+
+/**
+ * A flag represent the loading request of this task is cancelled, but the task keep downloading into cache file.
+ */
+@property (assign, nonatomic, readonly, getter=isDetached) BOOL detached;
+
+/**
+ * Stop responding to the loading request, but keep the connection and store the data still arriving into cache file,
+ * at the priority of prefetch, until the byte budget is used up or the duration passed. The task is internal from now.
+ *
+ * @param byteBudget The maximum length of data to download from the current offset.
+ * @param duration   The task is cancelled after this duration, in seconds.
+ *
+ * @return NO if the task have no connection to keep, such as not resumed yet or receive data from other task.
+ */
+- (BOOL)detachWithByteBudget:(NSUInteger)byteBudget
+                    duration:(NSTimeInterval)duration;
+
+/**
+ * Respond the staged data to the loading request, then respond the data received after this as usual.
+ */
+- (void)stopStagingResponse;
+
 @end
 
 NS_ASSUME_NONNULL_END
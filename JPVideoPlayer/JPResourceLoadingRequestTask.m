@@ -12,6 +12,7 @@
 #import "JPResourceLoadingRequestTask.h"
 #import "JPVideoPlayerCacheFile.h"
 #import "JPVideoPlayerSupportUtils.h"
+#import "JPVideoPlayerDownloader.h"
 #import <pthread.h>
 #import "JPVideoPlayerCompat.h"
 
@@ -27,8 +28,11 @@
 
 @end
 
-static NSUInteger kJPVideoPlayerFileReadBufferSize = 1024 * 32;
+static const NSUInteger kJPVideoPlayerMinimumReadChunkSize = 1024 * 32;
+static const NSUInteger kJPVideoPlayerMaximumReadChunkSize = 1024 * 1024;
 static const NSString *const kJPVideoPlayerContentRangeKey = @"Content-Range";
+// the staged task stop receiving data when staged this much in memory, until the tasks before it finished.
+static const NSUInteger kJPVideoPlayerMaximumStagedDataLength = 1024 * 1024 * 4;
 @implementation JPResourceLoadingRequestTask
 
 - (void)dealloc {
@@ -49,7 +53,7 @@ static const NSString *const kJPVideoPlayerContentRangeKey = @"Content-Range";
                              cacheFile:(JPVideoPlayerCacheFile *)cacheFile
                              customURL:(NSURL *)customURL
                                 cached:(BOOL)cached {
-    if(!loadingRequest || !JPValidByteRange(requestRange) || !cacheFile || !customURL){
+    if(!JPValidByteRange(requestRange) || !cacheFile || !customURL){
         return nil;
     }
 
@@ -93,13 +97,20 @@ static const NSString *const kJPVideoPlayerContentRangeKey = @"Content-Range";
 }
 
 - (void)requestDidCompleteWithError:(NSError *_Nullable)error {
-    JPDispatchSyncOnMainQueue(^{
+    dispatch_block_t completion = ^{
         self.executing = NO;
         self.finished = YES;
         if (self.delegate && [self.delegate respondsToSelector:@selector(requestTask:didCompleteWithError:)]) {
             [self.delegate requestTask:self didCompleteWithError:error];
         }
-    });
+    };
+    if (!self.delegateQueue) {
+        JPDispatchSyncOnMainQueue(completion);
+        return;
+    }
+
+    // do not wait, the task maybe complete on the delegate queue.
+    JPDispatchAsyncOnQueue(self.delegateQueue, completion);
 }
 
 - (void)start {
@@ -192,6 +203,8 @@ static const NSString *const kJPVideoPlayerContentRangeKey = @"Content-Range";
         pthread_mutexattr_init(&mutexattr);
         pthread_mutexattr_settype(&mutexattr, PTHREAD_MUTEX_RECURSIVE);
         pthread_mutex_init(&_plock, &mutexattr);
+        _minimumReadChunkSize = kJPVideoPlayerMinimumReadChunkSize;
+        _maximumReadChunkSize = kJPVideoPlayerMaximumReadChunkSize;
         if(cacheFile.responseHeaders && !loadingRequest.contentInformationRequest.contentType){
             [self fillContentInformation];
         }
@@ -222,47 +235,83 @@ static const NSString *const kJPVideoPlayerContentRangeKey = @"Content-Range";
     // task fetch data from disk.
     int lock = pthread_mutex_trylock(&_plock);
     NSUInteger offset = self.requestRange.location;
+    // respond the first bytes in a small piece to start playing quickly, then double the piece for every read.
+    NSUInteger maximumChunkSize = MAX(self.maximumReadChunkSize, 1);
+    NSUInteger chunkSize = MIN(MAX(self.minimumReadChunkSize, 1), maximumChunkSize);
+    NSError *error = nil;
     while (offset < NSMaxRange(self.requestRange)) {
         if ([self isCancelled]) {
             break;
         }
         @autoreleasepool {
-            NSRange range = NSMakeRange(offset, MIN(NSMaxRange(self.requestRange) - offset, kJPVideoPlayerFileReadBufferSize));
+            NSRange range = NSMakeRange(offset, MIN(NSMaxRange(self.requestRange) - offset, chunkSize));
+            chunkSize = MIN(chunkSize * 2, maximumChunkSize);
             NSData *data = [self.cacheFile dataWithRange:range];
+            if (!data.length) {
+                error = [self errorForUnreadableDataAtOffset:offset];
+                break;
+            }
             [self.loadingRequest.dataRequest respondWithData:data];
-            offset = NSMaxRange(range);
+            // the data maybe shorter than the range if a corrupt block evicted.
+            offset += data.length;
         }
     }
     JPDebugLog(@"完成本地请求");
     if (!lock) {
         pthread_mutex_unlock(&_plock);
     }
-    [self requestDidCompleteWithError:nil];
+    [self requestDidCompleteWithError:error];
+}
+
+- (NSError *)errorForUnreadableDataAtOffset:(NSUInteger)offset {
+    if (JPValidFileRange([self.cacheFile cachedRangeContainsPosition:offset])) {
+        return JPErrorWithDescription(@"Read cached video data failed");
+    }
+
+    // the data is not cached anymore, the resource loader fetch it from web again.
+    return [NSError errorWithDomain:JPVideoPlayerErrorDomain
+                               code:JPVideoPlayerErrorCodeCachedDataInvalidated
+                           userInfo:@{
+                                   NSLocalizedDescriptionKey : @"The cached video data is invalidated"
+                           }];
 }
 
 - (void)fillContentInformation {
     int lock = pthread_mutex_trylock(&_plock);
-    NSMutableDictionary *responseHeaders = [self.cacheFile.responseHeaders mutableCopy];
+    [self.class fillContentInformationOfLoadingRequest:self.loadingRequest
+                                          requestRange:self.requestRange
+                                             cacheFile:self.cacheFile];
+    if (!lock) {
+        pthread_mutex_unlock(&_plock);
+    }
+}
+
++ (BOOL)fillContentInformationOfLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest
+                                  requestRange:(NSRange)requestRange
+                                     cacheFile:(JPVideoPlayerCacheFile *)cacheFile {
+    NSMutableDictionary *responseHeaders = [cacheFile.responseHeaders mutableCopy];
+    if (!responseHeaders) {
+        return NO;
+    }
+
     BOOL supportRange = responseHeaders[kJPVideoPlayerContentRangeKey] != nil;
-    if (supportRange && JPValidByteRange(self.requestRange)) {
-        NSUInteger fileLength = [self.cacheFile fileLength];
-        NSString *contentRange = [NSString stringWithFormat:@"bytes %tu-%tu/%tu", self.requestRange.location, fileLength, fileLength];
+    if (supportRange && JPValidByteRange(requestRange)) {
+        NSUInteger fileLength = [cacheFile fileLength];
+        NSString *contentRange = [NSString stringWithFormat:@"bytes %tu-%tu/%tu", requestRange.location, fileLength, fileLength];
         responseHeaders[kJPVideoPlayerContentRangeKey] = contentRange;
     }
     else {
         [responseHeaders removeObjectForKey:kJPVideoPlayerContentRangeKey];
     }
-    NSUInteger contentLength = self.requestRange.length != NSUIntegerMax ? self.requestRange.length : self.cacheFile.fileLength - self.requestRange.location;
+    NSUInteger contentLength = requestRange.length != NSUIntegerMax ? requestRange.length : cacheFile.fileLength - requestRange.location;
     responseHeaders[@"Content-Length"] = [NSString stringWithFormat:@"%tu", contentLength];
     NSInteger statusCode = supportRange ? 206 : 200;
-    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.loadingRequest.request.URL
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:loadingRequest.request.URL
                                                               statusCode:statusCode
                                                              HTTPVersion:@"HTTP/1.1"
                                                             headerFields:responseHeaders];
-    [self.loadingRequest jp_fillContentInformationWithResponse:response];
-    if (!lock) {
-        pthread_mutex_unlock(&_plock);
-    }
+    [loadingRequest jp_fillContentInformationWithResponse:response];
+    return YES;
 }
 
 @end
@@ -279,6 +328,42 @@ static const NSString *const kJPVideoPlayerContentRangeKey = @"Content-Range";
 
 @property(nonatomic, assign) BOOL haveDataSaved;
 
+@property (nonatomic, strong) NSMutableData *stagedData;
+
+/**
+ * A flag represent the data task is suspended because the staged data reach the limit.
+ */
+@property (nonatomic, assign) BOOL stagingSuspended;
+
+/**
+ * The error of a staged task which can not fetch its range, such as the server ignore the range header.
+ */
+@property (nonatomic, strong) NSError *stagingError;
+
+/**
+ * The error of an internal task which can not store its data to cache file.
+ */
+@property (nonatomic, strong) NSError *storeError;
+
+/**
+ * The web tasks receiving data from this task.
+ */
+@property (nonatomic, strong) NSMutableArray<JPResourceLoadingRequestWebTask *> *subscribers;
+
+/**
+ * A flag represent this task completed, no web task can subscribe it anymore.
+ */
+@property (nonatomic, assign) BOOL subscribersClosed;
+
+@property (nonatomic, assign) NSUInteger sharedDataLength;
+
+@property (nonatomic, assign) BOOL detached;
+
+/**
+ * The offset a detached task stop downloading at.
+ */
+@property (nonatomic, assign) NSUInteger detachedEndOffset;
+
 @property (nonatomic) pthread_mutex_t plock;
 
 @end
@@ -308,15 +393,29 @@ static const NSString *const kJPVideoPlayerContentRangeKey = @"Content-Range";
         _haveDataSaved = NO;
         _offset = requestRange.location;
         _requestLength = requestRange.length;
+        _subscribers = [@[] mutableCopy];
+        _downloadPriority = JPVideoPlayerDownloadPriorityPlaying;
     }
     return self;
 }
 
++ (instancetype)readAheadTaskWithRequestRange:(NSRange)requestRange
+                                    cacheFile:(JPVideoPlayerCacheFile *)cacheFile
+                                    customURL:(NSURL *)customURL {
+    JPResourceLoadingRequestWebTask *requestTask = [[self alloc] initWithLoadingRequest:nil
+                                                                           requestRange:requestRange
+                                                                              cacheFile:cacheFile
+                                                                              customURL:customURL
+                                                                                 cached:NO];
+    // staging cancel the task if the server ignore the range header, and no loading request to respond.
+    requestTask.stagesResponse = YES;
+    requestTask.downloadPriority = JPVideoPlayerDownloadPriorityReadAhead;
+    return requestTask;
+}
+
 - (void)start {
     [super start];
-    JPDispatchSyncOnMainQueue(^{
-        [self internalStart];
-    });
+    [self internalStart];
 }
 
 - (void)startOnQueue:(dispatch_queue_t)queue {
@@ -333,13 +432,19 @@ static const NSString *const kJPVideoPlayerContentRangeKey = @"Content-Range";
     
     [super cancel];
     [self synchronizeCacheFileIfNeeded];
+    if (self.sourceTask) {
+        [self.sourceTask removeSubscriber:self];
+    }
+    [self closeSubscribers];
     if (self.dataTask) {
         // cancel web request.
         JPDebugLog(@"取消了一个网络请求, id 是: %d", self.dataTask.taskIdentifier);
         [self.dataTask cancel];
-        JPDispatchSyncOnMainQueue(^{
-            [[NSNotificationCenter defaultCenter] postNotificationName:JPVideoPlayerDownloadStopNotification object:self];
-        });
+        if (!self.isInternal) {
+            JPDispatchAsyncOnMainQueue(^{
+                [[NSNotificationCenter defaultCenter] postNotificationName:JPVideoPlayerDownloadStopNotification object:self];
+            });
+        }
     }
 }
 
@@ -348,6 +453,17 @@ static const NSString *const kJPVideoPlayerContentRangeKey = @"Content-Range";
 }
 
 - (void)internalStart {
+    if (self.sourceTask) {
+        // task receive data from the download of other loading request.
+        if ([self isCancelled]) {
+            [self requestDidCompleteWithError:nil];
+        }
+        else if (![self.sourceTask addSubscriber:self]) {
+            [self requestDidCompleteWithError:[self sharedDownloadStoppedError]];
+        }
+        return;
+    }
+
     // task request data from web.
     if(!self.unownedSession || !self.request){
         [self requestDidCompleteWithError:JPErrorWithDescription(@"unownedSession or request can not be nil")];
@@ -376,10 +492,19 @@ static const NSString *const kJPVideoPlayerContentRangeKey = @"Content-Range";
     
     NSURLSession *session = self.unownedSession;
     self.dataTask = [session dataTaskWithRequest:self.request];
+    self.dataTask.webTask = self;
     JPDebugLog(@"开始网络请求, 网络请求创建一个 dataTask, id 是: %d", self.dataTask.taskIdentifier);
-    [self.dataTask resume];
-    if (self.dataTask) {
-        [[NSNotificationCenter defaultCenter] postNotificationName:JPVideoPlayerDownloadStartNotification object:self];
+    JPVideoPlayerDownloader *downloader = self.downloader;
+    if (downloader) {
+        [downloader scheduleRequestTask:self];
+    }
+    else {
+        [self.dataTask resume];
+    }
+    if (self.dataTask && !self.isInternal) {
+        JPDispatchAsyncOnMainQueue(^{
+            [[NSNotificationCenter defaultCenter] postNotificationName:JPVideoPlayerDownloadStartNotification object:self];
+        });
     }
     
     if (self.backgroundTaskId != UIBackgroundTaskInvalid) {
@@ -390,9 +515,27 @@ static const NSString *const kJPVideoPlayerContentRangeKey = @"Content-Range";
 }
 
 - (void)requestDidReceiveResponse:(NSURLResponse *)response {
+    if (self.isDetached) {
+        // the data must start at the request range to be stored at the right offset.
+        if (![response isKindOfClass:[NSHTTPURLResponse class]] || ![(NSHTTPURLResponse *)response jp_supportRange]) {
+            [self.dataTask cancel];
+        }
+        return;
+    }
+    if (self.stagesResponse) {
+        // the staged data must start at the request range, a full body response is useless.
+        if (![response isKindOfClass:[NSHTTPURLResponse class]] || ![(NSHTTPURLResponse *)response jp_supportRange]) {
+            self.stagingError = JPErrorWithDescription(@"The server do not support range request");
+            [self.dataTask cancel];
+        }
+        return;
+    }
     if ([response isKindOfClass:[NSHTTPURLResponse class]] && !self.loadingRequest.contentInformationRequest.contentType) {
         NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-        [self.cacheFile storeResponse:httpResponse];
+        // every web task receive a response of the same video, store it once, storing it rewrite the whole index file.
+        if (!self.cacheFile.responseHeaders || !self.cacheFile.isFileLengthValid) {
+            [self.cacheFile storeResponse:httpResponse];
+        }
         [self.loadingRequest jp_fillContentInformationWithResponse:httpResponse];
         if (![(NSHTTPURLResponse *)response jp_supportRange]) {
             self.offset = 0;
@@ -402,15 +545,36 @@ static const NSString *const kJPVideoPlayerContentRangeKey = @"Content-Range";
 
 - (void)requestDidReceiveData:(NSData *)data
              storedCompletion:(dispatch_block_t)completion {
-    if (data.bytes) {
+    if (data.bytes && !self.stagingError) {
+        __weak __typeof__ (self) wself = self;
         [self.cacheFile storeVideoData:data
                               atOffset:self.offset
                            synchronize:NO
-                      storedCompletion:completion];
-        int lock = pthread_mutex_trylock(&_plock);
+                      storedCompletion:^(NSError *error) {
+                          if (error) {
+                              [wself cacheFileDidFailToStoreDataWithError:error];
+                          }
+                          if (completion) {
+                              completion();
+                          }
+                      }];
+        // take the lock for sure, `stopStagingResponse` on other thread must not interleave with this.
+        pthread_mutex_lock(&_plock);
         self.haveDataSaved = YES;
+        NSUInteger dataOffset = self.offset;
         self.offset += [data length];
-        [self.loadingRequest.dataRequest respondWithData:data];
+        [self respondData:data];
+        BOOL budgetUsedUp = self.detached && self.offset >= self.detachedEndOffset;
+        NSMutableArray<JPResourceLoadingRequestWebTask *> *finishedSubscribers = nil;
+        for (JPResourceLoadingRequestWebTask *subscriber in [self.subscribers copy]) {
+            if ([subscriber sourceTaskDidReceiveData:data atOffset:dataOffset]) {
+                [self.subscribers removeObject:subscriber];
+                if (!finishedSubscribers) {
+                    finishedSubscribers = [@[] mutableCopy];
+                }
+                [finishedSubscribers addObject:subscriber];
+            }
+        }
 
         static BOOL _needLog = YES;
         if(_needLog) {
@@ -420,15 +584,223 @@ static const NSString *const kJPVideoPlayerContentRangeKey = @"Content-Range";
                 _needLog = YES;
             });
         }
-        if (!lock) {
-            pthread_mutex_unlock(&_plock);
+        pthread_mutex_unlock(&_plock);
+        // complete out of the lock, the completion wait for main queue which maybe waiting for the lock.
+        for (JPResourceLoadingRequestWebTask *subscriber in finishedSubscribers) {
+            [subscriber requestDidCompleteWithError:nil];
+        }
+        if (budgetUsedUp) {
+            JPDebugLog(@"后台填充用完了字节预算, 取消网络请求, id 是: %d", self.dataTask.taskIdentifier);
+            [self.dataTask cancel];
         }
     }
 }
 
 - (void)requestDidCompleteWithError:(NSError *_Nullable)error {
     [self synchronizeCacheFileIfNeeded];
-    [super requestDidCompleteWithError:error];
+    [self closeSubscribers];
+    // report the staging error instead of the cancel error, the staged task cancel itself when the staging failed.
+    [super requestDidCompleteWithError:self.stagingError ?: self.storeError ?: error];
+}
+
+- (void)stopStagingResponse {
+    pthread_mutex_lock(&_plock);
+    if (self.stagesResponse) {
+        self.stagesResponse = NO;
+        if (self.stagedData.length) {
+            [self.loadingRequest.dataRequest respondWithData:self.stagedData];
+        }
+        self.stagedData = nil;
+        [self resumeStagingIfNeed];
+    }
+    pthread_mutex_unlock(&_plock);
+}
+
+- (NSUInteger)currentOffset {
+    pthread_mutex_lock(&_plock);
+    NSUInteger offset = self.offset;
+    pthread_mutex_unlock(&_plock);
+    return offset;
+}
+
+- (NSUInteger)endOffset {
+    pthread_mutex_lock(&_plock);
+    NSUInteger endOffset = self.requestLength == NSUIntegerMax ? NSUIntegerMax : NSMaxRange(self.requestRange);
+    if (self.detached) {
+        endOffset = MIN(endOffset, self.detachedEndOffset);
+    }
+    pthread_mutex_unlock(&_plock);
+    return endOffset;
+}
+
+- (BOOL)detachWithByteBudget:(NSUInteger)byteBudget
+                    duration:(NSTimeInterval)duration {
+    pthread_mutex_lock(&_plock);
+    BOOL detached = byteBudget > 0 && duration > 0 && !self.sourceTask && !self.stagingError;
+    detached = detached && self.dataTask.state == NSURLSessionTaskStateRunning;
+    detached = detached && !self.detached && !self.isCancelled && !self.isFinished;
+    if (detached) {
+        self.detached = YES;
+        self.stagedData = nil;
+        [self resumeStagingIfNeed];
+        self.detachedEndOffset = byteBudget > NSUIntegerMax - self.offset ? NSUIntegerMax : self.offset + byteBudget;
+        // the downloader count it as a prefetch from now, and the player do not wait for it anymore.
+        self.downloadPriority = JPVideoPlayerDownloadPriorityPrefetch;
+        self.internal = YES;
+        self.dataTask.priority = NSURLSessionTaskPriorityLow;
+        JPDebugLog(@"网络请求转为后台填充, id 是: %d, offset: %ld, 字节预算: %ld", self.dataTask.taskIdentifier, self.offset, byteBudget);
+    }
+    pthread_mutex_unlock(&_plock);
+    if (!detached) {
+        return NO;
+    }
+
+    // the download of the loading request stop here, the following cancel of the internal task post nothing.
+    JPDispatchAsyncOnMainQueue(^{
+        [[NSNotificationCenter defaultCenter] postNotificationName:JPVideoPlayerDownloadStopNotification object:self];
+    });
+
+    __weak __typeof__ (self) wself = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t) (duration * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        __strong __typeof (wself) sself = wself;
+        if (sself && !sself.isFinished) {
+            JPDebugLog(@"后台填充超时, 取消网络请求");
+            [sself cancel];
+        }
+    });
+    return YES;
+}
+
+
+#pragma mark - Private
+
+/**
+ * Respond data to the loading request, or stage it if this task start ahead, must call in lock.
+ */
+- (void)respondData:(NSData *)data {
+    if (!self.loadingRequest || self.detached) {
+        // the read-ahead task and the detached task only store data to cache file.
+        return;
+    }
+    if (self.stagesResponse) {
+        if (!self.stagedData) {
+            self.stagedData = [NSMutableData dataWithCapacity:MIN(self.requestLength, 1024 * 1024)];
+        }
+        [self.stagedData appendData:data];
+        if (self.stagedData.length >= kJPVideoPlayerMaximumStagedDataLength && self.dataTask && !self.stagingSuspended) {
+            // backpressure, the data arriving while the data task suspending is kept by the session, it is a bit over the limit.
+            JPDebugLog(@"暂存的数据达到上限, 暂停网络请求, id 是: %d", self.dataTask.taskIdentifier);
+            self.stagingSuspended = YES;
+            [self.dataTask suspend];
+        }
+    }
+    else {
+        [self.loadingRequest.dataRequest respondWithData:data];
+    }
+}
+
+/**
+ * Resume the data task suspended by the limit of staged data, must call in lock.
+ */
+- (void)resumeStagingIfNeed {
+    if (!self.stagingSuspended) {
+        return;
+    }
+
+    JPDebugLog(@"暂存的数据已经响应, 恢复网络请求, id 是: %d", self.dataTask.taskIdentifier);
+    self.stagingSuspended = NO;
+    [self.dataTask resume];
+}
+
+/**
+ * Subscribe the download of this task, the subscriber receive the data of its range when this task receive it.
+ *
+ * @param subscriber A web task whose range is inside the range this task not received yet.
+ *
+ * @return NO if this task completed or already passed the start of subscriber.
+ */
+- (BOOL)addSubscriber:(JPResourceLoadingRequestWebTask *)subscriber {
+    pthread_mutex_lock(&_plock);
+    NSRange range = subscriber.requestRange;
+    BOOL insideRange = NSMaxRange(range) <= self.endOffset;
+    BOOL added = !self.subscribersClosed && !self.isCancelled && !self.stagingError && self.offset <= range.location && insideRange;
+    if (added) {
+        [self.subscribers addObject:subscriber];
+        JPDebugLog(@"网络请求订阅了一个正在进行的下载, 数据范围是: %@, 下载的 offset: %ld", NSStringFromRange(range), self.offset);
+    }
+    pthread_mutex_unlock(&_plock);
+    return added;
+}
+
+/**
+ * The download stopped, the subscribers not received all data must fetch the rest by themselves.
+ */
+- (void)closeSubscribers {
+    pthread_mutex_lock(&_plock);
+    self.subscribersClosed = YES;
+    NSArray<JPResourceLoadingRequestWebTask *> *subscribers = [self.subscribers copy];
+    [self.subscribers removeAllObjects];
+    pthread_mutex_unlock(&_plock);
+    for (JPResourceLoadingRequestWebTask *subscriber in subscribers) {
+        [subscriber requestDidCompleteWithError:[subscriber sharedDownloadStoppedError]];
+    }
+}
+
+- (void)removeSubscriber:(JPResourceLoadingRequestWebTask *)subscriber {
+    pthread_mutex_lock(&_plock);
+    [self.subscribers removeObject:subscriber];
+    pthread_mutex_unlock(&_plock);
+}
+
+/**
+ * Receive the data downloaded by `sourceTask`, only the part inside the request range is responded.
+ *
+ * @return YES if received all data of the request range.
+ */
+- (BOOL)sourceTaskDidReceiveData:(NSData *)data
+                        atOffset:(NSUInteger)offset {
+    pthread_mutex_lock(&_plock);
+    NSUInteger end = NSMaxRange(self.requestRange);
+    BOOL finished = NO;
+    if (!self.isCancelled && !self.stagingError && offset <= self.offset && self.offset < offset + data.length && self.offset < end) {
+        if (self.stagesResponse && self.stagedData.length >= kJPVideoPlayerMaximumStagedDataLength) {
+            // can not suspend the download of other task, stop receiving here, the rest is stored to cache file
+            // by the source task, and the loading request plan it again when this task become the first one.
+            JPDebugLog(@"共享下载暂存的数据达到上限, 停止接收数据, offset: %ld", self.offset);
+            self.stagedData = nil;
+            self.stagingError = [self sharedDownloadStoppedError];
+            pthread_mutex_unlock(&_plock);
+            return YES;
+        }
+
+        NSUInteger length = MIN(offset + data.length, end) - self.offset;
+        [self respondData:[data subdataWithRange:NSMakeRange(self.offset - offset, length)]];
+        self.offset += length;
+        self.sharedDataLength += length;
+        finished = self.offset >= end;
+    }
+    pthread_mutex_unlock(&_plock);
+    return finished;
+}
+
+- (NSError *)sharedDownloadStoppedError {
+    return [NSError errorWithDomain:JPVideoPlayerErrorDomain
+                               code:JPVideoPlayerErrorCodeSharedDownloadStopped
+                           userInfo:@{
+                                   NSLocalizedDescriptionKey : @"The shared download stopped"
+                           }];
+}
+
+/**
+ * The player still receive the data of a loading request, but an internal task only store data to cache file,
+ * so it stop when the cache file can not store.
+ */
+- (void)cacheFileDidFailToStoreDataWithError:(NSError *)error {
+    JPDebugLog(@"存储视频数据失败, error 是: %@", error);
+    if (self.isInternal && !self.storeError) {
+        self.storeError = error;
+        [self.dataTask cancel];
+    }
 }
 
 - (void)synchronizeCacheFileIfNeeded {
@@ -25,12 +25,15 @@ NS_ASSUME_NONNULL_BEGIN
 @required
 /**
  * This method will be called when the current instance receive new loading request.
+ * Note this method is called on the private queue of resource loader, do not read the player state in it.
  *
- * @param videoPlayer The current `JPVideoPlayer`.
- * @prama requestTask A abstract instance packageing the loading request.
+ * @param videoPlayer   The current `JPVideoPlayer`.
+ * @prama requestTask   A abstract instance packageing the loading request.
+ * @param playerOptions The options the video is played with.
  */
 - (void)videoPlayer:(JPVideoPlayer *)videoPlayer
-didReceiveLoadingRequestTask:(JPResourceLoadingRequestWebTask *)requestTask;
+didReceiveLoadingRequestTask:(JPResourceLoadingRequestWebTask *)requestTask
+      playerOptions:(JPVideoPlayerOptions)playerOptions;
 
 @optional
 /**
@@ -123,6 +123,7 @@ static NSString *JPVideoPlayerURL = @"www.newpan.com";
     [self.player removeObserver:self.videoPlayer forKeyPath:@"rate"];
 
     // remove player
+    self.resourceLoader.readAheadPaused = YES;
     [self.player pause];
     [self.player cancelPendingPrerolls];
     self.player = nil;
@@ -234,10 +235,13 @@ static NSString *JPVideoPlayerURL = @"www.newpan.com";
     // Make the `resourceLoader` become the delegate of 'videoURLAsset', and provide data to the player.
     JPVideoPlayerResourceLoader *resourceLoader = [JPVideoPlayerResourceLoader resourceLoaderWithCustomURL:url];
     resourceLoader.delegate = self;
+    resourceLoader.parallelDownloadEnabled = (options & JPVideoPlayerParallelDownload) != 0;
+    resourceLoader.playerOptions = options;
     
     // url instead of `[self composeFakeVideoURL]`, otherwise some urls can not play normally
     AVURLAsset *videoURLAsset = [AVURLAsset URLAssetWithURL:[self composeFakeVideoURL] options:nil];
-    [videoURLAsset.resourceLoader setDelegate:resourceLoader queue:dispatch_get_main_queue()];
+    // handle the loading requests off main queue, do not compete with scrolling.
+    [videoURLAsset.resourceLoader setDelegate:resourceLoader queue:resourceLoader.delegateQueue];
     AVPlayerItem *playerItem = [AVPlayerItem playerItemWithAsset:videoURLAsset];
     [self removePlayerItemDidPlayToEndObserver];
     [self addPlayerItemDidPlayToEndObserver:playerItem];
@@ -415,8 +419,10 @@ static NSString *JPVideoPlayerURL = @"www.newpan.com";
 
 - (void)resourceLoader:(JPVideoPlayerResourceLoader *)resourceLoader
 didReceiveLoadingRequestTask:(JPResourceLoadingRequestWebTask *)requestTask {
-    if (self.delegate && [self.delegate respondsToSelector:@selector(videoPlayer:didReceiveLoadingRequestTask:)]) {
-        [self.delegate videoPlayer:self didReceiveLoadingRequestTask:requestTask];
+    if (self.delegate && [self.delegate respondsToSelector:@selector(videoPlayer:didReceiveLoadingRequestTask:playerOptions:)]) {
+        [self.delegate videoPlayer:self
+      didReceiveLoadingRequestTask:requestTask
+                     playerOptions:resourceLoader.playerOptions];
     }
 }
 
@@ -560,6 +566,8 @@ didReceiveLoadingRequestTask:(JPResourceLoadingRequestWebTask *)requestTask {
 
 - (void)internalPauseWithNeedCallDelegate:(BOOL)needCallDelegate {
     [self.playerModel pause];
+    // do not download ahead for a paused video.
+    self.playerModel.resourceLoader.readAheadPaused = YES;
     self.playerStatus = JPVideoPlayerStatusPause;
     if(needCallDelegate){
         [self invokePlayerStatusDidChangeDelegateMethod];
@@ -568,6 +576,7 @@ didReceiveLoadingRequestTask:(JPResourceLoadingRequestWebTask *)requestTask {
 
 - (void)internalResumeWithNeedCallDelegate:(BOOL)needCallDelegate {
     [self.playerModel resume];
+    self.playerModel.resourceLoader.readAheadPaused = NO;
     self.playerStatus = JPVideoPlayerStatusPlaying;
     if(needCallDelegate){
         [self invokePlayerStatusDidChangeDelegateMethod];
@@ -610,6 +619,9 @@ didReceiveLoadingRequestTask:(JPResourceLoadingRequestWebTask *)requestTask {
         double totalSeconds = CMTimeGetSeconds(sItem.playerItem.duration);
         sself.playerModel.elapsedSeconds = elapsedSeconds;
         sself.playerModel.totalSeconds = totalSeconds;
+        if (totalSeconds > 0 && !isnan(totalSeconds) && sself.playerModel.resourceLoader.videoDuration != totalSeconds) {
+            sself.playerModel.resourceLoader.videoDuration = totalSeconds;
+        }
         if(totalSeconds == 0 || isnan(totalSeconds) || elapsedSeconds > totalSeconds) return;
 
         if (!sself.seekingToTime) {
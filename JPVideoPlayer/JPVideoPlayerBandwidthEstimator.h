@@ -0,0 +1,153 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A snapshot of the network measured by `JPVideoPlayerBandwidthEstimator`, for one host or for all hosts.
+ * The averages are exponentially weighted, the percentiles are computed over the latest samples.
+ */
+@interface JPVideoPlayerBandwidthEstimate : NSObject
+
+/**
+ * The host measured, nil for the estimate of all hosts.
+ */
+@property (nonatomic, copy, readonly, nullable) NSString *host;
+
+/**
+ * The number of throughput samples measured.
+ */
+@property (nonatomic, assign, readonly) NSUInteger throughputSampleCount;
+
+/**
+ * The exponentially weighted average of throughput, in bytes per second, 0 if not measured.
+ */
+@property (nonatomic, assign, readonly) double throughput;
+
+/**
+ * The exponentially weighted average of the time from sending a request to receiving its response, in seconds,
+ * 0 if not measured.
+ */
+@property (nonatomic, assign, readonly) NSTimeInterval timeToFirstByte;
+
+/**
+ * The exponentially weighted average of the round trip time of new connections, in seconds, 0 if not measured.
+ */
+@property (nonatomic, assign, readonly) NSTimeInterval roundTripTime;
+
+/**
+ * Fetch the throughput at given percentile of the latest samples.
+ *
+ * @param percentile A value between 0 and 1, such as 0.1 for a conservative estimate.
+ *
+ * @return The throughput in bytes per second, 0 if not measured.
+ */
+- (double)throughputAtPercentile:(double)percentile;
+
+/**
+ * Fetch the time to first byte at given percentile of the latest samples.
+ *
+ * @param percentile A value between 0 and 1.
+ *
+ * @return The time to first byte in seconds, 0 if not measured.
+ */
+- (NSTimeInterval)timeToFirstByteAtPercentile:(double)percentile;
+
+/**
+ * Fetch the round trip time at given percentile of the latest samples.
+ *
+ * @param percentile A value between 0 and 1.
+ *
+ * @return The round trip time in seconds, 0 if not measured.
+ */
+- (NSTimeInterval)roundTripTimeAtPercentile:(double)percentile;
+
+@end
+
+/**
+ * Measure the throughput, time to first byte and round trip time of the downloads, for every host and for all hosts.
+ * The throughput is the bytes received over the time at least one download of the host is receiving data,
+ * so the concurrent downloads are measured as a whole, and the idle time between downloads is not counted.
+ * This class is thread safe.
+ */
+@interface JPVideoPlayerBandwidthEstimator : NSObject
+
+/**
+ * Fetch the estimate of all hosts.
+ *
+ * @return A snapshot of the estimate.
+ */
+- (JPVideoPlayerBandwidthEstimate *)estimate;
+
+/**
+ * Fetch the estimate of given host.
+ *
+ * @param host A host, such as `www.example.com`.
+ *
+ * @return A snapshot of the estimate, nil if nothing downloaded from the host.
+ */
+- (JPVideoPlayerBandwidthEstimate *_Nullable)estimateForHost:(NSString *)host;
+
+/**
+ * A download of given host start receiving data, call it when receive the response.
+ *
+ * @param host The host of the download.
+ */
+- (void)transferDidStartForHost:(NSString *)host;
+
+/**
+ * A download of given host received data.
+ *
+ * @param length The length of the data.
+ * @param host   The host of the download.
+ *
+ * @return YES if a new throughput sample is measured.
+ */
+- (BOOL)transferDidReceiveDataWithLength:(NSUInteger)length
+                                 forHost:(NSString *)host;
+
+/**
+ * A download of given host completed or cancelled, must pair with `transferDidStartForHost:`.
+ *
+ * @param host The host of the download.
+ *
+ * @return YES if a new throughput sample is measured.
+ */
+- (BOOL)transferDidEndForHost:(NSString *)host;
+
+/**
+ * Record the time from sending a request to receiving its response.
+ *
+ * @param timeToFirstByte The time in seconds.
+ * @param host            The host of the request.
+ */
+- (void)recordTimeToFirstByte:(NSTimeInterval)timeToFirstByte
+                      forHost:(NSString *)host;
+
+/**
+ * Record the round trip time, such as the duration of the TCP handshake of a new connection.
+ *
+ * @param roundTripTime The time in seconds.
+ * @param host          The host of the connection.
+ */
+- (void)recordRoundTripTime:(NSTimeInterval)roundTripTime
+                    forHost:(NSString *)host;
+
+/**
+ * Remove all measured samples.
+ */
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
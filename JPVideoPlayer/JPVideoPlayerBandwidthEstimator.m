@@ -0,0 +1,305 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerBandwidthEstimator.h"
+#import <pthread.h>
+
+// the number of latest samples the percentiles computed over.
+#define kJPVideoPlayerBandwidthWindowSize 32
+// the weight of a new sample in the average.
+static const double kJPVideoPlayerBandwidthSmoothingFactor = 0.25;
+// a throughput sample cover this length and duration at least, the short bursts are not representative.
+static const NSUInteger kJPVideoPlayerBandwidthSampleMinLength = 128 * 1024;
+static const CFAbsoluteTime kJPVideoPlayerBandwidthSampleMinDuration = 0.2;
+// the tail of a transfer is sampled if longer than this.
+static const NSUInteger kJPVideoPlayerBandwidthTailSampleMinLength = 32 * 1024;
+
+/**
+ * The latest samples in a ring buffer, with the exponentially weighted average of all samples.
+ */
+typedef struct {
+    double values[kJPVideoPlayerBandwidthWindowSize];
+    NSUInteger count;
+    NSUInteger next;
+    NSUInteger total;
+    double average;
+} JPBandwidthSampleWindow;
+
+static void JPBandwidthSampleWindowAdd(JPBandwidthSampleWindow *window, double value) {
+    window->values[window->next] = value;
+    window->next = (window->next + 1) % kJPVideoPlayerBandwidthWindowSize;
+    window->count = MIN(window->count + 1, kJPVideoPlayerBandwidthWindowSize);
+    window->average = window->total ? window->average + kJPVideoPlayerBandwidthSmoothingFactor * (value - window->average) : value;
+    window->total += 1;
+}
+
+static NSArray<NSNumber *> *JPBandwidthSampleWindowSortedValues(const JPBandwidthSampleWindow *window) {
+    NSMutableArray<NSNumber *> *values = [NSMutableArray arrayWithCapacity:window->count];
+    for (NSUInteger i = 0; i < window->count; i++) {
+        [values addObject:@(window->values[i])];
+    }
+    [values sortUsingSelector:@selector(compare:)];
+    return [values copy];
+}
+
+/**
+ * Fetch the value at given percentile, interpolated between the closest ranks.
+ */
+static double JPBandwidthPercentile(NSArray<NSNumber *> *sortedValues, double percentile) {
+    if (!sortedValues.count) {
+        return 0;
+    }
+
+    double rank = MAX(MIN(percentile, 1), 0) * (sortedValues.count - 1);
+    NSUInteger lower = (NSUInteger)floor(rank);
+    NSUInteger upper = MIN(lower + 1, sortedValues.count - 1);
+    double lowerValue = sortedValues[lower].doubleValue;
+    return lowerValue + (sortedValues[upper].doubleValue - lowerValue) * (rank - lower);
+}
+
+@interface JPVideoPlayerBandwidthEstimate()
+
+@property (nonatomic, copy, nullable) NSString *host;
+
+@property (nonatomic, assign) NSUInteger throughputSampleCount;
+
+@property (nonatomic, assign) double throughput;
+
+@property (nonatomic, assign) NSTimeInterval timeToFirstByte;
+
+@property (nonatomic, assign) NSTimeInterval roundTripTime;
+
+@property (nonatomic, strong) NSArray<NSNumber *> *throughputs;
+
+@property (nonatomic, strong) NSArray<NSNumber *> *timesToFirstByte;
+
+@property (nonatomic, strong) NSArray<NSNumber *> *roundTripTimes;
+
+@end
+
+@implementation JPVideoPlayerBandwidthEstimate
+
+- (double)throughputAtPercentile:(double)percentile {
+    return JPBandwidthPercentile(self.throughputs, percentile);
+}
+
+- (NSTimeInterval)timeToFirstByteAtPercentile:(double)percentile {
+    return JPBandwidthPercentile(self.timesToFirstByte, percentile);
+}
+
+- (NSTimeInterval)roundTripTimeAtPercentile:(double)percentile {
+    return JPBandwidthPercentile(self.roundTripTimes, percentile);
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p, host: %@, throughput: %.0f bytes/s, ttfb: %.3fs, rtt: %.3fs>",
+                    NSStringFromClass(self.class), self, self.host, self.throughput, self.timeToFirstByte, self.roundTripTime];
+}
+
+@end
+
+/**
+ * The samples of one host, or of all hosts.
+ */
+@interface JPVideoPlayerBandwidthRecord : NSObject
+
+@end
+
+@implementation JPVideoPlayerBandwidthRecord {
+    NSUInteger _transferCount;
+    CFAbsoluteTime _sampleStartTime;
+    NSUInteger _sampleLength;
+    JPBandwidthSampleWindow _throughputs;
+    JPBandwidthSampleWindow _timesToFirstByte;
+    JPBandwidthSampleWindow _roundTripTimes;
+}
+
+- (void)transferDidStart {
+    if (_transferCount == 0) {
+        _sampleStartTime = CFAbsoluteTimeGetCurrent();
+        _sampleLength = 0;
+    }
+    _transferCount += 1;
+}
+
+- (BOOL)transferDidReceiveDataWithLength:(NSUInteger)length {
+    if (_transferCount == 0) {
+        return NO;
+    }
+
+    _sampleLength += length;
+    return [self sampleThroughputIfNeedWithMinLength:kJPVideoPlayerBandwidthSampleMinLength];
+}
+
+- (BOOL)transferDidEnd {
+    if (_transferCount == 0) {
+        return NO;
+    }
+
+    _transferCount -= 1;
+    if (_transferCount > 0) {
+        return NO;
+    }
+
+    // the link is idle from now, the time until next transfer must not count.
+    BOOL sampled = [self sampleThroughputIfNeedWithMinLength:kJPVideoPlayerBandwidthTailSampleMinLength];
+    _sampleLength = 0;
+    return sampled;
+}
+
+- (BOOL)sampleThroughputIfNeedWithMinLength:(NSUInteger)minLength {
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    CFAbsoluteTime duration = now - _sampleStartTime;
+    if (_sampleLength < minLength || duration < kJPVideoPlayerBandwidthSampleMinDuration) {
+        return NO;
+    }
+
+    JPBandwidthSampleWindowAdd(&_throughputs, _sampleLength / duration);
+    _sampleStartTime = now;
+    _sampleLength = 0;
+    return YES;
+}
+
+- (void)recordTimeToFirstByte:(NSTimeInterval)timeToFirstByte {
+    JPBandwidthSampleWindowAdd(&_timesToFirstByte, timeToFirstByte);
+}
+
+- (void)recordRoundTripTime:(NSTimeInterval)roundTripTime {
+    JPBandwidthSampleWindowAdd(&_roundTripTimes, roundTripTime);
+}
+
+- (JPVideoPlayerBandwidthEstimate *)estimateWithHost:(NSString *)host {
+    JPVideoPlayerBandwidthEstimate *estimate = [JPVideoPlayerBandwidthEstimate new];
+    estimate.host = host;
+    estimate.throughputSampleCount = _throughputs.total;
+    estimate.throughput = _throughputs.average;
+    estimate.timeToFirstByte = _timesToFirstByte.average;
+    estimate.roundTripTime = _roundTripTimes.average;
+    estimate.throughputs = JPBandwidthSampleWindowSortedValues(&_throughputs);
+    estimate.timesToFirstByte = JPBandwidthSampleWindowSortedValues(&_timesToFirstByte);
+    estimate.roundTripTimes = JPBandwidthSampleWindowSortedValues(&_roundTripTimes);
+    return estimate;
+}
+
+@end
+
+@interface JPVideoPlayerBandwidthEstimator()
+
+@property (nonatomic, strong) JPVideoPlayerBandwidthRecord *totalRecord;
+
+@property (nonatomic, strong) NSMutableDictionary<NSString *, JPVideoPlayerBandwidthRecord *> *hostRecords;
+
+@property (nonatomic) pthread_mutex_t lock;
+
+@end
+
+@implementation JPVideoPlayerBandwidthEstimator
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_lock);
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        pthread_mutexattr_t mutexattr;
+        pthread_mutexattr_init(&mutexattr);
+        pthread_mutexattr_settype(&mutexattr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&_lock, &mutexattr);
+        _totalRecord = [JPVideoPlayerBandwidthRecord new];
+        _hostRecords = [@{} mutableCopy];
+    }
+    return self;
+}
+
+- (JPVideoPlayerBandwidthEstimate *)estimate {
+    pthread_mutex_lock(&_lock);
+    JPVideoPlayerBandwidthEstimate *estimate = [self.totalRecord estimateWithHost:nil];
+    pthread_mutex_unlock(&_lock);
+    return estimate;
+}
+
+- (JPVideoPlayerBandwidthEstimate *)estimateForHost:(NSString *)host {
+    pthread_mutex_lock(&_lock);
+    JPVideoPlayerBandwidthEstimate *estimate = [self.hostRecords[host] estimateWithHost:host];
+    pthread_mutex_unlock(&_lock);
+    return estimate;
+}
+
+- (void)transferDidStartForHost:(NSString *)host {
+    pthread_mutex_lock(&_lock);
+    [self.totalRecord transferDidStart];
+    [[self recordForHost:host] transferDidStart];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (BOOL)transferDidReceiveDataWithLength:(NSUInteger)length
+                                 forHost:(NSString *)host {
+    pthread_mutex_lock(&_lock);
+    BOOL sampled = [self.totalRecord transferDidReceiveDataWithLength:length];
+    sampled = [[self recordForHost:host] transferDidReceiveDataWithLength:length] || sampled;
+    pthread_mutex_unlock(&_lock);
+    return sampled;
+}
+
+- (BOOL)transferDidEndForHost:(NSString *)host {
+    pthread_mutex_lock(&_lock);
+    BOOL sampled = [self.totalRecord transferDidEnd];
+    sampled = [[self recordForHost:host] transferDidEnd] || sampled;
+    pthread_mutex_unlock(&_lock);
+    return sampled;
+}
+
+- (void)recordTimeToFirstByte:(NSTimeInterval)timeToFirstByte
+                      forHost:(NSString *)host {
+    if (timeToFirstByte < 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&_lock);
+    [self.totalRecord recordTimeToFirstByte:timeToFirstByte];
+    [[self recordForHost:host] recordTimeToFirstByte:timeToFirstByte];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)recordRoundTripTime:(NSTimeInterval)roundTripTime
+                    forHost:(NSString *)host {
+    if (roundTripTime < 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&_lock);
+    [self.totalRecord recordRoundTripTime:roundTripTime];
+    [[self recordForHost:host] recordRoundTripTime:roundTripTime];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)reset {
+    pthread_mutex_lock(&_lock);
+    self.totalRecord = [JPVideoPlayerBandwidthRecord new];
+    [self.hostRecords removeAllObjects];
+    pthread_mutex_unlock(&_lock);
+}
+
+
+#pragma mark - Private
+
+- (JPVideoPlayerBandwidthRecord *)recordForHost:(NSString *)host {
+    NSString *key = host ?: @"";
+    JPVideoPlayerBandwidthRecord *record = self.hostRecords[key];
+    if (!record) {
+        record = [JPVideoPlayerBandwidthRecord new];
+        self.hostRecords[key] = record;
+    }
+    return record;
+}
+
+@end
@@ -0,0 +1,148 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A compact bitmap of fixed size blocks of a video file, one bit represent one block is cached or not.
+ * Lookup a position is O(1), and search the next cached or missing block scans 64 blocks at a time.
+ * Note the last block maybe shorter than `blockSize`.
+ * Note this class is not thread safe.
+ */
+@interface JPVideoPlayerBlockBitmap : NSObject
+
+/**
+ * The size of block in bytes.
+ */
+@property (nonatomic, assign, readonly) NSUInteger blockSize;
+
+/**
+ * The length of file in bytes.
+ */
+@property (nonatomic, assign, readonly) NSUInteger length;
+
+/**
+ * The number of blocks.
+ */
+@property (nonatomic, assign, readonly) NSUInteger blockCount;
+
+/**
+ * The number of blocks be set.
+ */
+@property (nonatomic, assign, readonly) NSUInteger setBlockCount;
+
+/**
+ * Designated initializer method.
+ *
+ * @param length    The length of file in bytes.
+ * @param blockSize The size of block in bytes, must be greater than 0.
+ *
+ * @return A instance of this class.
+ */
+- (instancetype)initWithLength:(NSUInteger)length
+                     blockSize:(NSUInteger)blockSize NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ * Fetch the block is set or not.
+ *
+ * @param index The index of block.
+ *
+ * @return YES if the block is set.
+ */
+- (BOOL)isBlockSetAtIndex:(NSUInteger)index;
+
+/**
+ * Fetch the block contain given position is set or not.
+ *
+ * @param position A position in file.
+ *
+ * @return YES if the block contain the position is set.
+ */
+- (BOOL)containsPosition:(NSUInteger)position;
+
+/**
+ * Set the blocks in given block range.
+ *
+ * @param blockRange A range of block index.
+ */
+- (void)setBlocksInRange:(NSRange)blockRange;
+
+/**
+ * Clear the blocks in given block range.
+ *
+ * @param blockRange A range of block index.
+ */
+- (void)clearBlocksInRange:(NSRange)blockRange;
+
+/**
+ * Clear all blocks.
+ */
+- (void)clearAllBlocks;
+
+/**
+ * Find the first set block from given block index.
+ *
+ * @param index The block index to start.
+ *
+ * @return The index of first set block, `NSNotFound` if not found.
+ */
+- (NSUInteger)firstSetBlockFromIndex:(NSUInteger)index;
+
+/**
+ * Find the first clear block from given block index.
+ *
+ * @param index The block index to start.
+ *
+ * @return The index of first clear block, `NSNotFound` if not found.
+ */
+- (NSUInteger)firstClearBlockFromIndex:(NSUInteger)index;
+
+/**
+ * Fetch the range of blocks fully covered by given byte range.
+ *
+ * @param range A byte range.
+ *
+ * @return The range of block index, the length is 0 if no block fully covered.
+ */
+- (NSRange)blockRangeInsideByteRange:(NSRange)range;
+
+/**
+ * Fetch the range of blocks overlapped with given byte range.
+ *
+ * @param range A byte range.
+ *
+ * @return The range of block index, the length is 0 if no block overlapped.
+ */
+- (NSRange)blockRangeOverlapByteRange:(NSRange)range;
+
+/**
+ * Fetch the byte range of given block range, the end is clamped to `length`.
+ *
+ * @param blockRange A range of block index.
+ *
+ * @return The byte range.
+ */
+- (NSRange)byteRangeForBlockRange:(NSRange)blockRange;
+
+/**
+ * Fetch the byte ranges of all runs of set blocks in ascending order.
+ *
+ * @return The byte ranges.
+ */
+- (NSArray<NSValue *> *)byteRanges;
+
+@end
+
+NS_ASSUME_NONNULL_END
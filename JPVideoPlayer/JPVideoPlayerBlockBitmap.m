@@ -0,0 +1,170 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerBlockBitmap.h"
+
+@interface JPVideoPlayerBlockBitmap() {
+    uint64_t *_words;
+    NSUInteger _wordCount;
+}
+
+@end
+
+@implementation JPVideoPlayerBlockBitmap
+
+- (void)dealloc {
+    free(_words);
+}
+
+- (instancetype)initWithLength:(NSUInteger)length
+                     blockSize:(NSUInteger)blockSize {
+    NSParameterAssert(blockSize > 0);
+    self = [super init];
+    if (self) {
+        _blockSize = MAX(blockSize, 1);
+        _length = length;
+        _blockCount = (length + _blockSize - 1) / _blockSize;
+        _wordCount = (_blockCount + 63) / 64;
+        _words = _wordCount ? calloc(_wordCount, sizeof(uint64_t)) : NULL;
+        _setBlockCount = 0;
+    }
+    return self;
+}
+
+
+#pragma mark - Public
+
+- (BOOL)isBlockSetAtIndex:(NSUInteger)index {
+    if (index >= _blockCount) {
+        return NO;
+    }
+    return (_words[index >> 6] >> (index & 63)) & 1;
+}
+
+- (BOOL)containsPosition:(NSUInteger)position {
+    return [self isBlockSetAtIndex:position / _blockSize];
+}
+
+- (void)setBlocksInRange:(NSRange)blockRange {
+    [self updateBlocksInRange:blockRange set:YES];
+}
+
+- (void)clearBlocksInRange:(NSRange)blockRange {
+    [self updateBlocksInRange:blockRange set:NO];
+}
+
+- (void)clearAllBlocks {
+    if (_wordCount) {
+        memset(_words, 0, _wordCount * sizeof(uint64_t));
+    }
+    _setBlockCount = 0;
+}
+
+- (NSUInteger)firstSetBlockFromIndex:(NSUInteger)index {
+    return [self firstBlockFromIndex:index set:YES];
+}
+
+- (NSUInteger)firstClearBlockFromIndex:(NSUInteger)index {
+    return [self firstBlockFromIndex:index set:NO];
+}
+
+- (NSRange)blockRangeInsideByteRange:(NSRange)range {
+    NSUInteger start = (range.location + _blockSize - 1) / _blockSize;
+    NSUInteger end = MIN(NSMaxRange(range), _length);
+    // the last block is shorter, it is fully covered if the range reach the end of file.
+    NSUInteger endBlock = end == _length ? _blockCount : end / _blockSize;
+    if (endBlock <= start) {
+        return NSMakeRange(start, 0);
+    }
+    return NSMakeRange(start, endBlock - start);
+}
+
+- (NSRange)blockRangeOverlapByteRange:(NSRange)range {
+    NSUInteger start = range.location / _blockSize;
+    NSUInteger end = MIN(NSMaxRange(range), _length);
+    NSUInteger endBlock = (end + _blockSize - 1) / _blockSize;
+    if (endBlock <= start) {
+        return NSMakeRange(start, 0);
+    }
+    return NSMakeRange(start, endBlock - start);
+}
+
+- (NSRange)byteRangeForBlockRange:(NSRange)blockRange {
+    NSUInteger start = MIN(blockRange.location * _blockSize, _length);
+    NSUInteger end = MIN(NSMaxRange(blockRange) * _blockSize, _length);
+    return NSMakeRange(start, end - start);
+}
+
+- (NSArray<NSValue *> *)byteRanges {
+    NSMutableArray<NSValue *> *ranges = [NSMutableArray array];
+    NSUInteger index = [self firstSetBlockFromIndex:0];
+    while (index != NSNotFound) {
+        NSUInteger end = [self firstClearBlockFromIndex:index];
+        if (end == NSNotFound) {
+            end = _blockCount;
+        }
+        [ranges addObject:[NSValue valueWithRange:[self byteRangeForBlockRange:NSMakeRange(index, end - index)]]];
+        index = end < _blockCount ? [self firstSetBlockFromIndex:end] : NSNotFound;
+    }
+    return [ranges copy];
+}
+
+
+#pragma mark - Private
+
+- (void)updateBlocksInRange:(NSRange)blockRange
+                        set:(BOOL)set {
+    NSUInteger start = blockRange.location;
+    NSUInteger end = MIN(NSMaxRange(blockRange), _blockCount);
+    while (start < end) {
+        NSUInteger wordIndex = start >> 6;
+        NSUInteger bitStart = start & 63;
+        NSUInteger bitCount = MIN(64 - bitStart, end - start);
+        uint64_t mask = (bitCount == 64 ? UINT64_MAX : ((1ULL << bitCount) - 1)) << bitStart;
+        uint64_t word = _words[wordIndex];
+        uint64_t changed = set ? (~word & mask) : (word & mask);
+        NSUInteger changedCount = (NSUInteger)__builtin_popcountll(changed);
+        if (set) {
+            _words[wordIndex] = word | mask;
+            _setBlockCount += changedCount;
+        }
+        else {
+            _words[wordIndex] = word & ~mask;
+            _setBlockCount -= changedCount;
+        }
+        start += bitCount;
+    }
+}
+
+- (NSUInteger)firstBlockFromIndex:(NSUInteger)index
+                              set:(BOOL)set {
+    if (index >= _blockCount) {
+        return NSNotFound;
+    }
+
+    NSUInteger wordIndex = index >> 6;
+    // ignore the bits before index in the first word.
+    uint64_t word = set ? _words[wordIndex] : ~_words[wordIndex];
+    word &= UINT64_MAX << (index & 63);
+    while (YES) {
+        if (word) {
+            NSUInteger found = (wordIndex << 6) + (NSUInteger)__builtin_ctzll(word);
+            return found < _blockCount ? found : NSNotFound;
+        }
+        wordIndex++;
+        if (wordIndex >= _wordCount) {
+            return NSNotFound;
+        }
+        word = set ? _words[wordIndex] : ~_words[wordIndex];
+    }
+}
+
+@end
@@ -32,6 +32,49 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (assign, nonatomic) BOOL shouldDisableiCloud;
 
+/**
+ * Reserve the disk space for the whole video data when the content length become known [defaults to NO].
+ * The reserved file have contiguous extents for faster sequential replay, and the cache fail early
+ * instead of part-way through a download if the disk is full.
+ */
+@property (assign, nonatomic) BOOL shouldPreallocateDiskSpace;
+
+/**
+ * The maximum size of video data to cache when reserve disk space failed, in bytes [defaults to 10 MB].
+ * Only the head of video in this size is cached, the rest is streamed to player without cache.
+ */
+@property (assign, nonatomic) NSUInteger streamingOnlyCacheSize;
+
+/**
+ * Store a CRC-32C checksum for every cached block and verify it before serve the block to player [defaults to NO].
+ * A corrupt block is evicted and fetched from web again.
+ */
+@property (assign, nonatomic) BOOL shouldVerifyCachedData;
+
+/**
+ * The length of video data to download ahead of the range the player requested, in bytes [defaults to 0, disabled].
+ * The data is downloaded into cache at low priority while the player is playing.
+ */
+@property (assign, nonatomic) NSUInteger readAheadLength;
+
+/**
+ * The duration of video to download ahead of the range the player requested, in seconds [defaults to 0, disabled].
+ * Converted to bytes by the average bitrate of the video, the larger one of this and `readAheadLength` is used.
+ */
+@property (assign, nonatomic) NSTimeInterval readAheadDuration;
+
+/**
+ * The length of video data a web request keep downloading into cache after the player cancel it, in bytes
+ * [defaults to 0, disabled]. The player cancel the request on every seek, the data already in flight and the
+ * warmed up connection are not wasted, the next request for those bytes is answered from cache.
+ */
+@property (assign, nonatomic) NSUInteger backgroundFillLength;
+
+/**
+ * The maximum duration a cancelled web request keep downloading, in seconds [defaults to 10].
+ */
+@property (assign, nonatomic) NSTimeInterval backgroundFillDuration;
+
 @end
 
 typedef NS_ENUM(NSInteger, JPVideoPlayerCacheType)   {
@@ -146,6 +189,14 @@ typedef void(^JPVideoPlayerCalculateSizeCompletion)(NSUInteger fileCount, NSUInt
  */
 - (void)clearVideoCacheOnVersion2OnCompletion:(dispatch_block_t _Nullable)completion;
 
+/**
+ * Async upgrade all JSON index files written by version before 3.2.0 to the binary index file format.
+ * Non-blocking method - returns immediately.
+ *
+ * @param completion A block that should be executed after upgrade completes (optional).
+ */
+- (void)upgradeLegacyIndexFilesOnCompletion:(dispatch_block_t _Nullable)completion;
+
 # pragma mark - Cache Info
 
 /**
@@ -11,6 +11,7 @@
 
 #import "JPVideoPlayerCache.h"
 #import "JPVideoPlayerCachePath.h"
+#import "JPVideoPlayerCacheFile.h"
 #import "JPVideoPlayerCompat.h"
 #import "JPVideoPlayerManager.h"
 #import "JPVideoPlayerSupportUtils.h"
@@ -22,6 +23,8 @@
 
 static const NSInteger kDefaultCacheMaxCacheAge = 60*60*24*7; // 1 week
 static const NSInteger kDefaultCacheMaxSize = 1000*1000*1000; // 1 GB
+static const NSUInteger kDefaultStreamingOnlyCacheSize = 10*1000*1000; // 10 MB
+static const NSTimeInterval kDefaultBackgroundFillDuration = 10; // 10 s
 
 @implementation JPVideoPlayerCacheConfiguration
 
@@ -30,6 +33,13 @@ static const NSInteger kDefaultCacheMaxSize = 1000*1000*1000; // 1 GB
     if (self) {
         _maxCacheAge =  kDefaultCacheMaxCacheAge;
         _maxCacheSize = kDefaultCacheMaxSize;
+        _shouldPreallocateDiskSpace = NO;
+        _streamingOnlyCacheSize = kDefaultStreamingOnlyCacheSize;
+        _shouldVerifyCachedData = NO;
+        _readAheadLength = 0;
+        _readAheadDuration = 0;
+        _backgroundFillLength = 0;
+        _backgroundFillDuration = kDefaultBackgroundFillDuration;
     }
     return self;
 }
@@ -152,6 +162,7 @@ static NSString *kJPVideoPlayerVersion2CacheHasBeenClearedKey = @"com.newpan.ver
         if ([self.fileManager fileExistsAtPath:[JPVideoPlayerCachePath videoCachePathForKey:key]]) {
             [self.fileManager removeItemAtPath:[JPVideoPlayerCachePath videoCachePathForKey:key] error:nil];
             [self.fileManager removeItemAtPath:[JPVideoPlayerCachePath videoCacheIndexFilePathForKey:key] error:nil];
+            [self.fileManager removeItemAtPath:[JPVideoPlayerCachePath videoCacheIndexJournalFilePathForKey:key] error:nil];
             JPDispatchSyncOnMainQueue(^{
                 if (completion) {
                     completion();
@@ -283,6 +294,29 @@ static NSString *kJPVideoPlayerVersion2CacheHasBeenClearedKey = @"com.newpan.ver
     });
 }
 
+- (void)upgradeLegacyIndexFilesOnCompletion:(dispatch_block_t _Nullable)completion {
+    dispatch_async(self.ioQueue, ^{
+        NSString *videoCachePath = [JPVideoPlayerCachePath videoCachePath];
+        NSDirectoryEnumerator *fileEnumerator = [self.fileManager enumeratorAtPath:videoCachePath];
+        NSUInteger upgradeCount = 0;
+        for (NSString *fileName in fileEnumerator) {
+            if (![fileName.pathExtension isEqualToString:@"index"]) {
+                continue;
+            }
+            NSString *indexFilePath = [videoCachePath stringByAppendingPathComponent:fileName];
+            if ([JPVideoPlayerCacheFile upgradeLegacyIndexFileAtPath:indexFilePath]) {
+                upgradeCount++;
+            }
+        }
+        JPDebugLog(@"Upgrade %ld legacy index files", upgradeCount);
+        JPDispatchSyncOnMainQueue(^{
+            if (completion) {
+                completion();
+            }
+        });
+    });
+}
+
 
 #pragma mark - File Name
 
@@ -13,6 +13,11 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ * The size of block in the block level view of cached video data.
+ */
+FOUNDATION_EXTERN const NSUInteger JPVideoPlayerCacheFileBlockSize;
+
 @interface JPVideoPlayerCacheFile : NSObject
 
 #pragma mark - Properties
@@ -29,6 +34,12 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, copy, readonly, nullable) NSString *indexFilePath;
 
+/**
+ * The journal file path of index. The fragment ranges cached after the last index file rewrite are
+ * appended to this file, and merged back into the index file when the journal grows too long.
+ */
+@property (nonatomic, copy, readonly, nullable) NSString *journalFilePath;
+
 /**
  * The video data expected length.
  * Note this value is not always equal to the cache video data length.
@@ -37,6 +48,7 @@ NS_ASSUME_NONNULL_BEGIN
 
 /**
  * The fragment of video data that cached in disk.
+ * Note this is a snapshot of the index at the time of call, it is safe to read it on any thread.
  */
 @property (nonatomic, strong, readonly, nullable) NSArray<NSValue *> *fragmentRanges;
 
@@ -70,6 +82,33 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, readonly) NSUInteger cachedDataBound;
 
+/**
+ * A flag represent reserve the disk space for whole video data when `storeResponse:` learn the file length.
+ */
+@property (nonatomic, assign) BOOL preallocatesDiskSpace;
+
+/**
+ * The maximum size of video data to cache when reserve disk space failed.
+ */
+@property (nonatomic, assign) NSUInteger streamingOnlyCacheSize;
+
+/**
+ * A flag represent compute the checksum of every fully cached block on write, and verify it once before read.
+ * The blocks cached before it is enabled have no checksum, and are served without verification.
+ */
+@property (nonatomic, assign) BOOL verifiesChecksum;
+
+/**
+ * A flag represent reserve disk space failed, only the head of video in `streamingOnlyCacheSize` is cached.
+ * The flag is stored in index file, so it is kept when the cache file opened again.
+ */
+@property (nonatomic, readonly) BOOL isStreamingOnly;
+
+/**
+ * The length of the head of video can be cached, that is `fileLength`, or `streamingOnlyCacheSize` if streaming only.
+ */
+@property (nonatomic, readonly) NSUInteger cacheableLength;
+
 #pragma mark - Methods
 
 /**
@@ -100,19 +139,27 @@ NS_ASSUME_NONNULL_BEGIN
 
 /**
  * Call this method to store video data to disk.
+ * Note the contiguous data is collected in a write-behind buffer and written to disk in 256 KB aligned pieces,
+ * so the data is not visible to read until the buffer flushed. The buffer is flushed on `synchronize`,
+ * when the data is not contiguous, and when the app enter background.
+ *
+ * The range of data is only marked cached after it written to disk, the data failed to write is dropped.
  *
  * @param data        Video data.
  * @param offset      The offset of the data in video file.
  * @param synchronize A flag indicator store index to index file synchronize or not.
- * @param completion  Call when store the data finished.
+ * @param completion  Call when store the data finished, with the error of the buffered data failed to write
+ *                    since last call, or the error of the data beyond `cacheableLength` which is dropped,
+ *                    nil if no write failed.
  */
 - (void)storeVideoData:(NSData *)data
               atOffset:(NSUInteger)offset
            synchronize:(BOOL)synchronize
-      storedCompletion:(dispatch_block_t)completion;
+      storedCompletion:(void (^_Nullable)(NSError *_Nullable error))completion;
 
 /**
  * Set the response from web when request video data.
+ * The index file is rewritten only if the file length or response headers changed, storing the same response is free.
  *
  * @param response The response from web when request video data.
  *
@@ -122,16 +169,31 @@ NS_ASSUME_NONNULL_BEGIN
 
 /**
  * Store index to index file synchronize.
+ * Note this method only append the new cached ranges to the journal file in most cases,
+ * the whole index file is rewritten when the response changed or the journal grows too long.
  *
  * @return The result of store index to index file successed or failed.
  */
 - (BOOL)synchronize;
 
+#pragma mark - Migration
+
+/**
+ * Upgrade the JSON index file written by version before 3.2.0 to the binary index file.
+ * The index file opened by a cache file is skipped, the cache file upgrade it by itself when open.
+ *
+ * @param indexFilePath The index file path.
+ *
+ * @return YES if the index file has been upgraded, NO if it is not a legacy index file, it is opened or the upgrade failed.
+ */
++ (BOOL)upgradeLegacyIndexFileAtPath:(NSString *)indexFilePath;
+
 #pragma mark - Read
 
 /**
  * Fetch data from the readOffset to given length position.
  * Note call `seekToPosition:` to set the readOffset before call this method.
+ * Note prefer `dataWithRange:`, this method share the readOffset between callers.
  * Note the data not always have video data if the data not cached in disk.
  *
  * @param length The length of data.
@@ -142,7 +204,11 @@ NS_ASSUME_NONNULL_BEGIN
 
 /**
  * Fetch data in given range.
- * Note the data not always have video data if the data not cached in disk.
+ * This method use positional read and keep no state, so it is safe to call on several threads at the same time,
+ * even when other thread is storing video data.
+ * Note the data is nil if the data at `range.location` not cached in disk, and it is shorter than the
+ * given range if only the head of range is cached.
+ * Note when the video data is cache finished, the data is a view over a memory mapping of the file without copy.
  *
  * @param range The range in file.
  *
@@ -177,6 +243,35 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (NSRange)cachedRangeContainsPosition:(NSUInteger)position;
 
+/**
+ * Fetch the block contain given position is fully cached or not, this is O(1).
+ *
+ * @param position A position point to a point of video file.
+ *
+ * @return YES if the block contain given position is fully cached.
+ */
+- (BOOL)isBlockCachedAtPosition:(NSUInteger)position;
+
+/**
+ * Find the start position of first block not fully cached from the block contain given position.
+ *
+ * @param position A position point to a point of video file.
+ *
+ * @return The start position of first block not fully cached, `NSNotFound` if all blocks are cached.
+ */
+- (NSUInteger)firstNotCachedBlockPositionFromPosition:(NSUInteger)position;
+
+/**
+ * Evict the cached blocks overlapped with given range, and release the disk space of them if possible.
+ * The evicted data will be downloaded again when need.
+ * Note the index is stored to index file before the disk space released, the space is kept if store index failed.
+ *
+ * @param range A byte range.
+ *
+ * @return The number of evicted blocks.
+ */
+- (NSUInteger)evictBlocksInRange:(NSRange)range;
+
 /**
  * Find the first range of video data not cached in given postion.
  *
@@ -186,17 +281,35 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (NSRange)firstNotCachedRangeFromPosition:(NSUInteger)position;
 
+/**
+ * Fetch the parts of given range which are cached.
+ *
+ * @param range A range of video file.
+ *
+ * @return The cached ranges in ascending order.
+ */
+- (NSArray<NSValue *> *)cachedRangesInRange:(NSRange)range;
+
+/**
+ * Fetch the parts of given range which are not cached, the complement of `cachedRangesInRange:` in given range.
+ *
+ * @param range A range of video file.
+ *
+ * @return The not cached ranges in ascending order.
+ */
+- (NSArray<NSValue *> *)missingRangesInRange:(NSRange)range;
+
 #pragma mark - Seek
 
 /**
- * Set the fileHandle seek to the given offset.
+ * Set the readOffset to the given offset.
  *
  * @param position A position point to a point of video file.
  */
 - (void)seekToPosition:(NSUInteger)position;
 
 /**
- * Set the fileHandle seek to end of file.
+ * Set the readOffset to end of file.
  */
 - (void)seekToEnd;
 
@@ -12,16 +12,84 @@
 #import "JPVideoPlayerCacheFile.h"
 #import "JPVideoPlayerCompat.h"
 #import "JPVideoPlayerSupportUtils.h"
-#import "JPVideoPlayerCompat.h"
+#import "JPVideoPlayerRangeSet.h"
+#import "JPVideoPlayerBlockBitmap.h"
+#import "JPCRC32C.h"
+#import <UIKit/UIKit.h>
 #import <pthread.h>
+#import <fcntl.h>
+#import <unistd.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+
+/**
+ * A read only memory mapping of a completed video data file.
+ * The `NSData` handed out by `dataWithRange:` retain this object, so the mapping stays alive until the last view released.
+ */
+@interface JPVideoPlayerCacheFileMapping : NSObject
+
+@property (nonatomic, assign, readonly) const uint8_t *bytes;
+
+@property (nonatomic, assign, readonly) NSUInteger length;
+
++ (instancetype _Nullable)mappingWithFileDescriptor:(int)fileDescriptor
+                                             length:(NSUInteger)length;
+
+@end
 
 @interface JPVideoPlayerCacheFile()
 
-@property (nonatomic, strong) NSMutableArray<NSValue *> *internalFragmentRanges;
+@property (nonatomic, strong) JPVideoPlayerRangeSet *internalFragmentRanges;
 
-@property (nonatomic, strong) NSFileHandle *writeFileHandle;
+/**
+ * The block level view of `internalFragmentRanges`, a block is set when it is fully cached.
+ */
+@property (nonatomic, strong) JPVideoPlayerBlockBitmap *blockBitmap;
+
+/**
+ * The CRC-32C checksum of every block, only valid for the blocks set in `checksumBitmap`.
+ */
+@property (nonatomic, strong) NSMutableData *blockChecksums;
+
+@property (nonatomic, strong) JPVideoPlayerBlockBitmap *checksumBitmap;
 
-@property (nonatomic, strong) NSFileHandle *readFileHandle;
+/**
+ * The blocks already verified since the cache file opened, every block is verified only once.
+ */
+@property (nonatomic, strong) JPVideoPlayerBlockBitmap *verifiedBitmap;
+
+/**
+ * The file descriptor of video data file, all reads and writes use positional I/O on it,
+ * so it has no shared offset and can be used by several threads at the same time.
+ */
+@property (nonatomic, assign) int fileDescriptor;
+
+/**
+ * The memory mapping of video data file, only available when the video data is cache finished.
+ */
+@property (nonatomic, strong) JPVideoPlayerCacheFileMapping *mapping;
+
+/**
+ * A flag represent mapping failed, do not try again.
+ */
+@property (nonatomic, assign) BOOL mappingUnavailable;
+
+/**
+ * The write-behind buffer collect contiguous chunks from web, and write them to disk in large aligned pieces.
+ */
+@property (nonatomic, strong) NSMutableData *writeBuffer;
+
+/**
+ * The offset in video data file of the first byte in write buffer.
+ */
+@property (nonatomic, assign) NSUInteger writeBufferOffset;
+
+/**
+ * The error of the buffered data failed to write, reported to the next caller of store.
+ */
+@property (nonatomic, strong) NSError *writeError;
+
+@property (nonatomic, assign) BOOL streamingOnly;
 
 @property(nonatomic, assign) BOOL completed;
 
@@ -31,13 +99,230 @@
 
 @property (nonatomic, copy) NSDictionary *responseHeaders;
 
+/**
+ * The ranges cached since the last time append to journal.
+ */
+@property (nonatomic, strong) JPVideoPlayerRangeSet *pendingJournalRanges;
+
+/**
+ * The indexes of blocks whose checksum computed since the last time append to journal.
+ */
+@property (nonatomic, strong) NSMutableIndexSet *pendingJournalChecksums;
+
+@property (nonatomic, assign) NSUInteger journalRecordCount;
+
+/**
+ * The generation of index file, see the layout of index file.
+ */
+@property (nonatomic, assign) uint64_t generation;
+
+@property (nonatomic, assign) int journalFileDescriptor;
+
+/**
+ * A flag represent the index file must be rewritten on next synchronize, such as file length or response headers changed.
+ */
+@property (nonatomic, assign) BOOL indexNeedsCompaction;
+
 @property (nonatomic) pthread_mutex_t lock;
 
+/**
+ * The lock of write buffer, always take it before `lock` if need both.
+ */
+@property (nonatomic) pthread_mutex_t writeLock;
+
+/**
+ * The lock serialize the commits of index, it guard the journal. Always take it after `writeLock` and before `lock`.
+ */
+@property (nonatomic) pthread_mutex_t commitLock;
+
+@end
+
+/**
+ * The layout of index file, all integers are little endian:
+ *
+ * | magic(4) | version(2) | flags(2) | file length(8) | generation(8) | header blob length(4) | range count(4) |
+ * | block size(4) | block checksum count(4) |
+ * | header blob(binary plist of response headers) | range table(range count * (start(8) + end(8))) |
+ * | block checksum table(block checksum count * (block index(4) + crc32c(4))) | checksum(4) |
+ *
+ * The generation is bumped every time the index file rewritten, the journal carry the generation of
+ * index file it based on, so a journal left by a crash after rewrite is never replayed on the new index.
+ * The block checksums are dropped if the block size is not the current one.
+ * The flags are reserved and always 0 before version 3.
+ * The version 2 layout has no block size and block checksum fields, the version 1 layout has no generation field either.
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint64_t fileLength;
+    uint64_t generation;
+    uint32_t headerBlobLength;
+    uint32_t rangeCount;
+    uint32_t blockSize;
+    uint32_t blockChecksumCount;
+} __attribute__((packed)) JPVideoPlayerCacheIndexHeader;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint64_t fileLength;
+    uint64_t generation;
+    uint32_t headerBlobLength;
+    uint32_t rangeCount;
+} __attribute__((packed)) JPVideoPlayerCacheIndexHeaderV2;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint64_t fileLength;
+    uint32_t headerBlobLength;
+    uint32_t rangeCount;
+} __attribute__((packed)) JPVideoPlayerCacheIndexHeaderV1;
+
+static const uint32_t kJPVideoPlayerCacheIndexMagic = 0x4956504A; // "JPVI".
+static const uint16_t kJPVideoPlayerCacheIndexVersion = 3;
+// the cache file fell back to streaming only, see `isStreamingOnly`.
+static const uint16_t kJPVideoPlayerCacheIndexFlagStreamingOnly = 1 << 0;
+
+// The keys of JSON index file written by version before 3.2.0.
+static NSString *const kJPVideoPlayerCacheFileZoneKey = @"com.newpan.zone.key.www";
+static NSString *const kJPVideoPlayerCacheFileSizeKey = @"com.newpan.size.key.www";
+static NSString *const kJPVideoPlayerCacheFileResponseHeadersKey = @"com.newpan.response.header.key.www";
+
+/**
+ * The journal file is a sequence of fixed size records, all integers are little endian:
+ *
+ * | type(4) | start(8) | end(8) | checksum(4) |
+ *
+ * The checksum covers the first 20 bytes of the record, so a torn write at the tail is detected on replay.
+ * The first record is always a header record, the start is the generation of index file the journal based on,
+ * and the end is the file length.
+ * A block checksum record carry the block index in start and the crc32c of block in end.
+ */
+typedef struct {
+    uint32_t type;
+    uint64_t start;
+    uint64_t end;
+    uint32_t checksum;
+} __attribute__((packed)) JPVideoPlayerCacheJournalRecord;
+
+typedef NS_ENUM(uint32_t, JPVideoPlayerCacheJournalRecordType) {
+    JPVideoPlayerCacheJournalRecordTypeAddRange = 1,
+    JPVideoPlayerCacheJournalRecordTypeHeader = 2,
+    JPVideoPlayerCacheJournalRecordTypeBlockChecksum = 3,
+};
+
+static const NSUInteger kJPVideoPlayerCacheJournalCompactionThreshold = 512;
+static const NSUInteger kJPVideoPlayerCacheFileWriteBufferSize = 256 * 1024;
+const NSUInteger JPVideoPlayerCacheFileBlockSize = 128 * 1024;
+
+static uint32_t JPVideoPlayerCacheIndexChecksum(const uint8_t *bytes, size_t length) {
+    // FNV-1a.
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static BOOL JPVideoPlayerCacheFilePositionalRead(int fileDescriptor, void *buffer, size_t length, off_t offset) {
+    size_t bytesRead = 0;
+    while (bytesRead < length) {
+        ssize_t result = pread(fileDescriptor, (uint8_t *)buffer + bytesRead, length - bytesRead, offset + (off_t)bytesRead);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return NO;
+        }
+        bytesRead += (size_t)result;
+    }
+    return YES;
+}
+
+static BOOL JPVideoPlayerCacheFilePositionalWrite(int fileDescriptor, const void *buffer, size_t length, off_t offset) {
+    size_t bytesWritten = 0;
+    while (bytesWritten < length) {
+        ssize_t result = pwrite(fileDescriptor, (const uint8_t *)buffer + bytesWritten, length - bytesWritten, offset + (off_t)bytesWritten);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return NO;
+        }
+        bytesWritten += (size_t)result;
+    }
+    return YES;
+}
+
+static JPVideoPlayerCacheJournalRecord JPVideoPlayerCacheJournalRecordMake(JPVideoPlayerCacheJournalRecordType type, uint64_t start, uint64_t end) {
+    JPVideoPlayerCacheJournalRecord record;
+    record.type = CFSwapInt32HostToLittle(type);
+    record.start = CFSwapInt64HostToLittle(start);
+    record.end = CFSwapInt64HostToLittle(end);
+    record.checksum = CFSwapInt32HostToLittle(JPVideoPlayerCacheIndexChecksum((const uint8_t *)&record, offsetof(JPVideoPlayerCacheJournalRecord, checksum)));
+    return record;
+}
+
+static BOOL JPVideoPlayerCacheJournalRecordIsValid(const JPVideoPlayerCacheJournalRecord *record) {
+    uint32_t checksum = JPVideoPlayerCacheIndexChecksum((const uint8_t *)record, offsetof(JPVideoPlayerCacheJournalRecord, checksum));
+    if (CFSwapInt32LittleToHost(record->checksum) != checksum) {
+        return NO;
+    }
+    switch (CFSwapInt32LittleToHost(record->type)) {
+        case JPVideoPlayerCacheJournalRecordTypeHeader:
+            return CFSwapInt64LittleToHost(record->end) > 0;
+
+        case JPVideoPlayerCacheJournalRecordTypeAddRange:
+            return CFSwapInt64LittleToHost(record->end) > CFSwapInt64LittleToHost(record->start);
+
+        case JPVideoPlayerCacheJournalRecordTypeBlockChecksum:
+            return CFSwapInt64LittleToHost(record->end) <= UINT32_MAX;
+
+        default:
+            return NO;
+    }
+}
+
+/**
+ * The opened cache files, the bulk upgrade of legacy index files must not rewrite their index files.
+ */
+static NSHashTable<JPVideoPlayerCacheFile *> *JPVideoPlayerOpenedCacheFiles;
+static pthread_mutex_t JPVideoPlayerOpenedCacheFilesLock = PTHREAD_MUTEX_INITIALIZER;
+
+@implementation JPVideoPlayerCacheFileMapping
+
++ (instancetype)mappingWithFileDescriptor:(int)fileDescriptor
+                                   length:(NSUInteger)length {
+    if (fileDescriptor < 0 || length == 0) {
+        return nil;
+    }
+
+    void *bytes = mmap(NULL, length, PROT_READ, MAP_FILE | MAP_SHARED, fileDescriptor, 0);
+    if (bytes == MAP_FAILED) {
+        JPWarningLog(@"Map video data file failed, errno: %d", errno);
+        return nil;
+    }
+    madvise(bytes, length, MADV_SEQUENTIAL);
+
+    JPVideoPlayerCacheFileMapping *mapping = [JPVideoPlayerCacheFileMapping new];
+    mapping->_bytes = bytes;
+    mapping->_length = length;
+    return mapping;
+}
+
+- (void)dealloc {
+    if (_bytes) {
+        munmap((void *)_bytes, _length);
+    }
+}
+
 @end
 
-static const NSString *kJPVideoPlayerCacheFileZoneKey = @"com.newpan.zone.key.www";
-static const NSString *kJPVideoPlayerCacheFileSizeKey = @"com.newpan.size.key.www";
-static const NSString *kJPVideoPlayerCacheFileResponseHeadersKey = @"com.newpan.response.header.key.www";
 @implementation JPVideoPlayerCacheFile
 
 + (instancetype)cacheFileWithFilePath:(NSString *)filePath
@@ -63,51 +348,116 @@ static const NSString *kJPVideoPlayerCacheFileResponseHeadersKey = @"com.newpan.
     if (self) {
         _cacheFilePath = filePath;
         _indexFilePath = indexFilePath;
-        _internalFragmentRanges = [[NSMutableArray alloc] init];
-        _readFileHandle = [NSFileHandle fileHandleForReadingAtPath:_cacheFilePath];
-        _writeFileHandle = [NSFileHandle fileHandleForWritingAtPath:_cacheFilePath];
+        _journalFilePath = [indexFilePath stringByAppendingString:@".journal"];
+        _internalFragmentRanges = [[JPVideoPlayerRangeSet alloc] init];
+        _pendingJournalRanges = [[JPVideoPlayerRangeSet alloc] init];
+        _pendingJournalChecksums = [NSMutableIndexSet indexSet];
+        _journalFileDescriptor = -1;
+        _fileDescriptor = open(_cacheFilePath.fileSystemRepresentation, O_RDWR | O_CLOEXEC);
+        if (_fileDescriptor < 0) {
+            JPErrorLog(@"Open video data file failed, errno: %d", errno);
+        }
         pthread_mutexattr_t mutexattr;
         pthread_mutexattr_init(&mutexattr);
         pthread_mutexattr_settype(&mutexattr, PTHREAD_MUTEX_RECURSIVE);
         pthread_mutex_init(&_lock, &mutexattr);
-
-        NSString *indexStr = [NSString stringWithContentsOfFile:self.indexFilePath encoding:NSUTF8StringEncoding error:nil];
-        NSData *data = [indexStr dataUsingEncoding:NSUTF8StringEncoding];
-        NSDictionary *indexDictionary = [NSJSONSerialization JSONObjectWithData:data
-                                                                 options:NSJSONReadingMutableContainers | NSJSONReadingAllowFragments
-                                                                   error:nil];
-        if (![self serializeIndex:indexDictionary]) {
+        pthread_mutex_init(&_writeLock, &mutexattr);
+        pthread_mutex_init(&_commitLock, &mutexattr);
+        _writeBuffer = [NSMutableData dataWithCapacity:kJPVideoPlayerCacheFileWriteBufferSize];
+
+        // register before read the index, so a running upgrade of legacy index file either finished or skip this one.
+        pthread_mutex_lock(&JPVideoPlayerOpenedCacheFilesLock);
+        if (!JPVideoPlayerOpenedCacheFiles) {
+            JPVideoPlayerOpenedCacheFiles = [NSHashTable weakObjectsHashTable];
+        }
+        [JPVideoPlayerOpenedCacheFiles addObject:self];
+        pthread_mutex_unlock(&JPVideoPlayerOpenedCacheFilesLock);
+
+        NSData *indexData = [NSData dataWithContentsOfFile:self.indexFilePath
+                                                   options:NSDataReadingMappedIfSafe
+                                                     error:nil];
+        BOOL isLegacyIndex = NO;
+        BOOL needsRewriteIndex = NO;
+        if ([self readIndexFromData:indexData isLegacy:&isLegacyIndex]) {
+            [self replayJournalForRecovery:NO];
+            needsRewriteIndex = isLegacyIndex;
+        }
+        else if ([self replayJournalForRecovery:YES]) {
+            // the index file is broken, but the journal still know the committed ranges.
+            JPWarningLog(@"Recover index from journal: %@", self.indexFilePath);
+            needsRewriteIndex = YES;
+        }
+        else {
+            [[NSFileManager defaultManager] removeItemAtPath:self.journalFilePath error:NULL];
             [self truncateFileWithFileLength:0];
         }
+        needsRewriteIndex = [self dropRangesBeyondDataFile] || needsRewriteIndex;
+        if (needsRewriteIndex) {
+            self.indexNeedsCompaction = YES;
+            [self synchronize];
+        }
 
+        [self rebuildBlockBitmap];
         [self checkIsCompleted];
+
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(applicationDidEnterBackground)
+                                                     name:UIApplicationDidEnterBackgroundNotification
+                                                   object:nil];
     }
     return self;
 }
 
 - (void)dealloc {
-    [self.readFileHandle closeFile];
-    [self.writeFileHandle closeFile];
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    if (self.writeBuffer.length) {
+        [self synchronize];
+    }
+    if (self.fileDescriptor >= 0) {
+        close(self.fileDescriptor);
+    }
+    [self closeJournal];
     pthread_mutex_destroy(&_lock);
+    pthread_mutex_destroy(&_writeLock);
+    pthread_mutex_destroy(&_commitLock);
 }
 
 
 #pragma mark - Properties
 
 - (NSUInteger)cachedDataBound {
-    if (self.internalFragmentRanges.count > 0) {
-        NSRange range = [[self.internalFragmentRanges lastObject] rangeValue];
-        return NSMaxRange(range);
-    }
-    return 0;
+    pthread_mutex_lock(&_lock);
+    NSUInteger cachedDataBound = self.internalFragmentRanges.upperBound;
+    pthread_mutex_unlock(&_lock);
+    return cachedDataBound;
 }
 
 - (BOOL)isFileLengthValid {
-    return self.fileLength != 0;
+    pthread_mutex_lock(&_lock);
+    BOOL isFileLengthValid = self.fileLength != 0;
+    pthread_mutex_unlock(&_lock);
+    return isFileLengthValid;
 }
 
 - (BOOL)isCompleted {
-    return self.completed;
+    pthread_mutex_lock(&_lock);
+    BOOL completed = self.completed;
+    pthread_mutex_unlock(&_lock);
+    return completed;
+}
+
+- (BOOL)isStreamingOnly {
+    pthread_mutex_lock(&_lock);
+    BOOL streamingOnly = self.streamingOnly;
+    pthread_mutex_unlock(&_lock);
+    return streamingOnly;
+}
+
+- (NSUInteger)cacheableLength {
+    pthread_mutex_lock(&_lock);
+    NSUInteger cacheableLength = self.streamingOnly ? MIN(self.streamingOnlyCacheSize, self.fileLength) : self.fileLength;
+    pthread_mutex_unlock(&_lock);
+    return cacheableLength;
 }
 
 - (BOOL)isEOF {
@@ -121,60 +471,32 @@ static const NSString *kJPVideoPlayerCacheFileResponseHeadersKey = @"com.newpan.
 #pragma mark - Range
 
 - (NSArray<NSValue *> *)fragmentRanges {
-    return self.internalFragmentRanges;
-}
-
-- (void)mergeRangesIfNeed {
-    JPAssertMainThread;
-    BOOL isMerge = NO;
-    for (int i = 0; i < self.internalFragmentRanges.count; ++i) {
-        if ((i + 1) < self.internalFragmentRanges.count) {
-            NSRange currentRange = [self.internalFragmentRanges[i] rangeValue];
-            NSRange nextRange = [self.internalFragmentRanges[i + 1] rangeValue];
-            if (JPRangeCanMerge(currentRange, nextRange)) {
-                [self.internalFragmentRanges removeObjectsAtIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(i, 2)]];
-                [self.internalFragmentRanges insertObject:[NSValue valueWithRange:NSUnionRange(currentRange, nextRange)] atIndex:i];
-                i -= 1;
-                isMerge = YES;
-            }
-        }
-    }
-    if(isMerge){
-       NSString *string = @"";
-       for(NSValue *rangeValue in self.internalFragmentRanges){
-           NSRange range = [rangeValue rangeValue];
-           string = [string stringByAppendingString:[NSString stringWithFormat:@"%@; ", NSStringFromRange(range)]];
-       }
-        /// JPDebugLog(@"合并后已缓存区间: %@", string);
-    }
+    pthread_mutex_lock(&_lock);
+    NSArray<NSValue *> *ranges = self.internalFragmentRanges.ranges;
+    pthread_mutex_unlock(&_lock);
+    return ranges;
 }
 
 - (void)addRange:(NSRange)range
       completion:(dispatch_block_t)completion {
+    pthread_mutex_lock(&_lock);
     if (range.length == 0 || range.location >= self.fileLength) {
+        pthread_mutex_unlock(&_lock);
         return;
     }
 
-    JPDispatchSyncOnMainQueue(^{
-        BOOL inserted = NO;
-        for (int i = 0; i < self.internalFragmentRanges.count; ++i) {
-            NSRange currentRange = [self.internalFragmentRanges[i] rangeValue];
-            if (currentRange.location >= range.location) {
-                [self.internalFragmentRanges insertObject:[NSValue valueWithRange:range] atIndex:i];
-                inserted = YES;
-                break;
-            }
-        }
-        if (!inserted) {
-            [self.internalFragmentRanges addObject:[NSValue valueWithRange:range]];
-        }
-        [self mergeRangesIfNeed];
-        [self checkIsCompleted];
-
-        if(completion){
-           completion();
-        }
-    });
+    [self.internalFragmentRanges addRange:range];
+    [self.pendingJournalRanges addRange:range];
+    // the new range maybe fill the gap between fragments, so mark the blocks of the merged range.
+    NSRange mergedRange = [self.internalFragmentRanges rangeContainsPosition:range.location];
+    [self.blockBitmap setBlocksInRange:[self.blockBitmap blockRangeInsideByteRange:mergedRange]];
+    [self checkIsCompleted];
+    pthread_mutex_unlock(&_lock);
+
+    // call completion on the calling thread and out of lock, the caller decide which thread to notify.
+    if(completion){
+       completion();
+    }
 }
 
 - (NSRange)cachedRangeForRange:(NSRange)range {
@@ -189,68 +511,276 @@ static const NSString *kJPVideoPlayerCacheFileResponseHeadersKey = @"com.newpan.
 }
 
 - (NSRange)cachedRangeContainsPosition:(NSUInteger)position {
+    pthread_mutex_lock(&_lock);
     if (position >= self.fileLength) {
+        pthread_mutex_unlock(&_lock);
         return JPInvalidRange;
     }
 
-    int lock = pthread_mutex_trylock(&_lock);
-    for (int i = 0; i < self.internalFragmentRanges.count; ++i) {
-        NSRange range = [self.internalFragmentRanges[i] rangeValue];
-        if (NSLocationInRange(position, range)) {
-            return range;
-        }
-    }
-    if (!lock) {
-        pthread_mutex_unlock(&_lock);
-    }
-    return JPInvalidRange;
+    NSRange range = [self.internalFragmentRanges rangeContainsPosition:position];
+    pthread_mutex_unlock(&_lock);
+    return range;
 }
 
 - (NSRange)firstNotCachedRangeFromPosition:(NSUInteger)position {
+    pthread_mutex_lock(&_lock);
     if (position >= self.fileLength) {
+        pthread_mutex_unlock(&_lock);
         return JPInvalidRange;
     }
 
-    int lock = pthread_mutex_trylock(&_lock);
-    NSRange targetRange = JPInvalidRange;
-    NSUInteger start = position;
-    for (int i = 0; i < self.internalFragmentRanges.count; ++i) {
-        NSRange range = [self.internalFragmentRanges[i] rangeValue];
-        if (NSLocationInRange(start, range)) {
-            start = NSMaxRange(range);
-        }
-        else {
-            if (start >= NSMaxRange(range)) {
-                continue;
-            }
-            else {
-                targetRange = NSMakeRange(start, range.location - start);
-            }
-        }
+    NSRange targetRange = [self.internalFragmentRanges firstGapFromPosition:position
+                                                                 upperBound:self.fileLength];
+    pthread_mutex_unlock(&_lock);
+    return targetRange;
+}
+
+- (NSArray<NSValue *> *)cachedRangesInRange:(NSRange)range {
+    pthread_mutex_lock(&_lock);
+    JPVideoPlayerRangeSet *cachedRanges = [self.internalFragmentRanges rangeSetInRange:range];
+    pthread_mutex_unlock(&_lock);
+    return cachedRanges.ranges;
+}
+
+- (NSArray<NSValue *> *)missingRangesInRange:(NSRange)range {
+    pthread_mutex_lock(&_lock);
+    JPVideoPlayerRangeSet *missingRanges = [self.internalFragmentRanges complementRangeSetInRange:range];
+    pthread_mutex_unlock(&_lock);
+    return missingRanges.ranges;
+}
+
+- (BOOL)isBlockCachedAtPosition:(NSUInteger)position {
+    pthread_mutex_lock(&_lock);
+    BOOL cached = [self.blockBitmap containsPosition:position];
+    pthread_mutex_unlock(&_lock);
+    return cached;
+}
+
+- (NSUInteger)firstNotCachedBlockPositionFromPosition:(NSUInteger)position {
+    pthread_mutex_lock(&_lock);
+    NSUInteger index = [self.blockBitmap firstClearBlockFromIndex:position / JPVideoPlayerCacheFileBlockSize];
+    pthread_mutex_unlock(&_lock);
+    return index == NSNotFound ? NSNotFound : index * JPVideoPlayerCacheFileBlockSize;
+}
+
+- (NSUInteger)evictBlocksInRange:(NSRange)range {
+    // hold the write lock until the hole punched, so no data is stored to the range before that.
+    pthread_mutex_lock(&_writeLock);
+    [self flushWriteBuffer];
+    pthread_mutex_lock(&_lock);
+    NSRange blockRange = [self.blockBitmap blockRangeOverlapByteRange:range];
+    if (!blockRange.length) {
+        pthread_mutex_unlock(&_lock);
+        pthread_mutex_unlock(&_writeLock);
+        return 0;
     }
 
-    if (start < self.fileLength) {
-        targetRange = NSMakeRange(start, self.fileLength - start);
+    NSRange byteRange = [self.blockBitmap byteRangeForBlockRange:blockRange];
+    NSUInteger evictedCount = self.blockBitmap.setBlockCount;
+    [self.blockBitmap clearBlocksInRange:blockRange];
+    evictedCount -= self.blockBitmap.setBlockCount;
+    [self.checksumBitmap clearBlocksInRange:blockRange];
+    [self.verifiedBitmap clearBlocksInRange:blockRange];
+    [self.internalFragmentRanges removeRange:byteRange];
+    [self.pendingJournalRanges removeRange:byteRange];
+    [self.pendingJournalChecksums removeIndexesInRange:blockRange];
+    // the journal only record added ranges, so rewrite the whole index on next synchronize.
+    self.indexNeedsCompaction = YES;
+    self.mapping = nil;
+    [self checkIsCompleted];
+    pthread_mutex_unlock(&_lock);
+
+    // commit order: the index without the range must be durable before the data dropped,
+    // or the zero bytes in hole are served as cached data after a crash.
+    if ([self synchronize]) {
+        [self punchHoleInRange:byteRange];
     }
-    if (!lock) {
-        pthread_mutex_unlock(&_lock);
+    else {
+        JPWarningLog(@"Synchronize index failed, keep the data of evicted range: %@", NSStringFromRange(byteRange));
     }
-    return targetRange;
+    pthread_mutex_unlock(&_writeLock);
+    JPDebugLog(@"Did evict %ld blocks in range: %@", evictedCount, NSStringFromRange(byteRange));
+    return evictedCount;
+}
+
+- (void)rebuildBlockBitmap {
+    pthread_mutex_lock(&_lock);
+    self.blockBitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:self.fileLength
+                                                              blockSize:JPVideoPlayerCacheFileBlockSize];
+    for (NSUInteger i = 0; i < self.internalFragmentRanges.count; i++) {
+        NSRange range = [self.internalFragmentRanges rangeAtIndex:i];
+        [self.blockBitmap setBlocksInRange:[self.blockBitmap blockRangeInsideByteRange:range]];
+    }
+    pthread_mutex_unlock(&_lock);
 }
 
 - (void)checkIsCompleted {
-    int lock = pthread_mutex_trylock(&_lock);
+    pthread_mutex_lock(&_lock);
     self.completed = NO;
-    if (self.internalFragmentRanges && self.internalFragmentRanges.count == 1) {
-        NSRange range = [self.internalFragmentRanges[0] rangeValue];
+    if (self.internalFragmentRanges.count == 1) {
+        NSRange range = [self.internalFragmentRanges rangeAtIndex:0];
         if (range.location == 0 && (range.length == self.fileLength)) {
             self.completed = YES;
         }
     }
 
-    if (!lock) {
-        pthread_mutex_unlock(&_lock);
+    pthread_mutex_unlock(&_lock);
+}
+
+
+#pragma mark - Checksum
+
+/**
+ * Drop all block checksums and prepare the tables for current file length.
+ * Note must call this method in lock.
+ */
+- (void)resetBlockChecksums {
+    self.checksumBitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:self.fileLength
+                                                                 blockSize:JPVideoPlayerCacheFileBlockSize];
+    self.verifiedBitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:self.fileLength
+                                                                 blockSize:JPVideoPlayerCacheFileBlockSize];
+    self.blockChecksums = [NSMutableData dataWithLength:self.checksumBitmap.blockCount * sizeof(uint32_t)];
+    [self.pendingJournalChecksums removeAllIndexes];
+}
+
+/**
+ * Note must call this method in lock.
+ */
+- (void)setChecksum:(uint32_t)checksum
+    forBlockAtIndex:(NSUInteger)index {
+    if (index >= self.checksumBitmap.blockCount) {
+        return;
     }
+
+    ((uint32_t *)self.blockChecksums.mutableBytes)[index] = checksum;
+    [self.checksumBitmap setBlocksInRange:NSMakeRange(index, 1)];
+}
+
+/**
+ * The checksum table of index file, every entry is a pair of block index and checksum in host byte order.
+ * Note must call this method in lock.
+ */
+- (NSData *)blockChecksumTable {
+    NSMutableData *table = [NSMutableData dataWithCapacity:self.checksumBitmap.setBlockCount * 2 * sizeof(uint32_t)];
+    const uint32_t *checksums = self.blockChecksums.bytes;
+    NSUInteger index = [self.checksumBitmap firstSetBlockFromIndex:0];
+    while (index != NSNotFound) {
+        uint32_t entry[2] = {(uint32_t)index, checksums[index]};
+        [table appendBytes:entry length:sizeof(entry)];
+        index = [self.checksumBitmap firstSetBlockFromIndex:index + 1];
+    }
+    return table;
+}
+
+- (BOOL)computeChecksum:(uint32_t *)checksum
+            ofByteRange:(NSRange)range
+                mapping:(JPVideoPlayerCacheFileMapping *)mapping {
+    if (mapping && NSMaxRange(range) <= mapping.length) {
+        *checksum = JPCRC32CUpdate(0, mapping.bytes + range.location, range.length);
+        return YES;
+    }
+
+    void *buffer = malloc(range.length);
+    if (!buffer) {
+        return NO;
+    }
+    BOOL success = JPVideoPlayerCacheFilePositionalRead(self.fileDescriptor, buffer, range.length, (off_t)range.location);
+    if (success) {
+        *checksum = JPCRC32CUpdate(0, buffer, range.length);
+    }
+    free(buffer);
+    return success;
+}
+
+/**
+ * Compute the checksum of the blocks become fully cached by the bytes just written.
+ * The blocks inside the bytes are computed from memory, the blocks across the edge of bytes are read back from file.
+ *
+ * @param bytes The bytes just written.
+ * @param range The range of bytes in video data file.
+ */
+- (void)computeChecksumsWithBytes:(const uint8_t *)bytes
+                            range:(NSRange)range {
+    pthread_mutex_lock(&_lock);
+    JPVideoPlayerBlockBitmap *blockBitmap = self.blockBitmap;
+    NSRange blockRange = [blockBitmap blockRangeOverlapByteRange:range];
+    NSMutableIndexSet *blockIndexes = [NSMutableIndexSet indexSet];
+    for (NSUInteger index = blockRange.location; index < NSMaxRange(blockRange); index++) {
+        if ([blockBitmap isBlockSetAtIndex:index] && ![self.checksumBitmap isBlockSetAtIndex:index]) {
+            [blockIndexes addIndex:index];
+        }
+    }
+    pthread_mutex_unlock(&_lock);
+
+    // compute out of the index lock, so readers never wait for it.
+    [blockIndexes enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+        NSRange blockByteRange = [blockBitmap byteRangeForBlockRange:NSMakeRange(index, 1)];
+        uint32_t checksum = 0;
+        if (blockByteRange.location >= range.location && NSMaxRange(blockByteRange) <= NSMaxRange(range)) {
+            checksum = JPCRC32CUpdate(0, bytes + (blockByteRange.location - range.location), blockByteRange.length);
+        }
+        else if (![self computeChecksum:&checksum ofByteRange:blockByteRange mapping:nil]) {
+            JPWarningLog(@"Read block for checksum failed, errno: %d", errno);
+            return;
+        }
+
+        pthread_mutex_lock(&self->_lock);
+        // the block maybe evicted or the file truncated while computing.
+        if (self.blockBitmap == blockBitmap && [blockBitmap isBlockSetAtIndex:index]) {
+            [self setChecksum:checksum forBlockAtIndex:index];
+            [self.pendingJournalChecksums addIndex:index];
+        }
+        pthread_mutex_unlock(&self->_lock);
+    }];
+}
+
+/**
+ * Verify the blocks overlap given range which are not verified yet, and evict the first corrupt block.
+ *
+ * @param range   A cached range.
+ * @param mapping The memory mapping of video data file, nil if not mapped.
+ *
+ * @return The length of the head of range which is safe to serve.
+ */
+- (NSUInteger)verifiedLengthOfRange:(NSRange)range
+                            mapping:(JPVideoPlayerCacheFileMapping *)mapping {
+    pthread_mutex_lock(&_lock);
+    JPVideoPlayerBlockBitmap *checksumBitmap = self.checksumBitmap;
+    NSRange blockRange = [checksumBitmap blockRangeOverlapByteRange:range];
+    NSMutableIndexSet *blockIndexes = [NSMutableIndexSet indexSet];
+    for (NSUInteger index = blockRange.location; index < NSMaxRange(blockRange); index++) {
+        if ([checksumBitmap isBlockSetAtIndex:index] && ![self.verifiedBitmap isBlockSetAtIndex:index]) {
+            [blockIndexes addIndex:index];
+        }
+    }
+    pthread_mutex_unlock(&_lock);
+
+    __block NSUInteger verifiedLength = range.length;
+    [blockIndexes enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+        NSRange blockByteRange = [checksumBitmap byteRangeForBlockRange:NSMakeRange(index, 1)];
+        uint32_t checksum = 0;
+        if (![self computeChecksum:&checksum ofByteRange:blockByteRange mapping:mapping]) {
+            JPWarningLog(@"Read block for verify failed, errno: %d", errno);
+            return;
+        }
+
+        pthread_mutex_lock(&self->_lock);
+        BOOL corrupt = NO;
+        if (self.checksumBitmap == checksumBitmap && [checksumBitmap isBlockSetAtIndex:index]) {
+            corrupt = ((const uint32_t *)self.blockChecksums.bytes)[index] != checksum;
+            if (!corrupt) {
+                [self.verifiedBitmap setBlocksInRange:NSMakeRange(index, 1)];
+            }
+        }
+        pthread_mutex_unlock(&self->_lock);
+        if (corrupt) {
+            JPWarningLog(@"The checksum of block %ld mismatch, evict it", index);
+            [self evictBlocksInRange:blockByteRange];
+            verifiedLength = blockByteRange.location > range.location ? blockByteRange.location - range.location : 0;
+            *stop = YES;
+        }
+    }];
+    return verifiedLength;
 }
 
 
@@ -258,46 +788,98 @@ static const NSString *kJPVideoPlayerCacheFileResponseHeadersKey = @"com.newpan.
 
 - (BOOL)truncateFileWithFileLength:(NSUInteger)fileLength {
     JPDebugLog(@"Truncate file to length: %u", fileLength);
-    if (!self.writeFileHandle) {
+    if (self.fileDescriptor < 0) {
         return NO;
     }
 
-    int lock = pthread_mutex_trylock(&_lock);
+    pthread_mutex_lock(&_lock);
     self.fileLength = fileLength;
-    @try {
-        [self.writeFileHandle truncateFileAtOffset:self.fileLength * sizeof(Byte)];
-        unsigned long long end = [self.writeFileHandle seekToEndOfFile];
-        if (end != self.fileLength) {
-            if (!lock) {
-                pthread_mutex_unlock(&_lock);
-            }
-            return NO;
-        }
+    self.indexNeedsCompaction = YES;
+    self.mapping = nil;
+    self.mappingUnavailable = NO;
+    self.streamingOnly = NO;
+    [self rebuildBlockBitmap];
+    [self resetBlockChecksums];
+    if (ftruncate(self.fileDescriptor, (off_t)fileLength) != 0) {
+        JPErrorLog(@"Truncate file failed, errno: %d", errno);
+        pthread_mutex_unlock(&_lock);
+        return NO;
     }
-    @catch (NSException * e) {
-        JPErrorLog(@"Truncate file raise a exception: %@", e);
-        if (!lock) {
-            pthread_mutex_unlock(&_lock);
-        }
+    pthread_mutex_unlock(&_lock);
+    return YES;
+}
+
+- (BOOL)preallocateDiskSpaceWithLength:(NSUInteger)length {
+    if (self.fileDescriptor < 0 || length == 0) {
         return NO;
     }
-    if (!lock) {
-        pthread_mutex_unlock(&_lock);
+
+    // try to reserve contiguous extents first, then any extents.
+    fstore_t store = {F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)length, 0};
+    int result = fcntl(self.fileDescriptor, F_PREALLOCATE, &store);
+    if (result == -1) {
+        store.fst_flags = F_ALLOCATEALL;
+        result = fcntl(self.fileDescriptor, F_PREALLOCATE, &store);
+    }
+    if (result == -1) {
+        JPErrorLog(@"Preallocate file failed, errno: %d", errno);
+        return NO;
+    }
+
+    // F_PREALLOCATE do not change the file size, keep the logic length.
+    if (ftruncate(self.fileDescriptor, (off_t)length) != 0) {
+        JPErrorLog(@"Truncate file failed, errno: %d", errno);
+        return NO;
     }
+    JPDebugLog(@"Did preallocate %ld bytes for video data file", store.fst_bytesalloc);
     return YES;
 }
 
+- (void)punchHoleInRange:(NSRange)range {
+#ifdef F_PUNCHHOLE
+    // release the disk space of evicted blocks, the file length is not changed.
+    // the last block maybe not aligned to the block size of file system, it is ok to fail.
+    fpunchhole_t punchhole = {0, 0, (off_t)range.location, (off_t)range.length};
+    if (fcntl(self.fileDescriptor, F_PUNCHHOLE, &punchhole) == -1) {
+        JPDebugLog(@"Punch hole failed, errno: %d", errno);
+    }
+#endif
+}
+
 - (void)removeCache {
+    pthread_mutex_lock(&_lock);
+    self.mapping = nil;
+    pthread_mutex_unlock(&_lock);
+    pthread_mutex_lock(&_commitLock);
+    [self closeJournal];
+    pthread_mutex_unlock(&_commitLock);
     [[NSFileManager defaultManager] removeItemAtPath:self.cacheFilePath error:NULL];
     [[NSFileManager defaultManager] removeItemAtPath:self.indexFilePath error:NULL];
+    [[NSFileManager defaultManager] removeItemAtPath:self.journalFilePath error:NULL];
 }
 
 - (BOOL)storeResponse:(NSHTTPURLResponse *)response {
     BOOL success = YES;
-    if (![self isFileLengthValid]) {
+    NSDictionary *responseHeaders = [[response allHeaderFields] copy];
+    pthread_mutex_lock(&_lock);
+    BOOL fileLengthChanged = ![self isFileLengthValid];
+    if (!fileLengthChanged && [self.responseHeaders isEqualToDictionary:responseHeaders]) {
+        // nothing to rewrite, the journal keep appending.
+        pthread_mutex_unlock(&_lock);
+        return YES;
+    }
+
+    if (fileLengthChanged) {
         success = [self truncateFileWithFileLength:(NSUInteger)response.jp_fileLength];
+        if (success && self.preallocatesDiskSpace && ![self preallocateDiskSpaceWithLength:self.fileLength]) {
+            JPWarningLog(@"Reserve disk space failed, fall back to streaming only cache with size: %ld", self.streamingOnlyCacheSize);
+            self.streamingOnly = YES;
+        }
     }
-    self.responseHeaders = [[response allHeaderFields] copy];
+    self.responseHeaders = responseHeaders;
+    // the file length and response headers live in index file only, the journal can not record them.
+    self.indexNeedsCompaction = YES;
+    pthread_mutex_unlock(&_lock);
     success = success && [self synchronize];
     return success;
 }
@@ -305,154 +887,810 @@ static const NSString *kJPVideoPlayerCacheFileResponseHeadersKey = @"com.newpan.
 - (void)storeVideoData:(NSData *)data
               atOffset:(NSUInteger)offset
            synchronize:(BOOL)synchronize
-      storedCompletion:(dispatch_block_t)completion {
-    if (!self.writeFileHandle) {
-        JPErrorLog(@"self.writeFileHandle is nil");
+      storedCompletion:(void (^)(NSError *error))completion {
+    if (self.fileDescriptor < 0) {
+        JPErrorLog(@"self.fileDescriptor is invalid");
+        if (completion) {
+            completion([self storeVideoDataErrorWithErrno:EBADF]);
+        }
+        return;
     }
-    @try {
-        [self.writeFileHandle seekToFileOffset:offset];
-        [self.writeFileHandle jp_safeWriteData:data];
+    if (!data.length) {
+        return;
     }
-    @catch (NSException * e) {
-        JPErrorLog(@"Write file raise a exception: %@", e);
+
+    NSError *droppedError = nil;
+    if (self.isStreamingOnly) {
+        // only cache the head of video, the rest is streamed to player without cache.
+        // tell the caller the data is dropped, the internal tasks downloading into cache file stop by it.
+        NSUInteger budget = self.streamingOnlyCacheSize;
+        if (offset + data.length > budget) {
+            droppedError = [self cacheSizeExceededError];
+        }
+        if (offset >= budget) {
+            if(completion){
+                completion(droppedError);
+            }
+            return;
+        }
+        if (droppedError) {
+            data = [data subdataWithRange:NSMakeRange(0, budget - offset)];
+        }
     }
 
-    [self addRange:NSMakeRange(offset, [data length])
-        completion:completion];
+    pthread_mutex_lock(&_writeLock);
+    if (self.writeBuffer.length && offset != self.writeBufferOffset + self.writeBuffer.length) {
+        // not contiguous with the buffered data, write the buffered data first.
+        [self writeBufferedDataWithLength:self.writeBuffer.length];
+    }
+    if (!self.writeBuffer.length) {
+        self.writeBufferOffset = offset;
+    }
+    [self.writeBuffer appendData:data];
+    // write to the last aligned boundary, so the writes after the first one are all aligned.
+    NSUInteger bufferEnd = self.writeBufferOffset + self.writeBuffer.length;
+    NSUInteger alignedEnd = bufferEnd / kJPVideoPlayerCacheFileWriteBufferSize * kJPVideoPlayerCacheFileWriteBufferSize;
+    if (alignedEnd > self.writeBufferOffset) {
+        [self writeBufferedDataWithLength:alignedEnd - self.writeBufferOffset];
+    }
+    NSError *error = self.writeError ?: droppedError;
+    self.writeError = nil;
+    pthread_mutex_unlock(&_writeLock);
+
+    if(completion){
+        completion(error);
+    }
     if (synchronize) {
         [self synchronize];
     }
 }
 
+- (void)flushWriteBuffer {
+    pthread_mutex_lock(&_writeLock);
+    [self writeBufferedDataWithLength:self.writeBuffer.length];
+    pthread_mutex_unlock(&_writeLock);
+}
+
+/**
+ * Write the head of write buffer to disk, then commit the range of it to index.
+ * Note must call this method in write lock.
+ */
+- (void)writeBufferedDataWithLength:(NSUInteger)length {
+    if (!length) {
+        return;
+    }
+
+    NSUInteger offset = self.writeBufferOffset;
+    BOOL success = JPVideoPlayerCacheFilePositionalWrite(self.fileDescriptor, self.writeBuffer.bytes, length, (off_t)offset);
+    if (success) {
+        // the range is added after the bytes are in file, so readers never see a range without data.
+        [self addRange:NSMakeRange(offset, length)
+            completion:nil];
+        if (self.verifiesChecksum) {
+            [self computeChecksumsWithBytes:self.writeBuffer.bytes
+                                      range:NSMakeRange(offset, length)];
+        }
+    }
+    else {
+        // the range is never added, so the partly written bytes are not served, and the caller is told.
+        JPErrorLog(@"Write file failed, errno: %d", errno);
+        if (!self.writeError) {
+            self.writeError = [self storeVideoDataErrorWithErrno:errno];
+        }
+    }
+    [self.writeBuffer replaceBytesInRange:NSMakeRange(0, length) withBytes:NULL length:0];
+    self.writeBufferOffset += length;
+}
+
+- (NSError *)storeVideoDataErrorWithErrno:(int)errorNumber {
+    return [NSError errorWithDomain:JPVideoPlayerErrorDomain
+                               code:JPVideoPlayerErrorCodeStoreVideoDataFailed
+                           userInfo:@{
+                                   NSLocalizedDescriptionKey : @"Write video data to cache file failed",
+                                   NSUnderlyingErrorKey : [NSError errorWithDomain:NSPOSIXErrorDomain code:errorNumber userInfo:nil]
+                           }];
+}
+
+- (NSError *)cacheSizeExceededError {
+    return [NSError errorWithDomain:JPVideoPlayerErrorDomain
+                               code:JPVideoPlayerErrorCodeCacheSizeExceeded
+                           userInfo:@{
+                                   NSLocalizedDescriptionKey : @"The video data is beyond the size of cache"
+                           }];
+}
+
+- (void)applicationDidEnterBackground {
+    if (self.writeBuffer.length) {
+        [self synchronize];
+    }
+}
+
 
 #pragma mark - read data
 
 - (NSData *)dataWithRange:(NSRange)range {
-    if (!JPValidFileRange(range)) {
+    if (!JPValidFileRange(range) || self.fileDescriptor < 0) {
         return nil;
     }
 
-    if (self.readOffset != range.location) {
-        [self seekToPosition:range.location];
+    NSRange cachedRange = [self cachedRangeForRange:range];
+    if (!JPValidFileRange(cachedRange) || cachedRange.location != range.location) {
+        return nil;
+    }
+
+    JPVideoPlayerCacheFileMapping *mapping = [self fetchMappingIfCompleted];
+    if (self.verifiesChecksum) {
+        // serve the head before the first corrupt block, the corrupt block is evicted and need fetch from web again.
+        cachedRange.length = [self verifiedLengthOfRange:cachedRange mapping:mapping];
+        if (!cachedRange.length) {
+            return nil;
+        }
+    }
+    if (mapping && NSMaxRange(cachedRange) <= mapping.length) {
+        // hand out a view over the mapping, the deallocator keep the mapping alive as long as the data.
+        return [[NSData alloc] initWithBytesNoCopy:(void *)(mapping.bytes + cachedRange.location)
+                                            length:cachedRange.length
+                                       deallocator:^(void *bytes, NSUInteger length) {
+                                           [mapping self];
+                                       }];
     }
 
-    return [self readDataWithLength:range.length];
+    NSMutableData *data = [NSMutableData dataWithLength:cachedRange.length];
+    if (!JPVideoPlayerCacheFilePositionalRead(self.fileDescriptor, data.mutableBytes, cachedRange.length, (off_t)cachedRange.location)) {
+        JPErrorLog(@"Read file failed, errno: %d", errno);
+        return nil;
+    }
+    return data;
 }
 
-- (NSData *)readDataWithLength:(NSUInteger)length {
-    NSRange range = [self cachedRangeForRange:NSMakeRange(self.readOffset, length)];
-    if (JPValidFileRange(range)) {
-        int lock = pthread_mutex_trylock(&_lock);
-        NSData *data = [self.readFileHandle readDataOfLength:range.length];
-        self.readOffset += [data length];
-        if (!lock) {
-            pthread_mutex_unlock(&_lock);
-        }
-        return data;
+- (JPVideoPlayerCacheFileMapping *)fetchMappingIfCompleted {
+    pthread_mutex_lock(&_lock);
+    if (!self.completed || self.mappingUnavailable) {
+        pthread_mutex_unlock(&_lock);
+        return nil;
     }
-    return nil;
+
+    if (!self.mapping) {
+        self.mapping = [JPVideoPlayerCacheFileMapping mappingWithFileDescriptor:self.fileDescriptor
+                                                                         length:self.fileLength];
+        self.mappingUnavailable = self.mapping == nil;
+    }
+    JPVideoPlayerCacheFileMapping *mapping = self.mapping;
+    pthread_mutex_unlock(&_lock);
+    return mapping;
+}
+
+- (NSData *)readDataWithLength:(NSUInteger)length {
+    // read out of the index lock, evict a corrupt block take the write lock, which must be taken before the index lock.
+    pthread_mutex_lock(&_lock);
+    NSUInteger readOffset = self.readOffset;
+    pthread_mutex_unlock(&_lock);
+    NSData *data = [self dataWithRange:NSMakeRange(readOffset, length)];
+    pthread_mutex_lock(&_lock);
+    self.readOffset = readOffset + data.length;
+    pthread_mutex_unlock(&_lock);
+    return data;
 }
 
 
 #pragma mark - seek
 
 - (void)seekToPosition:(NSUInteger)position {
-    int lock = pthread_mutex_trylock(&_lock);
-    [self.readFileHandle seekToFileOffset:position];
-    self.readOffset = (NSUInteger)self.readFileHandle.offsetInFile;
-    if (!lock) {
-        pthread_mutex_unlock(&_lock);
-    }
+    pthread_mutex_lock(&_lock);
+    self.readOffset = position;
+    pthread_mutex_unlock(&_lock);
 }
 
 - (void)seekToEnd {
-    int lock = pthread_mutex_trylock(&_lock);
-    [self.readFileHandle seekToEndOfFile];
-    self.readOffset = (NSUInteger)self.readFileHandle.offsetInFile;
-    if (!lock) {
-        pthread_mutex_unlock(&_lock);
-    }
+    pthread_mutex_lock(&_lock);
+    self.readOffset = self.fileLength;
+    pthread_mutex_unlock(&_lock);
 }
 
 
 #pragma mark - Index
 
-- (BOOL)serializeIndex:(NSDictionary *)indexDictionary {
++ (BOOL)upgradeLegacyIndexFileAtPath:(NSString *)indexFilePath {
+    if (!indexFilePath.length) {
+        return NO;
+    }
+
+    // hold the lock until the index file written, so no cache file open it meanwhile.
+    pthread_mutex_lock(&JPVideoPlayerOpenedCacheFilesLock);
+    BOOL success = [self internalUpgradeLegacyIndexFileAtPath:indexFilePath];
+    pthread_mutex_unlock(&JPVideoPlayerOpenedCacheFilesLock);
+    return success;
+}
+
+/**
+ * Note must call this method in the lock of opened cache files.
+ */
++ (BOOL)internalUpgradeLegacyIndexFileAtPath:(NSString *)indexFilePath {
+    for (JPVideoPlayerCacheFile *cacheFile in JPVideoPlayerOpenedCacheFiles) {
+        if ([cacheFile.indexFilePath isEqualToString:indexFilePath]) {
+            // the opened cache file may have compacted the index and own a journal, an upgrade would revert them.
+            JPDebugLog(@"Skip upgrading the index file opened: %@", indexFilePath);
+            return NO;
+        }
+    }
+
+    NSData *data = [NSData dataWithContentsOfFile:indexFilePath];
+    NSUInteger fileLength = 0;
+    uint64_t generation = 0;
+    uint16_t flags = 0;
+    NSDictionary *responseHeaders = nil;
+    JPVideoPlayerRangeSet *fragmentRanges = [JPVideoPlayerRangeSet new];
+    BOOL isLegacyIndex = NO;
+    BOOL success = [self parseIndexData:data
+                             fileLength:&fileLength
+                             generation:&generation
+                                  flags:&flags
+                        responseHeaders:&responseHeaders
+                         fragmentRanges:fragmentRanges
+                         blockChecksums:nil
+                               isLegacy:&isLegacyIndex];
+    if (!success || !isLegacyIndex) {
+        return NO;
+    }
+
+    NSData *indexData = [self indexDataWithFileLength:fileLength
+                                           generation:generation
+                                                flags:flags
+                                      responseHeaders:responseHeaders
+                                       fragmentRanges:fragmentRanges
+                                       blockChecksums:nil];
+    return [indexData writeToFile:indexFilePath atomically:YES];
+}
+
+- (BOOL)readIndexFromData:(NSData *)data
+                 isLegacy:(BOOL *)isLegacy {
+    NSUInteger fileLength = 0;
+    uint64_t generation = 0;
+    uint16_t flags = 0;
+    NSDictionary *responseHeaders = nil;
+    JPVideoPlayerRangeSet *fragmentRanges = [JPVideoPlayerRangeSet new];
+    NSMutableData *blockChecksums = [NSMutableData data];
+    BOOL success = [JPVideoPlayerCacheFile parseIndexData:data
+                                               fileLength:&fileLength
+                                               generation:&generation
+                                                    flags:&flags
+                                          responseHeaders:&responseHeaders
+                                           fragmentRanges:fragmentRanges
+                                           blockChecksums:blockChecksums
+                                                 isLegacy:isLegacy];
+    if (!success) {
+        return NO;
+    }
+
+    pthread_mutex_lock(&_lock);
+    self.fileLength = fileLength;
+    self.generation = generation;
+    self.streamingOnly = (flags & kJPVideoPlayerCacheIndexFlagStreamingOnly) != 0;
+    self.internalFragmentRanges = fragmentRanges;
+    self.responseHeaders = responseHeaders;
+    [self resetBlockChecksums];
+    const uint32_t *entries = blockChecksums.bytes;
+    for (NSUInteger i = 0; i < blockChecksums.length / (2 * sizeof(uint32_t)); i++) {
+        [self setChecksum:entries[i * 2 + 1] forBlockAtIndex:entries[i * 2]];
+    }
+    pthread_mutex_unlock(&_lock);
+    return YES;
+}
+
+/**
+ * Parse the index file.
+ *
+ * @param blockChecksums The output of block checksum table, every entry is a pair of block index and checksum
+ *                       in host byte order, pass nil if do not care.
+ */
++ (BOOL)parseIndexData:(NSData *)data
+            fileLength:(NSUInteger *)fileLength
+            generation:(uint64_t *)generation
+                 flags:(uint16_t *)flags
+       responseHeaders:(NSDictionary **)responseHeaders
+        fragmentRanges:(JPVideoPlayerRangeSet *)fragmentRanges
+        blockChecksums:(NSMutableData *)blockChecksums
+              isLegacy:(BOOL *)isLegacy {
+    if (isLegacy) {
+        *isLegacy = NO;
+    }
+    *generation = 0;
+    *flags = 0;
+    if (data.length < sizeof(uint32_t)) {
+        return NO;
+    }
+
+    uint32_t magic = 0;
+    memcpy(&magic, data.bytes, sizeof(uint32_t));
+    if (CFSwapInt32LittleToHost(magic) == kJPVideoPlayerCacheIndexMagic) {
+        return [self parseBinaryIndexData:data
+                               fileLength:fileLength
+                               generation:generation
+                                    flags:flags
+                          responseHeaders:responseHeaders
+                           fragmentRanges:fragmentRanges
+                           blockChecksums:blockChecksums];
+    }
+
+    // the index file written by version before 3.2.0 is a JSON string.
+    NSDictionary *indexDictionary = [NSJSONSerialization JSONObjectWithData:data
+                                                                    options:NSJSONReadingAllowFragments
+                                                                      error:nil];
     if (![indexDictionary isKindOfClass:[NSDictionary class]]) {
         return NO;
     }
 
-    int lock = pthread_mutex_trylock(&_lock);
     NSNumber *fileSize = indexDictionary[kJPVideoPlayerCacheFileSizeKey];
-    if (fileSize && [fileSize isKindOfClass:[NSNumber class]]) {
-        self.fileLength = [fileSize unsignedIntegerValue];
+    if (![fileSize isKindOfClass:[NSNumber class]] || [fileSize unsignedIntegerValue] == 0) {
+        return NO;
     }
 
-    if (self.fileLength == 0) {
-        if (!lock) {
-            pthread_mutex_unlock(&_lock);
+    *fileLength = [fileSize unsignedIntegerValue];
+    NSArray *rangeArray = indexDictionary[kJPVideoPlayerCacheFileZoneKey];
+    if ([rangeArray isKindOfClass:[NSArray class]]) {
+        for (NSString *rangeStr in rangeArray) {
+            if (![rangeStr isKindOfClass:[NSString class]]) {
+                continue;
+            }
+            [fragmentRanges addRange:NSRangeFromString(rangeStr)];
         }
+    }
+    NSDictionary *headers = indexDictionary[kJPVideoPlayerCacheFileResponseHeadersKey];
+    *responseHeaders = [headers isKindOfClass:[NSDictionary class]] ? headers : nil;
+    if (isLegacy) {
+        *isLegacy = YES;
+    }
+    return YES;
+}
+
++ (BOOL)parseBinaryIndexData:(NSData *)data
+                  fileLength:(NSUInteger *)fileLength
+                  generation:(uint64_t *)generation
+                       flags:(uint16_t *)flags
+             responseHeaders:(NSDictionary **)responseHeaders
+              fragmentRanges:(JPVideoPlayerRangeSet *)fragmentRanges
+              blockChecksums:(NSMutableData *)blockChecksums {
+    const uint8_t *bytes = data.bytes;
+    NSUInteger length = data.length;
+    if (length < sizeof(JPVideoPlayerCacheIndexHeaderV1) + sizeof(uint32_t)) {
         return NO;
     }
 
-    [self.internalFragmentRanges removeAllObjects];
-    NSMutableArray *rangeArray = indexDictionary[kJPVideoPlayerCacheFileZoneKey];
-    for (NSString *rangeStr in rangeArray) {
-        NSRange range = NSRangeFromString(rangeStr);
-        [self.internalFragmentRanges addObject:[NSValue valueWithRange:range]];
+    JPVideoPlayerCacheIndexHeader header;
+    size_t headerSize = sizeof(JPVideoPlayerCacheIndexHeader);
+    uint16_t version = 0;
+    memcpy(&version, bytes + offsetof(JPVideoPlayerCacheIndexHeader, version), sizeof(uint16_t));
+    version = CFSwapInt16LittleToHost(version);
+    if (version == 1) {
+        JPVideoPlayerCacheIndexHeaderV1 headerV1;
+        memcpy(&headerV1, bytes, sizeof(JPVideoPlayerCacheIndexHeaderV1));
+        header.fileLength = headerV1.fileLength;
+        header.flags = 0;
+        header.generation = 0;
+        header.headerBlobLength = headerV1.headerBlobLength;
+        header.rangeCount = headerV1.rangeCount;
+        header.blockSize = 0;
+        header.blockChecksumCount = 0;
+        headerSize = sizeof(JPVideoPlayerCacheIndexHeaderV1);
     }
-    self.responseHeaders = indexDictionary[kJPVideoPlayerCacheFileResponseHeadersKey];
-    if (!lock) {
-        pthread_mutex_unlock(&_lock);
+    else if (version == 2 && length >= sizeof(JPVideoPlayerCacheIndexHeaderV2) + sizeof(uint32_t)) {
+        JPVideoPlayerCacheIndexHeaderV2 headerV2;
+        memcpy(&headerV2, bytes, sizeof(JPVideoPlayerCacheIndexHeaderV2));
+        header.flags = 0;
+        header.fileLength = headerV2.fileLength;
+        header.generation = headerV2.generation;
+        header.headerBlobLength = headerV2.headerBlobLength;
+        header.rangeCount = headerV2.rangeCount;
+        header.blockSize = 0;
+        header.blockChecksumCount = 0;
+        headerSize = sizeof(JPVideoPlayerCacheIndexHeaderV2);
+    }
+    else if (version == kJPVideoPlayerCacheIndexVersion && length >= sizeof(JPVideoPlayerCacheIndexHeader) + sizeof(uint32_t)) {
+        memcpy(&header, bytes, sizeof(JPVideoPlayerCacheIndexHeader));
+    }
+    else {
+        JPWarningLog(@"Unknown index file version: %u", version);
+        return NO;
+    }
+
+    uint64_t length64 = CFSwapInt64LittleToHost(header.fileLength);
+    uint32_t headerBlobLength = CFSwapInt32LittleToHost(header.headerBlobLength);
+    uint32_t rangeCount = CFSwapInt32LittleToHost(header.rangeCount);
+    uint32_t blockChecksumCount = CFSwapInt32LittleToHost(header.blockChecksumCount);
+    uint64_t expectedLength = headerSize + (uint64_t)headerBlobLength + (uint64_t)rangeCount * 2 * sizeof(uint64_t) +
+            (uint64_t)blockChecksumCount * 2 * sizeof(uint32_t) + sizeof(uint32_t);
+    if (expectedLength != length || length64 == 0 || length64 > NSUIntegerMax) {
+        return NO;
+    }
+
+    uint32_t checksum = 0;
+    memcpy(&checksum, bytes + length - sizeof(uint32_t), sizeof(uint32_t));
+    if (CFSwapInt32LittleToHost(checksum) != JPVideoPlayerCacheIndexChecksum(bytes, length - sizeof(uint32_t))) {
+        JPWarningLog(@"The checksum of index file mismatch");
+        return NO;
+    }
+
+    *responseHeaders = nil;
+    if (headerBlobLength > 0) {
+        NSData *headerBlob = [data subdataWithRange:NSMakeRange(headerSize, headerBlobLength)];
+        id headers = [NSPropertyListSerialization propertyListWithData:headerBlob
+                                                               options:NSPropertyListImmutable
+                                                                format:NULL
+                                                                 error:nil];
+        if ([headers isKindOfClass:[NSDictionary class]]) {
+            *responseHeaders = headers;
+        }
+    }
+
+    *fileLength = (NSUInteger)length64;
+    *generation = CFSwapInt64LittleToHost(header.generation);
+    *flags = CFSwapInt16LittleToHost(header.flags);
+    const uint8_t *rangeTable = bytes + headerSize + headerBlobLength;
+    for (uint32_t i = 0; i < rangeCount; i++) {
+        uint64_t bounds[2];
+        memcpy(bounds, rangeTable + i * sizeof(bounds), sizeof(bounds));
+        uint64_t start = CFSwapInt64LittleToHost(bounds[0]);
+        uint64_t end = CFSwapInt64LittleToHost(bounds[1]);
+        if (end <= start || end > length64) {
+            continue;
+        }
+        [fragmentRanges addRange:NSMakeRange((NSUInteger)start, (NSUInteger)(end - start))];
+    }
+
+    // the block index is meaningless if the block size changed, drop the checksums.
+    if (!blockChecksums || CFSwapInt32LittleToHost(header.blockSize) != JPVideoPlayerCacheFileBlockSize) {
+        return YES;
+    }
+    const uint8_t *checksumTable = rangeTable + (size_t)rangeCount * 2 * sizeof(uint64_t);
+    for (uint32_t i = 0; i < blockChecksumCount; i++) {
+        uint32_t entry[2];
+        memcpy(entry, checksumTable + i * sizeof(entry), sizeof(entry));
+        entry[0] = CFSwapInt32LittleToHost(entry[0]);
+        entry[1] = CFSwapInt32LittleToHost(entry[1]);
+        [blockChecksums appendBytes:entry length:sizeof(entry)];
     }
     return YES;
 }
 
-- (NSString *)unserializeIndex {
-    int lock = pthread_mutex_trylock(&_lock);
++ (NSData *)indexDataWithFileLength:(NSUInteger)fileLength
+                         generation:(uint64_t)generation
+                              flags:(uint16_t)flags
+                    responseHeaders:(NSDictionary *)responseHeaders
+                     fragmentRanges:(JPVideoPlayerRangeSet *)fragmentRanges
+                     blockChecksums:(NSData *)blockChecksums {
+    NSData *headerBlob = nil;
+    if (responseHeaders) {
+        headerBlob = [NSPropertyListSerialization dataWithPropertyList:responseHeaders
+                                                                format:NSPropertyListBinaryFormat_v1_0
+                                                               options:0
+                                                                 error:nil];
+    }
+
+    JPVideoPlayerCacheIndexHeader header;
+    header.magic = CFSwapInt32HostToLittle(kJPVideoPlayerCacheIndexMagic);
+    header.version = CFSwapInt16HostToLittle(kJPVideoPlayerCacheIndexVersion);
+    header.flags = CFSwapInt16HostToLittle(flags);
+    header.fileLength = CFSwapInt64HostToLittle((uint64_t)fileLength);
+    header.generation = CFSwapInt64HostToLittle(generation);
+    header.headerBlobLength = CFSwapInt32HostToLittle((uint32_t)headerBlob.length);
+    header.rangeCount = CFSwapInt32HostToLittle((uint32_t)fragmentRanges.count);
+    header.blockSize = CFSwapInt32HostToLittle((uint32_t)JPVideoPlayerCacheFileBlockSize);
+    header.blockChecksumCount = CFSwapInt32HostToLittle((uint32_t)(blockChecksums.length / (2 * sizeof(uint32_t))));
+
+    NSUInteger capacity = sizeof(JPVideoPlayerCacheIndexHeader) + headerBlob.length + fragmentRanges.count * 2 * sizeof(uint64_t) +
+            blockChecksums.length + sizeof(uint32_t);
+    NSMutableData *data = [NSMutableData dataWithCapacity:capacity];
+    [data appendBytes:&header length:sizeof(JPVideoPlayerCacheIndexHeader)];
+    if (headerBlob.length) {
+        [data appendData:headerBlob];
+    }
+    for (NSUInteger i = 0; i < fragmentRanges.count; i++) {
+        NSRange range = [fragmentRanges rangeAtIndex:i];
+        uint64_t bounds[2] = {
+                CFSwapInt64HostToLittle((uint64_t)range.location),
+                CFSwapInt64HostToLittle((uint64_t)NSMaxRange(range))
+        };
+        [data appendBytes:bounds length:sizeof(bounds)];
+    }
+    const uint32_t *entries = blockChecksums.bytes;
+    for (NSUInteger i = 0; i < blockChecksums.length / (2 * sizeof(uint32_t)); i++) {
+        uint32_t entry[2] = {
+                CFSwapInt32HostToLittle(entries[i * 2]),
+                CFSwapInt32HostToLittle(entries[i * 2 + 1])
+        };
+        [data appendBytes:entry length:sizeof(entry)];
+    }
+    uint32_t checksum = CFSwapInt32HostToLittle(JPVideoPlayerCacheIndexChecksum(data.bytes, data.length));
+    [data appendBytes:&checksum length:sizeof(uint32_t)];
+    return data;
+}
+
+- (BOOL)synchronize {
+    // flush out of the other locks, the write lock is always taken first.
+    [self flushWriteBuffer];
+    // the commits are serialized by the commit lock, the index lock is only held to take a snapshot of index,
+    // so the readers never wait for the disk.
+    pthread_mutex_lock(&_commitLock);
+    pthread_mutex_lock(&_lock);
+    BOOL needsCompaction = self.indexNeedsCompaction ||
+            self.journalRecordCount + self.pendingJournalRanges.count + self.pendingJournalChecksums.count > kJPVideoPlayerCacheJournalCompactionThreshold;
+    uint64_t generation = 0;
+    NSData *snapshot = needsCompaction ? [self takeIndexSnapshotWithGeneration:&generation] : [self takeJournalSnapshot];
+    pthread_mutex_unlock(&_lock);
+
+    BOOL synchronize = NO;
+    // commit order: the video data must be durable before any index record point to it.
+    // the ranges in snapshot are written before it taken, so the fsync after it cover them.
+    if (self.fileDescriptor >= 0 && fsync(self.fileDescriptor) != 0) {
+        JPErrorLog(@"Synchronize video data file failed, errno: %d", errno);
+    }
+    else if (needsCompaction) {
+        synchronize = [self commitIndexData:snapshot generation:generation];
+    }
+    else {
+        synchronize = [self appendRecordsToJournal:snapshot] || [self compactIndex];
+    }
+    if (!synchronize) {
+        // the pending records in snapshot are not committed, rewrite the whole index on next synchronize.
+        pthread_mutex_lock(&_lock);
+        self.indexNeedsCompaction = YES;
+        pthread_mutex_unlock(&_lock);
+    }
+    pthread_mutex_unlock(&_commitLock);
+    return synchronize;
+}
+
+/**
+ * Encode the whole index with a bumped generation, so the old journal is ignored if we crash before remove it.
+ * Note must call this method in lock and commit lock.
+ */
+- (NSData *)takeIndexSnapshotWithGeneration:(uint64_t *)generation {
+    *generation = self.generation + 1;
+    NSData *indexData = [JPVideoPlayerCacheFile indexDataWithFileLength:self.fileLength
+                                                             generation:*generation
+                                                                  flags:self.streamingOnly ? kJPVideoPlayerCacheIndexFlagStreamingOnly : 0
+                                                        responseHeaders:self.responseHeaders
+                                                         fragmentRanges:self.internalFragmentRanges
+                                                         blockChecksums:[self blockChecksumTable]];
+    [self.pendingJournalRanges removeAllRanges];
+    [self.pendingJournalChecksums removeAllIndexes];
+    self.indexNeedsCompaction = NO;
+    return indexData;
+}
 
-    NSMutableDictionary *dict = [@{
-            kJPVideoPlayerCacheFileSizeKey: @(self.fileLength),
-    } mutableCopy];
+/**
+ * Rewrite the whole index file and drop the journal.
+ * Note must call this method in commit lock.
+ */
+- (BOOL)compactIndex {
+    uint64_t generation = 0;
+    pthread_mutex_lock(&_lock);
+    NSData *indexData = [self takeIndexSnapshotWithGeneration:&generation];
+    pthread_mutex_unlock(&_lock);
+    if (self.fileDescriptor >= 0 && fsync(self.fileDescriptor) != 0) {
+        JPErrorLog(@"Synchronize video data file failed, errno: %d", errno);
+        return NO;
+    }
+    return [self commitIndexData:indexData generation:generation];
+}
 
-    NSMutableArray *rangeArray = [[NSMutableArray alloc] init];
-    for (NSValue *range in self.internalFragmentRanges) {
-        [rangeArray addObject:NSStringFromRange([range rangeValue])];
+/**
+ * Note must call this method in commit lock.
+ */
+- (BOOL)commitIndexData:(NSData *)indexData
+             generation:(uint64_t)generation {
+    if (![indexData writeToFile:self.indexFilePath atomically:YES]) {
+        JPErrorLog(@"Write index file failed: %@", self.indexFilePath);
+        return NO;
     }
-    if(rangeArray.count){
-        dict[kJPVideoPlayerCacheFileZoneKey] = rangeArray;
+
+    [self closeJournal];
+    [[NSFileManager defaultManager] removeItemAtPath:self.journalFilePath error:NULL];
+    self.journalRecordCount = 0;
+    pthread_mutex_lock(&_lock);
+    self.generation = generation;
+    pthread_mutex_unlock(&_lock);
+    JPDebugLog(@"Did compact index file");
+    return YES;
+}
+
+
+#pragma mark - Journal
+
+/**
+ * Encode the pending records to append to journal, nil if no record pending.
+ * Note must call this method in lock and commit lock.
+ */
+- (NSData *)takeJournalSnapshot {
+    NSUInteger rangeCount = self.pendingJournalRanges.count;
+    NSUInteger recordCount = rangeCount + self.pendingJournalChecksums.count;
+    if (recordCount == 0) {
+        return nil;
     }
 
-    JPDebugLog(@"存储字典: %@", dict);
+    // a new journal start with a header record bind it to the current index generation.
+    NSUInteger headerCount = self.journalRecordCount == 0 ? 1 : 0;
+    NSMutableData *data = [NSMutableData dataWithLength:(headerCount + recordCount) * sizeof(JPVideoPlayerCacheJournalRecord)];
+    JPVideoPlayerCacheJournalRecord *records = data.mutableBytes;
+    if (headerCount) {
+        records[0] = JPVideoPlayerCacheJournalRecordMake(JPVideoPlayerCacheJournalRecordTypeHeader,
+                self.generation, (uint64_t)self.fileLength);
+    }
+    for (NSUInteger i = 0; i < rangeCount; i++) {
+        NSRange range = [self.pendingJournalRanges rangeAtIndex:i];
+        records[headerCount + i] = JPVideoPlayerCacheJournalRecordMake(JPVideoPlayerCacheJournalRecordTypeAddRange,
+                (uint64_t)range.location, (uint64_t)NSMaxRange(range));
+    }
+    // the checksum records follow the range records, so a block checksum is never replayed without its range.
+    __block NSUInteger checksumRecordIndex = headerCount + rangeCount;
+    const uint32_t *checksums = self.blockChecksums.bytes;
+    [self.pendingJournalChecksums enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+        records[checksumRecordIndex++] = JPVideoPlayerCacheJournalRecordMake(JPVideoPlayerCacheJournalRecordTypeBlockChecksum,
+                (uint64_t)index, (uint64_t)checksums[index]);
+    }];
+    [self.pendingJournalRanges removeAllRanges];
+    [self.pendingJournalChecksums removeAllIndexes];
+    return data;
+}
 
-    if (self.responseHeaders) {
-        dict[kJPVideoPlayerCacheFileResponseHeadersKey] = self.responseHeaders;
+/**
+ * Note must call this method in commit lock.
+ */
+- (BOOL)appendRecordsToJournal:(NSData *)records {
+    if (!records.length) {
+        return YES;
+    }
+    if (![self openJournalIfNeed]) {
+        return NO;
     }
 
-    NSData *data = [NSJSONSerialization dataWithJSONObject:dict options:0 error:nil];
-    if (data) {
-        NSString *dataString = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
-        if (!lock) {
-            pthread_mutex_unlock(&_lock);
+    size_t length = records.length;
+    size_t written = 0;
+    while (written < length) {
+        ssize_t result = write(self.journalFileDescriptor, (const uint8_t *)records.bytes + written, length - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            break;
         }
-        return dataString;
+        written += (size_t)result;
     }
-    if (!lock) {
-        pthread_mutex_unlock(&_lock);
+
+    // Darwin does not declare fdatasync, fsync is the nearest equivalent.
+    if (written != length || fsync(self.journalFileDescriptor) != 0) {
+        // the tail of journal maybe broken, the caller rewrite the whole index to drop it.
+        JPWarningLog(@"Append to index journal failed, errno: %d", errno);
+        return NO;
     }
-    return nil;
+
+    NSUInteger recordCount = length / sizeof(JPVideoPlayerCacheJournalRecord);
+    self.journalRecordCount += recordCount;
+    JPDebugLog(@"Did append %ld records to index journal", recordCount);
+    return YES;
 }
 
-- (BOOL)synchronize {
-    NSString *indexString = [self unserializeIndex];
-    int lock = pthread_mutex_trylock(&_lock);
-    JPDebugLog(@"Did synchronize index file");
-    [self.writeFileHandle synchronizeFile];
-    BOOL synchronize = [indexString writeToFile:self.indexFilePath atomically:YES encoding:NSUTF8StringEncoding error:NULL];
-    if (!lock) {
+- (BOOL)openJournalIfNeed {
+    if (self.journalFileDescriptor >= 0) {
+        return YES;
+    }
+
+    // a journal without any record known is stale, truncate it so the header record come first.
+    int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC;
+    if (self.journalRecordCount == 0) {
+        flags |= O_TRUNC;
+    }
+    self.journalFileDescriptor = open(self.journalFilePath.fileSystemRepresentation, flags, 0644);
+    if (self.journalFileDescriptor < 0) {
+        JPErrorLog(@"Open index journal failed, errno: %d", errno);
+        return NO;
+    }
+    return YES;
+}
+
+- (void)closeJournal {
+    if (self.journalFileDescriptor >= 0) {
+        close(self.journalFileDescriptor);
+        self.journalFileDescriptor = -1;
+    }
+}
+
+/**
+ * Replay the journal on top of the index file, stop at the first broken record.
+ *
+ * @param recovery YES if the index file is broken, then the file length and generation are taken from the journal.
+ *
+ * @return YES if the journal is valid.
+ */
+- (BOOL)replayJournalForRecovery:(BOOL)recovery {
+    NSData *journalData = [NSData dataWithContentsOfFile:self.journalFilePath
+                                                 options:NSDataReadingMappedIfSafe
+                                                   error:nil];
+    if (journalData.length < sizeof(JPVideoPlayerCacheJournalRecord)) {
+        return NO;
+    }
+
+    const uint8_t *bytes = journalData.bytes;
+    JPVideoPlayerCacheJournalRecord header;
+    memcpy(&header, bytes, sizeof(JPVideoPlayerCacheJournalRecord));
+    uint64_t generation = CFSwapInt64LittleToHost(header.start);
+    uint64_t fileLength = CFSwapInt64LittleToHost(header.end);
+    BOOL headerValid = JPVideoPlayerCacheJournalRecordIsValid(&header) &&
+            CFSwapInt32LittleToHost(header.type) == JPVideoPlayerCacheJournalRecordTypeHeader &&
+            fileLength <= NSUIntegerMax;
+    pthread_mutex_lock(&_lock);
+    if (headerValid && !recovery) {
+        headerValid = generation == self.generation && fileLength == self.fileLength;
+    }
+    if (!headerValid) {
         pthread_mutex_unlock(&_lock);
+        JPWarningLog(@"Drop the index journal not belong to current index");
+        [[NSFileManager defaultManager] removeItemAtPath:self.journalFilePath error:NULL];
+        return NO;
     }
-    return synchronize;
+
+    if (recovery) {
+        self.fileLength = (NSUInteger)fileLength;
+        self.generation = generation;
+        self.responseHeaders = nil;
+        [self.internalFragmentRanges removeAllRanges];
+        [self resetBlockChecksums];
+    }
+    NSUInteger recordCount = journalData.length / sizeof(JPVideoPlayerCacheJournalRecord);
+    NSUInteger validCount = 1;
+    for (; validCount < recordCount; validCount++) {
+        JPVideoPlayerCacheJournalRecord record;
+        memcpy(&record, bytes + validCount * sizeof(JPVideoPlayerCacheJournalRecord), sizeof(JPVideoPlayerCacheJournalRecord));
+        if (!JPVideoPlayerCacheJournalRecordIsValid(&record)) {
+            break;
+        }
+        uint32_t type = CFSwapInt32LittleToHost(record.type);
+        uint64_t start = CFSwapInt64LittleToHost(record.start);
+        uint64_t end = CFSwapInt64LittleToHost(record.end);
+        if (type == JPVideoPlayerCacheJournalRecordTypeBlockChecksum) {
+            [self setChecksum:(uint32_t)end forBlockAtIndex:(NSUInteger)start];
+            continue;
+        }
+        if (type != JPVideoPlayerCacheJournalRecordTypeAddRange || end > self.fileLength) {
+            break;
+        }
+        [self.internalFragmentRanges addRange:NSMakeRange((NSUInteger)start, (NSUInteger)(end - start))];
+    }
+    self.journalRecordCount = validCount;
+    pthread_mutex_unlock(&_lock);
+
+    NSUInteger validLength = validCount * sizeof(JPVideoPlayerCacheJournalRecord);
+    if (validLength != journalData.length) {
+        JPWarningLog(@"Drop the broken tail of index journal, valid records: %ld", validCount);
+        truncate(self.journalFilePath.fileSystemRepresentation, (off_t)validLength);
+    }
+    JPDebugLog(@"Did replay %ld records from index journal", validCount);
+    return YES;
+}
+
+/**
+ * Drop the ranges beyond the size of video data file on disk, the truncate maybe lost in a crash.
+ *
+ * @return YES if any range is dropped.
+ */
+- (BOOL)dropRangesBeyondDataFile {
+    struct stat fileStat;
+    if (self.fileDescriptor < 0 || fstat(self.fileDescriptor, &fileStat) != 0) {
+        return NO;
+    }
+
+    pthread_mutex_lock(&_lock);
+    BOOL dropped = NO;
+    NSUInteger fileSize = (NSUInteger)fileStat.st_size;
+    if (self.internalFragmentRanges.upperBound > fileSize) {
+        [self.internalFragmentRanges removeRange:NSMakeRange(fileSize, self.internalFragmentRanges.upperBound - fileSize)];
+        dropped = YES;
+    }
+    pthread_mutex_unlock(&_lock);
+    if (dropped) {
+        JPWarningLog(@"Drop the ranges beyond the video data file size: %ld", fileSize);
+    }
+    return dropped;
 }
 
 @end
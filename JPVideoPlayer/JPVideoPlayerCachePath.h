@@ -62,6 +62,15 @@ NS_ASSUME_NONNULL_BEGIN
  */
 + (NSString *)createVideoIndexFileIfNeedThenFetchItForKey:(NSString *)key;
 
+/**
+ * Fetch the journal file path of index file for given key on version 3.x.
+ *
+ * @param key A given key.
+ *
+ * @return The path of index journal file.
+ */
++ (NSString *)videoCacheIndexJournalFilePathForKey:(NSString *)key;
+
 /**
  * Fetch the playback record file path.
  *
@@ -18,6 +18,7 @@ NSString * const JPVideoPlayerCacheVideoPathForFullFile = @"/FullFile";
 static NSString * const kJPVideoPlayerCacheVideoPathDomain = @"/com.jpvideoplayer.www";
 static NSString * const kJPVideoPlayerCacheVideoFileExtension = @".mp4";
 static NSString * const kJPVideoPlayerCacheVideoIndexFileExtension = @".index";
+static NSString * const kJPVideoPlayerCacheVideoIndexJournalFileExtension = @".journal";
 static NSString * const kJPVideoPlayerCacheVideoPlaybackRecordFileExtension = @".record";
 @implementation JPVideoPlayerCachePath
 
@@ -76,6 +77,14 @@ static NSString * const kJPVideoPlayerCacheVideoPlaybackRecordFileExtension = @"
     return filePath;
 }
 
++ (NSString *)videoCacheIndexJournalFilePathForKey:(NSString *)key {
+    NSString *filePath = [self videoCacheIndexFilePathForKey:key];
+    if (!filePath) {
+        return nil;
+    }
+    return [filePath stringByAppendingString:kJPVideoPlayerCacheVideoIndexJournalFileExtension];
+}
+
 + (NSString *)videoPlaybackRecordFilePath {
     NSString *filePath = [self videoCachePath];
     if(!filePath){
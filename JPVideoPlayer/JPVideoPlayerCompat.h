@@ -97,6 +97,12 @@ typedef NS_OPTIONS(NSUInteger, JPVideoPlayerOptions) {
      */
     JPVideoPlayerLayerVideoGravityResizeAspectFill = 1 << 7,
 
+    /**
+     * Download a large uncached range over several connections at the same time.
+     * Useful for high latency CDN, the server must support range request.
+     */
+    JPVideoPlayerParallelDownload = 1 << 8,
+
     // TODO: Disable cache if need.
 };
 
@@ -126,6 +132,28 @@ typedef NS_OPTIONS(NSUInteger, JPVideoPlayerDownloaderOptions) {
     JPVideoPlayerDownloaderAllowInvalidSSLCertificates = 1 << 3,
 };
 
+typedef NS_ENUM(NSUInteger, JPVideoPlayerDownloadPriority) {
+    /**
+     * The data the player is waiting for.
+     */
+    JPVideoPlayerDownloadPriorityPlaying = 0,
+
+    /**
+     * The data of the position the user is seeking to.
+     */
+    JPVideoPlayerDownloadPrioritySeekTarget,
+
+    /**
+     * The data ahead of the range the player requested.
+     */
+    JPVideoPlayerDownloadPriorityReadAhead,
+
+    /**
+     * The data may be needed later, such as the rest of a request the player cancelled.
+     */
+    JPVideoPlayerDownloadPriorityPrefetch,
+};
+
 typedef void(^JPPlayVideoConfiguration)(UIView *_Nonnull view, JPVideoPlayerModel *_Nonnull playerModel);
 typedef void(^JPVideoPlayerConfiguration)(JPVideoPlayerModel *_Nonnull playerModel);
 
@@ -134,6 +162,24 @@ UIKIT_EXTERN NSString * _Nonnull const JPVideoPlayerDownloadReceiveResponseNotif
 UIKIT_EXTERN NSString * _Nonnull const JPVideoPlayerDownloadStopNotification;
 UIKIT_EXTERN NSString * _Nonnull const JPVideoPlayerDownloadFinishNotification;
 UIKIT_EXTERN NSString *const JPVideoPlayerErrorDomain;
+/**
+ * The error code of a local request which found part of its data is not cached anymore, such as a corrupt block evicted.
+ */
+UIKIT_EXTERN const NSInteger JPVideoPlayerErrorCodeCachedDataInvalidated;
+/**
+ * The error code of a web request receiving data from the download of other loading request, which stopped before
+ * reach the end of the request range.
+ */
+UIKIT_EXTERN const NSInteger JPVideoPlayerErrorCodeSharedDownloadStopped;
+/**
+ * The error code of video data which can not be written to cache file, the data is dropped and not marked cached.
+ */
+UIKIT_EXTERN const NSInteger JPVideoPlayerErrorCodeStoreVideoDataFailed;
+/**
+ * The error code of video data out of the size the cache file can cache, such as beyond `streamingOnlyCacheSize`
+ * of a streaming only cache file, the data is dropped and not marked cached.
+ */
+UIKIT_EXTERN const NSInteger JPVideoPlayerErrorCodeCacheSizeExceeded;
 FOUNDATION_EXTERN const NSRange JPInvalidRange;
 static JPLogLevel _logLevel;
 
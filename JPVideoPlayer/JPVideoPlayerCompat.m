@@ -17,6 +17,10 @@ NSString *const JPVideoPlayerDownloadReceiveResponseNotification = @"www.jpvideo
 NSString *const JPVideoPlayerDownloadStopNotification = @"www.jpvideplayer.download.stop.notification";
 NSString *const JPVideoPlayerDownloadFinishNotification = @"www.jpvideplayer.download.finished.notification";
 NSString *const JPVideoPlayerErrorDomain = @"com.jpvideoplayer.error.domain.www";
+const NSInteger JPVideoPlayerErrorCodeCachedDataInvalidated = 1001;
+const NSInteger JPVideoPlayerErrorCodeSharedDownloadStopped = 1002;
+const NSInteger JPVideoPlayerErrorCodeStoreVideoDataFailed = 1003;
+const NSInteger JPVideoPlayerErrorCodeCacheSizeExceeded = 1004;
 const NSRange JPInvalidRange = {NSNotFound, 0};
 
 BOOL JPValidByteRange(NSRange range) {
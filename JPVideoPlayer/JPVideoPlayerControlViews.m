@@ -192,6 +192,7 @@ nearestViewControllerInViewTree:(UIViewController *_Nullable)nearestViewControll
 
 - (void)dragSliderDidDrag:(UISlider *)slider {
     self.userDragTimeInterval = slider.value * self.totalSeconds;
+    [self.playerView jp_prefetchVideoDataForSeekingToTime:self.userDragTimeInterval];
 }
 
 - (void)dragSliderDidEnd:(UISlider *)slider {
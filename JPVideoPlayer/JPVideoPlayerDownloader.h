@@ -11,6 +11,7 @@
 
 #import <Foundation/Foundation.h>
 #import "JPVideoPlayerCompat.h"
+#import "JPVideoPlayerBandwidthEstimator.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -37,8 +38,8 @@ didReceiveResponse:(NSURLResponse *)response;
  *
  * @param downloader   The current instance.
  * @param data         The received new data.
- * @param receivedSize The size of received data.
- * @param expectedSize The expexted size of request.
+ * @param receivedSize The size of data received by the request of this data.
+ * @param expectedSize The expexted size of the request of this data, the concurrent requests are counted apart.
  */
 - (void)downloader:(JPVideoPlayerDownloader *)downloader
     didReceiveData:(NSData *)data
@@ -55,6 +56,16 @@ didReceiveResponse:(NSURLResponse *)response;
 - (void)downloader:(JPVideoPlayerDownloader *)downloader
 didCompleteWithError:(NSError *)error;
 
+/**
+ * This method will be called when a new throughput sample is measured.
+ * this method will execute on main-thread.
+ *
+ * @param downloader The current instance.
+ * @param estimate   The estimate of all hosts, the estimate of one host can be fetched from `bandwidthEstimator`.
+ */
+- (void)downloader:(JPVideoPlayerDownloader *)downloader
+didUpdateBandwidthEstimate:(JPVideoPlayerBandwidthEstimate *)estimate;
+
 @end
 
 @interface JPVideoPlayerDownloader : NSObject
@@ -80,7 +91,8 @@ didCompleteWithError:(NSError *)error;
 @property (assign, nonatomic) NSTimeInterval downloadTimeout;
 
 /**
- * The current url, may nil if no download operation.
+ * The last request task handed to this downloader, may nil if no download operation.
+ * The downloader run many request tasks at the same time, this is not the only one.
  */
 @property (nonatomic, weak, readonly, nullable) JPResourceLoadingRequestWebTask *runningTask;
 
@@ -91,6 +103,11 @@ didCompleteWithError:(NSError *)error;
 
 @property (nonatomic, weak) id<JPVideoPlayerDownloaderDelegate> delegate;
 
+/**
+ * The throughput, time to first byte and round trip time measured from the downloads of this downloader.
+ */
+@property (nonatomic, strong, readonly) JPVideoPlayerBandwidthEstimator *bandwidthEstimator;
+
 
 /**
  * @brief Customize acceptable response MIMETypes.
@@ -129,7 +146,42 @@ didCompleteWithError:(NSError *)error;
                      downloadOptions:(JPVideoPlayerDownloaderOptions)downloadOptions;
 
 /**
- * Cancel current download task.
+ * Set the maximum number of data tasks run at the same time for given priority class.
+ * The defaults are 6 for playing, 2 for seek target, 2 for read-ahead and 1 for prefetch.
+ *
+ * @param count    The maximum number of data tasks, must greater than 0.
+ * @param priority The priority class.
+ */
+- (void)setMaxConcurrentDownloadCount:(NSUInteger)count
+                          forPriority:(JPVideoPlayerDownloadPriority)priority;
+
+/**
+ * Fetch the maximum number of data tasks run at the same time for given priority class.
+ *
+ * @param priority The priority class.
+ *
+ * @return The maximum number of data tasks.
+ */
+- (NSUInteger)maxConcurrentDownloadCountForPriority:(JPVideoPlayerDownloadPriority)priority;
+
+/**
+ * Schedule the data task of given request task, called by the request task when it start. The data task is resumed
+ * when its priority class have a free slot, the classes are served in order of priority.
+ *
+ * @param requestTask A request task created its data task in the session of this downloader.
+ */
+- (void)scheduleRequestTask:(JPResourceLoadingRequestWebTask *)requestTask;
+
+/**
+ * Cancel the download tasks of given video url, the tasks of the other players share this downloader keep going.
+ * The cancelled tasks still complete to their resource loader.
+ *
+ * @param customURL The url of video to cancel.
+ */
+- (void)cancelRequestTasksWithCustomURL:(NSURL *)customURL;
+
+/**
+ * Cancel all download tasks, include the tasks of the other players share this downloader.
  */
 - (void)cancel;
 
@@ -18,29 +18,56 @@
 
 static NSArray<NSString *> *JPVideoPlayerDownloaderSupportedMIMETypes;
 
+#define kJPVideoPlayerDownloadPriorityCount (JPVideoPlayerDownloadPriorityPrefetch + 1)
+static const NSUInteger kJPVideoPlayerDefaultMaxConcurrentDownloadCounts[kJPVideoPlayerDownloadPriorityCount] = {6, 2, 2, 1};
+
 @interface JPVideoPlayerDownloader()<NSURLSessionDelegate, NSURLSessionDataDelegate>
 
 // The session in which data tasks will run
 @property (strong, nonatomic) NSURLSession *session;
 
-// The size of received data now.
-@property(nonatomic, assign)NSUInteger receivedSize;
+@property (nonatomic) pthread_mutex_t lock;
 
 /*
- * The expected size.
+ * The running operation.
  */
-@property(nonatomic, assign) NSUInteger expectedSize;
+@property(nonatomic, weak, nullable) JPResourceLoadingRequestWebTask *runningTask;
 
-@property (nonatomic) pthread_mutex_t lock;
+/*
+ * All scheduled request tasks keyed by the identifier of their data task, the session callbacks are routed by it.
+ */
+@property(nonatomic, strong) NSMutableDictionary<NSNumber *, JPResourceLoadingRequestWebTask *> *requestTasks;
 
 /*
- * The running operation.
+ * The request tasks waiting for a free slot, one queue for each priority class.
  */
-@property(nonatomic, weak, nullable) JPResourceLoadingRequestWebTask *runningTask;
+@property(nonatomic, strong) NSArray<NSMutableArray<JPResourceLoadingRequestWebTask *> *> *pendingRequestTasks;
+
+/*
+ * The request tasks took a slot, counted by their current priority class.
+ */
+@property(nonatomic, strong) NSMutableSet<JPResourceLoadingRequestWebTask *> *resumedRequestTasks;
+
+/*
+ * The time the data tasks resumed keyed by their identifier, for measuring the time to first byte.
+ */
+@property(nonatomic, strong) NSMutableDictionary<NSNumber *, NSNumber *> *resumeTimes;
+
+/*
+ * The host of the data tasks receiving data keyed by their identifier.
+ */
+@property(nonatomic, strong) NSMutableDictionary<NSNumber *, NSString *> *transferHosts;
+
+/*
+ * The error of the data tasks cancelled for a bad response keyed by their identifier, reported when they complete.
+ */
+@property(nonatomic, strong) NSMutableDictionary<NSNumber *, NSError *> *responseErrors;
 
 @end
 
-@implementation JPVideoPlayerDownloader
+@implementation JPVideoPlayerDownloader {
+    NSUInteger _maxConcurrentDownloadCounts[kJPVideoPlayerDownloadPriorityCount];
+}
 
 + (void)load {
     JPVideoPlayerDownloaderSupportedMIMETypes = @[@"video", @"audio"];
@@ -65,9 +92,19 @@ static NSArray<NSString *> *JPVideoPlayerDownloaderSupportedMIMETypes;
         pthread_mutexattr_init(&mutexattr);
         pthread_mutexattr_settype(&mutexattr, PTHREAD_MUTEX_RECURSIVE);
         pthread_mutex_init(&_lock, &mutexattr);
-        _expectedSize = 0;
-        _receivedSize = 0;
         _runningTask = nil;
+        _requestTasks = [@{} mutableCopy];
+        NSMutableArray *pendingRequestTasks = [@[] mutableCopy];
+        for (NSUInteger i = 0; i < kJPVideoPlayerDownloadPriorityCount; i++) {
+            [pendingRequestTasks addObject:[@[] mutableCopy]];
+            _maxConcurrentDownloadCounts[i] = kJPVideoPlayerDefaultMaxConcurrentDownloadCounts[i];
+        }
+        _pendingRequestTasks = [pendingRequestTasks copy];
+        _resumedRequestTasks = [NSMutableSet set];
+        _resumeTimes = [@{} mutableCopy];
+        _transferHosts = [@{} mutableCopy];
+        _responseErrors = [@{} mutableCopy];
+        _bandwidthEstimator = [JPVideoPlayerBandwidthEstimator new];
 
         if (!sessionConfiguration) {
             sessionConfiguration = [NSURLSessionConfiguration defaultSessionConfiguration];
@@ -114,21 +151,86 @@ static NSArray<NSString *> *JPVideoPlayerDownloaderSupportedMIMETypes;
         return;
     }
 
-    [self reset];
+    pthread_mutex_lock(&_lock);
     _runningTask = requestTask;
     _downloaderOptions = downloadOptions;
+    requestTask.options = downloadOptions;
+    requestTask.downloader = self;
+    pthread_mutex_unlock(&_lock);
     [self startDownloadOpeartionWithRequestTask:requestTask
                                         options:downloadOptions];
 }
 
-- (void)cancel {
-    int lock = pthread_mutex_trylock(&_lock);
-    if (self.runningTask) {
-        [self.runningTask cancel];
-        [self reset];
+- (void)setMaxConcurrentDownloadCount:(NSUInteger)count
+                          forPriority:(JPVideoPlayerDownloadPriority)priority {
+    if (!count || priority >= kJPVideoPlayerDownloadPriorityCount) {
+        return;
+    }
+
+    pthread_mutex_lock(&_lock);
+    _maxConcurrentDownloadCounts[priority] = count;
+    NSArray<JPResourceLoadingRequestWebTask *> *requestTasks = [self dequeuePendingRequestTasksIfNeed];
+    pthread_mutex_unlock(&_lock);
+    [self resumeRequestTasks:requestTasks];
+}
+
+- (NSUInteger)maxConcurrentDownloadCountForPriority:(JPVideoPlayerDownloadPriority)priority {
+    if (priority >= kJPVideoPlayerDownloadPriorityCount) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&_lock);
+    NSUInteger count = _maxConcurrentDownloadCounts[priority];
+    pthread_mutex_unlock(&_lock);
+    return count;
+}
+
+- (void)scheduleRequestTask:(JPResourceLoadingRequestWebTask *)requestTask {
+    NSURLSessionDataTask *dataTask = requestTask.dataTask;
+    if (!dataTask) {
+        return;
+    }
+
+    pthread_mutex_lock(&_lock);
+    self.requestTasks[@(dataTask.taskIdentifier)] = requestTask;
+    NSUInteger priority = MIN(requestTask.downloadPriority, kJPVideoPlayerDownloadPriorityCount - 1);
+    [self.pendingRequestTasks[priority] addObject:requestTask];
+    JPDebugLog(@"Downloader 排队一个请求, id 是: %d, 优先级: %ld", dataTask.taskIdentifier, priority);
+    NSArray<JPResourceLoadingRequestWebTask *> *requestTasks = [self dequeuePendingRequestTasksIfNeed];
+    pthread_mutex_unlock(&_lock);
+    [self resumeRequestTasks:requestTasks];
+}
+
+- (void)cancelRequestTasksWithCustomURL:(NSURL *)customURL {
+    if (!customURL) {
+        return;
+    }
+
+    pthread_mutex_lock(&_lock);
+    NSMutableArray<JPResourceLoadingRequestWebTask *> *requestTasks = [@[] mutableCopy];
+    for (JPResourceLoadingRequestWebTask *requestTask in self.requestTasks.allValues) {
+        if ([requestTask.customURL isEqual:customURL]) {
+            [requestTasks addObject:requestTask];
+        }
+    }
+    if (self.runningTask && [self.runningTask.customURL isEqual:customURL]) {
+        self.runningTask = nil;
     }
-    if (!lock) {
-        pthread_mutex_unlock(&_lock);
+    pthread_mutex_unlock(&_lock);
+    JPDebugLog(@"Downloader 取消 %ld 个请求, url 是: %@", requestTasks.count, customURL);
+    // the tasks are removed when their data tasks complete, so the completions still route back to them.
+    for (JPResourceLoadingRequestWebTask *requestTask in requestTasks) {
+        [requestTask cancel];
+    }
+}
+
+- (void)cancel {
+    pthread_mutex_lock(&_lock);
+    NSArray<JPResourceLoadingRequestWebTask *> *requestTasks = self.requestTasks.allValues;
+    [self reset];
+    pthread_mutex_unlock(&_lock);
+    for (JPResourceLoadingRequestWebTask *requestTask in requestTasks) {
+        [requestTask cancel];
     }
 }
 
@@ -159,7 +261,6 @@ static NSArray<NSString *> *JPVideoPlayerDownloaderSupportedMIMETypes;
         [request setValue:rangeValue forHTTPHeaderField:@"Range"];
     }
 
-    self.runningTask = requestTask;
     requestTask.request = request;
     requestTask.unownedSession = self.session;
     JPDebugLog(@"Downloader 处理完一个请求");
@@ -174,7 +275,7 @@ willPerformHTTPRedirection:(NSHTTPURLResponse *)response
         completionHandler:(void (^)(NSURLRequest * _Nullable))completionHandler {
     if (response) {
         JPDebugLog(@"URLSession will perform HTTP redirection");
-        self.runningTask.loadingRequest.redirect = request;
+        [self requestTaskForSessionTask:task].loadingRequest.redirect = request;
     }
     if(completionHandler){
         completionHandler(request);
@@ -189,7 +290,6 @@ didReceiveResponse:(NSURLResponse *)response
     //'304 Not Modified' is an exceptional one.
     if (![response respondsToSelector:@selector(statusCode)] || (((NSHTTPURLResponse *)response).statusCode < 400 && ((NSHTTPURLResponse *)response).statusCode != 304)) {
         NSInteger expected = MAX((NSInteger)response.expectedContentLength, 0);
-        self.expectedSize = expected;
         
         // there are a lot of MIMETypes represent audio and video
         NSMutableArray *supportedMIMETypes = [JPVideoPlayerDownloaderSupportedMIMETypes mutableCopy];
@@ -205,11 +305,8 @@ didReceiveResponse:(NSURLResponse *)response
         
         if(!isSupportedMIMEType){
             JPErrorLog(@"Not support MIMEType: %@", response.MIMEType);
-            JPDispatchSyncOnMainQueue(^{
-                [self cancel];
-                [self callCompleteDelegateIfNeedWithError:JPErrorWithDescription([NSString stringWithFormat:@"Not support MIMEType: %@", response.MIMEType])];
-                [[NSNotificationCenter defaultCenter] postNotificationName:JPVideoPlayerDownloadStopNotification object:self];
-            });
+            [self failSessionTask:dataTask
+                        withError:JPErrorWithDescription([NSString stringWithFormat:@"Not support MIMEType: %@", response.MIMEType])];
             if (completionHandler) {
                 completionHandler(NSURLSessionResponseCancel);
             }
@@ -218,24 +315,24 @@ didReceiveResponse:(NSURLResponse *)response
 
         // May the free size of the device less than the expected size of the video data.
         if (![[JPVideoPlayerCache sharedCache] haveFreeSizeToCacheFileWithSize:expected]) {
-            JPDispatchSyncOnMainQueue(^{
-                [self cancel];
-                [self callCompleteDelegateIfNeedWithError:JPErrorWithDescription(@"No enough size of device to cache the video data")];
-                [[NSNotificationCenter defaultCenter] postNotificationName:JPVideoPlayerDownloadStopNotification object:self];
-            });
+            [self failSessionTask:dataTask
+                        withError:JPErrorWithDescription(@"No enough size of device to cache the video data")];
             if (completionHandler) {
                 completionHandler(NSURLSessionResponseCancel);
             }
         }
         else{
-            JPDispatchSyncOnMainQueue(^{
-                if(!self.runningTask){
-                    if (completionHandler) {
-                        completionHandler(NSURLSessionResponseCancel);
-                    }
-                    return;
+            JPResourceLoadingRequestWebTask *requestTask = [self requestTaskForSessionTask:dataTask];
+            if(!requestTask){
+                if (completionHandler) {
+                    completionHandler(NSURLSessionResponseCancel);
                 }
-                [self.runningTask requestDidReceiveResponse:response];
+                return;
+            }
+            // the request task run off main queue, only the delegate and notification need main queue.
+            [self transferDidStartForSessionTask:dataTask];
+            [requestTask requestDidReceiveResponse:response];
+            JPDispatchSyncOnMainQueue(^{
                 if (self.delegate && [self.delegate respondsToSelector:@selector(downloader:didReceiveResponse:)]) {
                     [self.delegate downloader:self didReceiveResponse:response];
                 }
@@ -247,12 +344,9 @@ didReceiveResponse:(NSURLResponse *)response
         }
     }
     else {
-        JPDispatchSyncOnMainQueue(^{
-            [self cancel];
-            NSString *errorMsg = [NSString stringWithFormat:@"The statusCode of response is: %ld", (long)((NSHTTPURLResponse *)response).statusCode];
-            [self callCompleteDelegateIfNeedWithError:JPErrorWithDescription(errorMsg)];
-            [[NSNotificationCenter defaultCenter] postNotificationName:JPVideoPlayerDownloadStopNotification object:self];
-        });
+        NSString *errorMsg = [NSString stringWithFormat:@"The statusCode of response is: %ld", (long)((NSHTTPURLResponse *)response).statusCode];
+        [self failSessionTask:dataTask
+                    withError:JPErrorWithDescription(errorMsg)];
         if (completionHandler) {
             completionHandler(NSURLSessionResponseCancel);
         }
@@ -262,21 +356,26 @@ didReceiveResponse:(NSURLResponse *)response
 - (void)URLSession:(NSURLSession *)session
           dataTask:(NSURLSessionDataTask *)dataTask
     didReceiveData:(NSData *)data {
-    // may runningTask is dealloc in main-thread and this method called in sub-thread.
-    if(!self.runningTask){
-        [self reset];
+    // may request task is dealloc in main-thread and this method called in sub-thread.
+    JPResourceLoadingRequestWebTask *requestTask = [self requestTaskForSessionTask:dataTask];
+    if(!requestTask){
         return;
     }
 
-    self.receivedSize += data.length;
-    [self.runningTask requestDidReceiveData:data
+    [self transferDidReceiveDataWithLength:data.length
+                            forSessionTask:dataTask];
+    // the sizes of this data task, the concurrent tasks download different ranges.
+    NSUInteger receivedSize = (NSUInteger)MAX(dataTask.countOfBytesReceived, 0);
+    NSUInteger expectedSize = (NSUInteger)MAX(dataTask.countOfBytesExpectedToReceive, 0);
+    [requestTask requestDidReceiveData:data
                            storedCompletion:^{
-                               JPDispatchSyncOnMainQueue(^{
+                               // do not block the network delegate thread on main thread.
+                               JPDispatchAsyncOnMainQueue(^{
                                    if (self.delegate && [self.delegate respondsToSelector:@selector(downloader:didReceiveData:receivedSize:expectedSize:)]) {
                                        [self.delegate downloader:self
                                                   didReceiveData:data
-                                                    receivedSize:self.receivedSize
-                                                    expectedSize:self.expectedSize];
+                                                    receivedSize:receivedSize
+                                                    expectedSize:expectedSize];
                                    }
                                });
                            }];
@@ -285,24 +384,67 @@ didReceiveResponse:(NSURLResponse *)response
 - (void)URLSession:(NSURLSession *)session
               task:(NSURLSessionTask *)task
 didCompleteWithError:(NSError *)error {
-    JPDispatchSyncOnMainQueue(^{
-        JPDebugLog(@"URLSession 完成了一个请求, id 是 %ld, error 是: %@", task.taskIdentifier, error);
-        BOOL completeValid = self.runningTask && task.taskIdentifier == self.runningTask.dataTask.taskIdentifier;
-        if(!completeValid){
-            JPDebugLog(@"URLSession 完成了一个不是正在请求的请求, id 是: %d", task.taskIdentifier);
-            return;
-        }
+    JPDebugLog(@"URLSession 完成了一个请求, id 是 %ld, error 是: %@", task.taskIdentifier, error);
+    [self transferDidEndForSessionTask:task];
+    pthread_mutex_lock(&_lock);
+    NSError *responseError = self.responseErrors[@(task.taskIdentifier)];
+    [self.responseErrors removeObjectForKey:@(task.taskIdentifier)];
+    pthread_mutex_unlock(&_lock);
+    JPResourceLoadingRequestWebTask *requestTask = [self requestTaskForSessionTask:task];
+    if(!requestTask){
+        JPDebugLog(@"URLSession 完成了一个不是正在请求的请求, id 是: %d", task.taskIdentifier);
+        return;
+    }
+
+    // the data task cancelled for a bad response complete with the reason instead of the cancel error.
+    error = responseError ?: error;
+    pthread_mutex_lock(&_lock);
+    [self.requestTasks removeObjectForKey:@(task.taskIdentifier)];
+    [self.resumedRequestTasks removeObject:requestTask];
+    for (NSMutableArray<JPResourceLoadingRequestWebTask *> *pendingRequestTasks in self.pendingRequestTasks) {
+        [pendingRequestTasks removeObject:requestTask];
+    }
+    NSArray<JPResourceLoadingRequestWebTask *> *requestTasks = [self dequeuePendingRequestTasksIfNeed];
+    pthread_mutex_unlock(&_lock);
+    [self resumeRequestTasks:requestTasks];
+    [requestTask requestDidCompleteWithError:error];
+    if (requestTask.isInternal) {
+        // neither the delegate nor the observers of download care about the internal task.
+        return;
+    }
 
-        [self.runningTask requestDidCompleteWithError:error];
+    // only the task serving a loading request report to delegate, a cancelled one is abandoned by the player already.
+    BOOL cancelled = [error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorCancelled;
+    BOOL needReport = requestTask.loadingRequest && !cancelled;
+    JPDispatchSyncOnMainQueue(^{
         if (!error) {
             [[NSNotificationCenter defaultCenter] postNotificationName:JPVideoPlayerDownloadFinishNotification object:self];
         }
-        if (self.delegate && [self.delegate respondsToSelector:@selector(downloader:didCompleteWithError:)]) {
+        else if (responseError) {
+            [[NSNotificationCenter defaultCenter] postNotificationName:JPVideoPlayerDownloadStopNotification object:self];
+        }
+        if (needReport && self.delegate && [self.delegate respondsToSelector:@selector(downloader:didCompleteWithError:)]) {
             [self.delegate downloader:self didCompleteWithError:error];
         }
     });
 }
 
+- (void)URLSession:(NSURLSession *)session
+              task:(NSURLSessionTask *)task
+didFinishCollectingMetrics:(NSURLSessionTaskMetrics *)metrics {
+    NSString *host = task.currentRequest.URL.host ?: task.originalRequest.URL.host;
+    for (NSURLSessionTaskTransactionMetrics *transactionMetrics in metrics.transactionMetrics) {
+        if (transactionMetrics.isReusedConnection || !transactionMetrics.connectStartDate || !transactionMetrics.connectEndDate) {
+            continue;
+        }
+
+        // the TCP handshake of a new connection take one round trip, the TLS handshake after it is excluded.
+        NSDate *handshakeEndDate = transactionMetrics.secureConnectionStartDate ?: transactionMetrics.connectEndDate;
+        [self.bandwidthEstimator recordRoundTripTime:[handshakeEndDate timeIntervalSinceDate:transactionMetrics.connectStartDate]
+                                             forHost:host ?: @""];
+    }
+}
+
 - (void)URLSession:(NSURLSession *)session
               task:(NSURLSessionTask *)task
 didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
@@ -311,7 +453,7 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
     __block NSURLCredential *credential = nil;
 
     if ([challenge.protectionSpace.authenticationMethod isEqualToString:NSURLAuthenticationMethodServerTrust]) {
-        if (!(self.runningTask.options & JPVideoPlayerDownloaderAllowInvalidSSLCertificates)) {
+        if (!([self requestTaskForSessionTask:task].options & JPVideoPlayerDownloaderAllowInvalidSSLCertificates)) {
             disposition = NSURLSessionAuthChallengePerformDefaultHandling;
         }
         else {
@@ -347,7 +489,7 @@ downloadCompletionHandler:(void (^)(NSCachedURLResponse *cachedResponse))downloa
     // If this method is called, it means the response wasn't read from cache
     NSCachedURLResponse *cachedResponse = proposedResponse;
 
-    if (self.runningTask.request.cachePolicy == NSURLRequestReloadIgnoringLocalCacheData) {
+    if ([self requestTaskForSessionTask:dataTask].request.cachePolicy == NSURLRequestReloadIgnoringLocalCacheData) {
         // Prevents caching of responses
         cachedResponse = nil;
     }
@@ -365,11 +507,126 @@ downloadCompletionHandler:(void (^)(NSCachedURLResponse *cachedResponse))downloa
     }
 }
 
+/**
+ * Record the error of a data task with a bad response, the caller cancel the data task by the response disposition,
+ * and only the request task of it complete with the error.
+ */
+- (void)failSessionTask:(NSURLSessionTask *)sessionTask
+              withError:(NSError *)error {
+    JPDebugLog(@"Downloader 请求失败, id 是: %d, error 是: %@", sessionTask.taskIdentifier, error);
+    pthread_mutex_lock(&_lock);
+    self.responseErrors[@(sessionTask.taskIdentifier)] = error;
+    pthread_mutex_unlock(&_lock);
+}
+
+- (JPResourceLoadingRequestWebTask *)requestTaskForSessionTask:(NSURLSessionTask *)sessionTask {
+    pthread_mutex_lock(&_lock);
+    JPResourceLoadingRequestWebTask *requestTask = self.requestTasks[@(sessionTask.taskIdentifier)];
+    pthread_mutex_unlock(&_lock);
+    return requestTask;
+}
+
+/**
+ * Take the pending request tasks in order of priority, as long as their class have a free slot. Must call in lock,
+ * the returned tasks take their slot already and must be resumed by `resumeRequestTasks:` after unlock.
+ */
+- (NSArray<JPResourceLoadingRequestWebTask *> *)dequeuePendingRequestTasksIfNeed {
+    NSUInteger runningCounts[kJPVideoPlayerDownloadPriorityCount] = {0};
+    for (JPResourceLoadingRequestWebTask *requestTask in self.resumedRequestTasks) {
+        // a detached task change its class to prefetch while running.
+        runningCounts[MIN(requestTask.downloadPriority, kJPVideoPlayerDownloadPriorityCount - 1)] += 1;
+    }
+
+    static const float sessionTaskPriorities[kJPVideoPlayerDownloadPriorityCount] = {0.75, 0.5, 0.25, 0.25};
+    NSMutableArray<JPResourceLoadingRequestWebTask *> *requestTasks = [@[] mutableCopy];
+    for (NSUInteger priority = 0; priority < kJPVideoPlayerDownloadPriorityCount; priority++) {
+        NSMutableArray<JPResourceLoadingRequestWebTask *> *pendingRequestTasks = self.pendingRequestTasks[priority];
+        while (pendingRequestTasks.count && runningCounts[priority] < _maxConcurrentDownloadCounts[priority]) {
+            JPResourceLoadingRequestWebTask *requestTask = pendingRequestTasks.firstObject;
+            [pendingRequestTasks removeObjectAtIndex:0];
+            if (requestTask.isCancelled || requestTask.dataTask.state != NSURLSessionTaskStateSuspended) {
+                // the cancelled data task complete by itself.
+                continue;
+            }
+
+            requestTask.dataTask.priority = sessionTaskPriorities[priority];
+            self.resumeTimes[@(requestTask.dataTask.taskIdentifier)] = @(CFAbsoluteTimeGetCurrent());
+            [self.resumedRequestTasks addObject:requestTask];
+            [requestTasks addObject:requestTask];
+            runningCounts[priority] += 1;
+            JPDebugLog(@"Downloader 开始一个请求, id 是: %d, 优先级: %ld", requestTask.dataTask.taskIdentifier, priority);
+        }
+    }
+    return [requestTasks copy];
+}
+
+/**
+ * Resume the data tasks dequeued by `dequeuePendingRequestTasksIfNeed`, must call out of lock.
+ */
+- (void)resumeRequestTasks:(NSArray<JPResourceLoadingRequestWebTask *> *)requestTasks {
+    for (JPResourceLoadingRequestWebTask *requestTask in requestTasks) {
+        [requestTask.dataTask resume];
+    }
+}
+
+/**
+ * A data task start receiving data, record its time to first byte.
+ */
+- (void)transferDidStartForSessionTask:(NSURLSessionTask *)sessionTask {
+    NSString *host = sessionTask.currentRequest.URL.host ?: @"";
+    pthread_mutex_lock(&_lock);
+    NSNumber *resumeTime = self.resumeTimes[@(sessionTask.taskIdentifier)];
+    [self.resumeTimes removeObjectForKey:@(sessionTask.taskIdentifier)];
+    BOOL started = self.transferHosts[@(sessionTask.taskIdentifier)] != nil;
+    self.transferHosts[@(sessionTask.taskIdentifier)] = host;
+    pthread_mutex_unlock(&_lock);
+    if (started) {
+        return;
+    }
+
+    if (resumeTime) {
+        [self.bandwidthEstimator recordTimeToFirstByte:CFAbsoluteTimeGetCurrent() - resumeTime.doubleValue
+                                               forHost:host];
+    }
+    [self.bandwidthEstimator transferDidStartForHost:host];
+}
+
+- (void)transferDidReceiveDataWithLength:(NSUInteger)length
+                          forSessionTask:(NSURLSessionTask *)sessionTask {
+    pthread_mutex_lock(&_lock);
+    NSString *host = self.transferHosts[@(sessionTask.taskIdentifier)];
+    pthread_mutex_unlock(&_lock);
+    if (host && [self.bandwidthEstimator transferDidReceiveDataWithLength:length forHost:host]) {
+        [self callBandwidthDelegateMethod];
+    }
+}
+
+- (void)transferDidEndForSessionTask:(NSURLSessionTask *)sessionTask {
+    pthread_mutex_lock(&_lock);
+    NSString *host = self.transferHosts[@(sessionTask.taskIdentifier)];
+    [self.transferHosts removeObjectForKey:@(sessionTask.taskIdentifier)];
+    [self.resumeTimes removeObjectForKey:@(sessionTask.taskIdentifier)];
+    pthread_mutex_unlock(&_lock);
+    if (host && [self.bandwidthEstimator transferDidEndForHost:host]) {
+        [self callBandwidthDelegateMethod];
+    }
+}
+
+- (void)callBandwidthDelegateMethod {
+    JPVideoPlayerBandwidthEstimate *estimate = [self.bandwidthEstimator estimate];
+    JPDebugLog(@"Downloader 带宽估计: %@", estimate);
+    JPDispatchAsyncOnMainQueue(^{
+        if (self.delegate && [self.delegate respondsToSelector:@selector(downloader:didUpdateBandwidthEstimate:)]) {
+            [self.delegate downloader:self didUpdateBandwidthEstimate:estimate];
+        }
+    });
+}
+
 - (void)reset {
     JPDebugLog(@"调用了 reset");
+    // the request tasks and the queues are cleaned when the data tasks complete, the cancelled tasks complete too,
+    // clean them here drop the completions before they route back to the tasks.
     self.runningTask = nil;
-    self.expectedSize = 0;
-    self.receivedSize = 0;
 }
 
 @end
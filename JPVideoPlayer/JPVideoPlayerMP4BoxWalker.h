@@ -0,0 +1,67 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A streaming walker of the top level boxes of an ISO-BMFF (MP4) file, used to locate the `moov` box.
+ * Feed it the data at `nextBoxOffset`, it read the box headers inside the data and jump over the box payloads,
+ * so a file with `moov` at the end only need the first KB and a few bytes near the end.
+ * Note this class is not thread safe.
+ */
+@interface JPVideoPlayerMP4BoxWalker : NSObject
+
+/**
+ * The length of file in bytes.
+ */
+@property (nonatomic, assign, readonly) NSUInteger fileLength;
+
+/**
+ * The offset of the next box header to read.
+ */
+@property (nonatomic, assign, readonly) NSUInteger nextBoxOffset;
+
+/**
+ * The range of `moov` box, `JPInvalidRange` if not found yet.
+ */
+@property (nonatomic, assign, readonly) NSRange moovRange;
+
+/**
+ * A flag represent the walk finished, the `moov` box found, or the file is not a valid MP4 file,
+ * or reach the end of file.
+ */
+@property (nonatomic, assign, readonly, getter=isFinished) BOOL finished;
+
+/**
+ * Designated initializer method.
+ *
+ * @param fileLength The length of file in bytes.
+ *
+ * @return A instance of this class.
+ */
+- (instancetype)initWithFileLength:(NSUInteger)fileLength NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ * Read the box headers inside given data, the data must contain `nextBoxOffset` to make progress.
+ *
+ * @param data   The data of file.
+ * @param offset The offset of data in file.
+ */
+- (void)appendData:(NSData *)data
+          atOffset:(NSUInteger)offset;
+
+@end
+
+NS_ASSUME_NONNULL_END
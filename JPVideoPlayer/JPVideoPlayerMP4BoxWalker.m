@@ -0,0 +1,81 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerMP4BoxWalker.h"
+#import "JPVideoPlayerCompat.h"
+
+static const uint32_t kJPVideoPlayerMP4BoxTypeFtyp = 0x66747970; // 'ftyp'
+static const uint32_t kJPVideoPlayerMP4BoxTypeMoov = 0x6d6f6f76; // 'moov'
+static const NSUInteger kJPVideoPlayerMP4BoxHeaderLength = 8;
+static const NSUInteger kJPVideoPlayerMP4LargeBoxHeaderLength = 16;
+
+static uint32_t JPReadUInt32BigEndian(const uint8_t *bytes) {
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+}
+
+@implementation JPVideoPlayerMP4BoxWalker
+
+- (instancetype)initWithFileLength:(NSUInteger)fileLength {
+    self = [super init];
+    if (self) {
+        _fileLength = fileLength;
+        _nextBoxOffset = 0;
+        _moovRange = JPInvalidRange;
+        _finished = fileLength < kJPVideoPlayerMP4BoxHeaderLength;
+    }
+    return self;
+}
+
+- (void)appendData:(NSData *)data
+          atOffset:(NSUInteger)offset {
+    const uint8_t *bytes = data.bytes;
+    NSUInteger dataEnd = offset + data.length;
+    while (!self.finished && self.nextBoxOffset >= offset && self.nextBoxOffset + kJPVideoPlayerMP4BoxHeaderLength <= dataEnd) {
+        const uint8_t *header = bytes + (self.nextBoxOffset - offset);
+        uint64_t boxSize = JPReadUInt32BigEndian(header);
+        uint32_t boxType = JPReadUInt32BigEndian(header + 4);
+        NSUInteger headerLength = kJPVideoPlayerMP4BoxHeaderLength;
+        if (boxSize == 1) {
+            // the 64-bit size follow the type.
+            if (self.nextBoxOffset + kJPVideoPlayerMP4LargeBoxHeaderLength > dataEnd) {
+                break;
+            }
+            boxSize = ((uint64_t)JPReadUInt32BigEndian(header + 8) << 32) | JPReadUInt32BigEndian(header + 12);
+            headerLength = kJPVideoPlayerMP4LargeBoxHeaderLength;
+        }
+        else if (boxSize == 0) {
+            // the box extend to the end of file.
+            boxSize = self.fileLength - self.nextBoxOffset;
+        }
+
+        BOOL isValidBox = boxSize >= headerLength && boxSize <= self.fileLength - self.nextBoxOffset;
+        if (self.nextBoxOffset == 0 && boxType != kJPVideoPlayerMP4BoxTypeFtyp) {
+            isValidBox = NO;
+        }
+        if (!isValidBox) {
+            JPDebugLog(@"MP4BoxWalker 遇到无效的 box, offset: %ld", self.nextBoxOffset);
+            _finished = YES;
+            break;
+        }
+        if (boxType == kJPVideoPlayerMP4BoxTypeMoov) {
+            _moovRange = NSMakeRange(self.nextBoxOffset, (NSUInteger)boxSize);
+            _finished = YES;
+            break;
+        }
+
+        _nextBoxOffset += (NSUInteger)boxSize;
+        if (self.nextBoxOffset + kJPVideoPlayerMP4BoxHeaderLength > self.fileLength) {
+            _finished = YES;
+        }
+    }
+}
+
+@end
@@ -0,0 +1,56 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A time to byte index of a MP4 file, built from the sample tables (`stts`, `stss`, `stsc`, `stco`/`co64`, `stsz`)
+ * of every video and audio track in the `moov` box.
+ * The sample times and offsets are expanded into flat arrays once, a lookup is a binary search over them and
+ * allocate nothing. Edit lists and composition offsets are ignored, the decode time is close enough to
+ * choose the bytes to prefetch.
+ * Note this class is not thread safe.
+ */
+@interface JPVideoPlayerMP4SeekIndex : NSObject
+
+/**
+ * The duration of the longest track, in seconds.
+ */
+@property (nonatomic, assign, readonly) NSTimeInterval duration;
+
+/**
+ * Build the index from the data of `moov` box.
+ *
+ * @param moovData The data of the whole `moov` box, include its header.
+ *
+ * @return A instance of this class, nil if no valid track found.
+ */
++ (instancetype _Nullable)seekIndexWithMoovData:(NSData *)moovData;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ * Fetch the bytes the player need to play from given time. For a video track the range start from the sync sample
+ * at or before `time - window`, because the decoding start from a sync sample.
+ *
+ * @param time   The time to seek to, in seconds.
+ * @param window The duration of video to cover before and after `time`, in seconds.
+ *
+ * @return The range of file cover the samples of all tracks, `JPInvalidRange` if time is out of the video.
+ */
+- (NSRange)byteRangeForTime:(NSTimeInterval)time
+                     window:(NSTimeInterval)window;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,402 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerMP4SeekIndex.h"
+#import "JPVideoPlayerCompat.h"
+
+/**
+ * The sample tables of one track expanded into flat arrays, the index of array is the index of sample.
+ */
+typedef struct {
+    uint32_t timescale;
+    BOOL isVideo;
+    uint32_t sampleCount;
+    // the decode time of every sample, ascending, in timescale.
+    uint64_t *decodeTimes;
+    uint64_t *offsets;
+    // nil if all samples have `constantSampleSize`.
+    uint32_t *sizes;
+    uint32_t constantSampleSize;
+    // the indexes of sync samples, ascending, nil if every sample is a sync sample.
+    uint32_t *syncSamples;
+    uint32_t syncSampleCount;
+    uint64_t duration;
+} JPMP4SeekTrack;
+
+static const uint32_t kJPMP4BoxTypeTrak = 0x7472616b; // 'trak'
+static const uint32_t kJPMP4BoxTypeMdia = 0x6d646961; // 'mdia'
+static const uint32_t kJPMP4BoxTypeMdhd = 0x6d646864; // 'mdhd'
+static const uint32_t kJPMP4BoxTypeHdlr = 0x68646c72; // 'hdlr'
+static const uint32_t kJPMP4BoxTypeMinf = 0x6d696e66; // 'minf'
+static const uint32_t kJPMP4BoxTypeStbl = 0x7374626c; // 'stbl'
+static const uint32_t kJPMP4BoxTypeStts = 0x73747473; // 'stts'
+static const uint32_t kJPMP4BoxTypeStss = 0x73747373; // 'stss'
+static const uint32_t kJPMP4BoxTypeStsc = 0x73747363; // 'stsc'
+static const uint32_t kJPMP4BoxTypeStsz = 0x7374737a; // 'stsz'
+static const uint32_t kJPMP4BoxTypeStco = 0x7374636f; // 'stco'
+static const uint32_t kJPMP4BoxTypeCo64 = 0x636f3634; // 'co64'
+static const uint32_t kJPMP4HandlerTypeVideo = 0x76696465; // 'vide'
+static const uint32_t kJPMP4HandlerTypeSound = 0x736f756e; // 'soun'
+// refuse the broken tables, a real track never have so many samples.
+static const uint32_t kJPMP4MaxSampleCount = 1 << 26;
+
+static uint32_t JPMP4ReadUInt32(const uint8_t *bytes) {
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+}
+
+static uint64_t JPMP4ReadUInt64(const uint8_t *bytes) {
+    return ((uint64_t)JPMP4ReadUInt32(bytes) << 32) | JPMP4ReadUInt32(bytes + 4);
+}
+
+/**
+ * Read the box at `*offset` and move `*offset` to the next box.
+ *
+ * @return NO if no more box or the box is invalid.
+ */
+static BOOL JPMP4NextBox(const uint8_t *bytes, size_t length, size_t *offset, uint32_t *type, const uint8_t **payload, size_t *payloadLength) {
+    if (*offset + 8 > length) {
+        return NO;
+    }
+
+    const uint8_t *header = bytes + *offset;
+    uint64_t boxSize = JPMP4ReadUInt32(header);
+    size_t headerLength = 8;
+    if (boxSize == 1) {
+        if (*offset + 16 > length) {
+            return NO;
+        }
+        boxSize = JPMP4ReadUInt64(header + 8);
+        headerLength = 16;
+    }
+    else if (boxSize == 0) {
+        boxSize = length - *offset;
+    }
+    if (boxSize < headerLength || boxSize > length - *offset) {
+        return NO;
+    }
+
+    *type = JPMP4ReadUInt32(header + 4);
+    *payload = header + headerLength;
+    *payloadLength = (size_t)boxSize - headerLength;
+    *offset += (size_t)boxSize;
+    return YES;
+}
+
+static BOOL JPMP4FindBox(const uint8_t *bytes, size_t length, uint32_t type, const uint8_t **payload, size_t *payloadLength) {
+    size_t offset = 0;
+    uint32_t boxType = 0;
+    while (JPMP4NextBox(bytes, length, &offset, &boxType, payload, payloadLength)) {
+        if (boxType == type) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+static void JPMP4SeekTrackFree(JPMP4SeekTrack *track) {
+    free(track->decodeTimes);
+    free(track->offsets);
+    free(track->sizes);
+    free(track->syncSamples);
+    memset(track, 0, sizeof(JPMP4SeekTrack));
+}
+
+static uint32_t JPMP4SeekTrackSampleSize(const JPMP4SeekTrack *track, uint32_t index) {
+    return track->sizes ? track->sizes[index] : track->constantSampleSize;
+}
+
+static BOOL JPMP4SeekTrackParseTimes(JPMP4SeekTrack *track, const uint8_t *stts, size_t sttsLength) {
+    if (sttsLength < 8) {
+        return NO;
+    }
+    uint32_t entryCount = JPMP4ReadUInt32(stts + 4);
+    if ((sttsLength - 8) / 8 < entryCount) {
+        return NO;
+    }
+
+    uint64_t time = 0;
+    uint32_t index = 0;
+    for (uint32_t i = 0; i < entryCount && index < track->sampleCount; i++) {
+        uint32_t sampleCount = JPMP4ReadUInt32(stts + 8 + i * 8);
+        uint32_t sampleDelta = JPMP4ReadUInt32(stts + 12 + i * 8);
+        for (uint32_t j = 0; j < sampleCount && index < track->sampleCount; j++) {
+            track->decodeTimes[index++] = time;
+            time += sampleDelta;
+        }
+    }
+    // a short table, the rest samples share the last time.
+    while (index < track->sampleCount) {
+        track->decodeTimes[index++] = time;
+    }
+    track->duration = time;
+    return YES;
+}
+
+static BOOL JPMP4SeekTrackParseOffsets(JPMP4SeekTrack *track,
+                                       const uint8_t *stsc, size_t stscLength,
+                                       const uint8_t *chunkOffsets, size_t chunkOffsetsLength, BOOL largeOffset) {
+    if (stscLength < 8 || chunkOffsetsLength < 8) {
+        return NO;
+    }
+    uint32_t stscCount = JPMP4ReadUInt32(stsc + 4);
+    uint32_t chunkCount = JPMP4ReadUInt32(chunkOffsets + 4);
+    size_t offsetSize = largeOffset ? 8 : 4;
+    if (!stscCount || (stscLength - 8) / 12 < stscCount || (chunkOffsetsLength - 8) / offsetSize < chunkCount) {
+        return NO;
+    }
+
+    uint32_t index = 0;
+    uint32_t stscIndex = 0;
+    for (uint32_t chunk = 0; chunk < chunkCount && index < track->sampleCount; chunk++) {
+        // the chunk numbers in `stsc` start from 1.
+        while (stscIndex + 1 < stscCount && JPMP4ReadUInt32(stsc + 8 + (stscIndex + 1) * 12) <= chunk + 1) {
+            stscIndex++;
+        }
+        uint32_t samplesPerChunk = JPMP4ReadUInt32(stsc + 8 + stscIndex * 12 + 4);
+        const uint8_t *entry = chunkOffsets + 8 + chunk * offsetSize;
+        uint64_t offset = largeOffset ? JPMP4ReadUInt64(entry) : JPMP4ReadUInt32(entry);
+        for (uint32_t j = 0; j < samplesPerChunk && index < track->sampleCount; j++) {
+            track->offsets[index] = offset;
+            offset += JPMP4SeekTrackSampleSize(track, index);
+            index++;
+        }
+    }
+    return index == track->sampleCount;
+}
+
+static BOOL JPMP4SeekTrackParse(JPMP4SeekTrack *track, const uint8_t *trak, size_t trakLength) {
+    const uint8_t *mdia, *mdhd, *hdlr, *minf, *stbl;
+    size_t mdiaLength, mdhdLength, hdlrLength, minfLength, stblLength;
+    if (!JPMP4FindBox(trak, trakLength, kJPMP4BoxTypeMdia, &mdia, &mdiaLength) ||
+        !JPMP4FindBox(mdia, mdiaLength, kJPMP4BoxTypeMdhd, &mdhd, &mdhdLength) ||
+        !JPMP4FindBox(mdia, mdiaLength, kJPMP4BoxTypeHdlr, &hdlr, &hdlrLength) ||
+        !JPMP4FindBox(mdia, mdiaLength, kJPMP4BoxTypeMinf, &minf, &minfLength) ||
+        !JPMP4FindBox(minf, minfLength, kJPMP4BoxTypeStbl, &stbl, &stblLength)) {
+        return NO;
+    }
+
+    if (hdlrLength < 12) {
+        return NO;
+    }
+    uint32_t handlerType = JPMP4ReadUInt32(hdlr + 8);
+    if (handlerType != kJPMP4HandlerTypeVideo && handlerType != kJPMP4HandlerTypeSound) {
+        return NO;
+    }
+    track->isVideo = handlerType == kJPMP4HandlerTypeVideo;
+
+    // version 1 of `mdhd` use 64-bit creation and modification time.
+    if (mdhdLength < 24 || (mdhd[0] == 1 && mdhdLength < 36)) {
+        return NO;
+    }
+    track->timescale = JPMP4ReadUInt32(mdhd + (mdhd[0] == 1 ? 20 : 12));
+    if (!track->timescale) {
+        return NO;
+    }
+
+    const uint8_t *stsz, *stts, *stsc, *chunkOffsets, *stss;
+    size_t stszLength, sttsLength, stscLength, chunkOffsetsLength, stssLength;
+    if (!JPMP4FindBox(stbl, stblLength, kJPMP4BoxTypeStsz, &stsz, &stszLength) ||
+        !JPMP4FindBox(stbl, stblLength, kJPMP4BoxTypeStts, &stts, &sttsLength) ||
+        !JPMP4FindBox(stbl, stblLength, kJPMP4BoxTypeStsc, &stsc, &stscLength)) {
+        return NO;
+    }
+    BOOL largeOffset = NO;
+    if (!JPMP4FindBox(stbl, stblLength, kJPMP4BoxTypeStco, &chunkOffsets, &chunkOffsetsLength)) {
+        largeOffset = YES;
+        if (!JPMP4FindBox(stbl, stblLength, kJPMP4BoxTypeCo64, &chunkOffsets, &chunkOffsetsLength)) {
+            return NO;
+        }
+    }
+
+    if (stszLength < 12) {
+        return NO;
+    }
+    track->constantSampleSize = JPMP4ReadUInt32(stsz + 4);
+    track->sampleCount = JPMP4ReadUInt32(stsz + 8);
+    if (!track->sampleCount || track->sampleCount > kJPMP4MaxSampleCount) {
+        return NO;
+    }
+    if (!track->constantSampleSize) {
+        if ((stszLength - 12) / 4 < track->sampleCount) {
+            return NO;
+        }
+        track->sizes = malloc(track->sampleCount * sizeof(uint32_t));
+        for (uint32_t i = 0; i < track->sampleCount; i++) {
+            track->sizes[i] = JPMP4ReadUInt32(stsz + 12 + i * 4);
+        }
+    }
+
+    track->decodeTimes = malloc(track->sampleCount * sizeof(uint64_t));
+    track->offsets = malloc(track->sampleCount * sizeof(uint64_t));
+    if (!JPMP4SeekTrackParseTimes(track, stts, sttsLength) ||
+        !JPMP4SeekTrackParseOffsets(track, stsc, stscLength, chunkOffsets, chunkOffsetsLength, largeOffset)) {
+        return NO;
+    }
+
+    // no `stss` mean every sample is a sync sample.
+    if (track->isVideo && JPMP4FindBox(stbl, stblLength, kJPMP4BoxTypeStss, &stss, &stssLength) && stssLength >= 8) {
+        uint32_t syncSampleCount = JPMP4ReadUInt32(stss + 4);
+        if ((stssLength - 8) / 4 < syncSampleCount) {
+            return NO;
+        }
+        track->syncSamples = malloc(MAX(syncSampleCount, 1) * sizeof(uint32_t));
+        for (uint32_t i = 0; i < syncSampleCount; i++) {
+            // the sample numbers in `stss` start from 1.
+            uint32_t sampleNumber = JPMP4ReadUInt32(stss + 8 + i * 4);
+            track->syncSamples[i] = sampleNumber ? sampleNumber - 1 : 0;
+        }
+        track->syncSampleCount = syncSampleCount;
+    }
+    return YES;
+}
+
+/**
+ * The index of the last element not greater than value in an ascending array, 0 if all elements greater than value.
+ */
+static uint32_t JPMP4LastIndexNotGreaterThan64(const uint64_t *array, uint32_t count, uint64_t value) {
+    uint32_t low = 0, high = count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (array[middle] <= value) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return low ? low - 1 : 0;
+}
+
+static uint32_t JPMP4LastIndexNotGreaterThan32(const uint32_t *array, uint32_t count, uint32_t value) {
+    uint32_t low = 0, high = count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (array[middle] <= value) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return low ? low - 1 : 0;
+}
+
+@interface JPVideoPlayerMP4SeekIndex() {
+    JPMP4SeekTrack *_tracks;
+    NSUInteger _trackCount;
+}
+
+@end
+
+@implementation JPVideoPlayerMP4SeekIndex
+
+- (void)dealloc {
+    for (NSUInteger i = 0; i < _trackCount; i++) {
+        JPMP4SeekTrackFree(&_tracks[i]);
+    }
+    free(_tracks);
+}
+
++ (instancetype)seekIndexWithMoovData:(NSData *)moovData {
+    const uint8_t *moov = NULL;
+    size_t moovLength = 0;
+    uint32_t boxType = 0;
+    size_t offset = 0;
+    if (!JPMP4NextBox(moovData.bytes, moovData.length, &offset, &boxType, &moov, &moovLength)) {
+        return nil;
+    }
+
+    // count the tracks first, allocate the tracks in one piece.
+    NSUInteger trakCount = 0;
+    const uint8_t *trak = NULL;
+    size_t trakLength = 0;
+    offset = 0;
+    while (JPMP4NextBox(moov, moovLength, &offset, &boxType, &trak, &trakLength)) {
+        if (boxType == kJPMP4BoxTypeTrak) {
+            trakCount++;
+        }
+    }
+    if (!trakCount) {
+        return nil;
+    }
+
+    JPMP4SeekTrack *tracks = calloc(trakCount, sizeof(JPMP4SeekTrack));
+    NSUInteger trackCount = 0;
+    offset = 0;
+    while (JPMP4NextBox(moov, moovLength, &offset, &boxType, &trak, &trakLength)) {
+        if (boxType != kJPMP4BoxTypeTrak) {
+            continue;
+        }
+        if (JPMP4SeekTrackParse(&tracks[trackCount], trak, trakLength)) {
+            trackCount++;
+        }
+        else {
+            JPMP4SeekTrackFree(&tracks[trackCount]);
+        }
+    }
+    if (!trackCount) {
+        free(tracks);
+        JPDebugLog(@"MP4SeekIndex 没有找到有效的音视频轨道");
+        return nil;
+    }
+
+    JPVideoPlayerMP4SeekIndex *seekIndex = [[JPVideoPlayerMP4SeekIndex alloc] initWithTracks:tracks
+                                                                                      count:trackCount];
+    return seekIndex;
+}
+
+- (instancetype)initWithTracks:(JPMP4SeekTrack *)tracks
+                         count:(NSUInteger)count {
+    self = [super init];
+    if (self) {
+        _tracks = tracks;
+        _trackCount = count;
+        NSTimeInterval duration = 0;
+        for (NSUInteger i = 0; i < count; i++) {
+            duration = MAX(duration, (NSTimeInterval)tracks[i].duration / tracks[i].timescale);
+        }
+        _duration = duration;
+    }
+    return self;
+}
+
+- (NSRange)byteRangeForTime:(NSTimeInterval)time
+                     window:(NSTimeInterval)window {
+    if (time < 0 || time > self.duration) {
+        return JPInvalidRange;
+    }
+
+    uint64_t start = UINT64_MAX;
+    uint64_t end = 0;
+    for (NSUInteger i = 0; i < _trackCount; i++) {
+        const JPMP4SeekTrack *track = &_tracks[i];
+        uint64_t startTime = (uint64_t)(MAX(time - window, 0) * track->timescale);
+        uint64_t endTime = (uint64_t)((time + window) * track->timescale);
+        if (startTime >= track->duration) {
+            continue;
+        }
+
+        uint32_t startIndex = JPMP4LastIndexNotGreaterThan64(track->decodeTimes, track->sampleCount, startTime);
+        if (track->isVideo && track->syncSamples && track->syncSampleCount) {
+            uint32_t syncIndex = JPMP4LastIndexNotGreaterThan32(track->syncSamples, track->syncSampleCount, startIndex);
+            startIndex = MIN(track->syncSamples[syncIndex], startIndex);
+        }
+        uint32_t endIndex = JPMP4LastIndexNotGreaterThan64(track->decodeTimes, track->sampleCount, endTime);
+        start = MIN(start, track->offsets[startIndex]);
+        end = MAX(end, track->offsets[endIndex] + JPMP4SeekTrackSampleSize(track, endIndex));
+    }
+    if (end <= start) {
+        return JPInvalidRange;
+    }
+    return NSMakeRange((NSUInteger)start, (NSUInteger)(end - start));
+}
+
+@end
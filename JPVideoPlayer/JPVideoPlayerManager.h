@@ -81,6 +81,17 @@ NS_ASSUME_NONNULL_BEGIN
                                        expectedSize:(NSUInteger)expectedSize
                                               error:(NSError *_Nullable)error;
 
+/**
+ * Notify the network estimate when a new throughput sample is measured. this method will be called on main thread.
+ * Use it to decide the prefetch budget or the quality of video to play.
+ *
+ * @param videoPlayerManager The current `JPVideoPlayerManager`.
+ * @param estimate           The estimate of all hosts, the estimate of one host can be fetched from
+ *                            `videoDownloader.bandwidthEstimator`.
+ */
+- (void)videoPlayerManager:(JPVideoPlayerManager *)videoPlayerManager
+didUpdateBandwidthEstimate:(JPVideoPlayerBandwidthEstimate *)estimate;
+
 /**
  * Notify the playing progress value. this method will be called on main thread.
  *
@@ -255,6 +266,13 @@ shouldResumePlaybackFromPlaybackRecordForURL:(NSURL *)videoURL
                   options:(JPVideoPlayerOptions)options
             configuration:(JPVideoPlayerConfiguration)configuration;
 
+/**
+ * Download the data of given time ahead, call it while the user is dragging the progress.
+ *
+ * @param time The time the user is dragging to, in seconds.
+ */
+- (void)prefetchVideoDataForSeekingToTime:(NSTimeInterval)time;
+
 /**
  * Return the cache key for a given URL.
  */
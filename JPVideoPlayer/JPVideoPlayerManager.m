@@ -66,13 +66,18 @@ static NSString * const JPVideoPlayerSDKVersionKey = @"com.jpvideoplayer.sdk.ver
     static JPVideoPlayerManager *jpVideoPlayerManagerInstance;
     dispatch_once(&once, ^{
         jpVideoPlayerManagerInstance = [self new];
-        [[NSUserDefaults standardUserDefaults] setObject:@"3.1.1" forKey:JPVideoPlayerSDKVersionKey];
+        [[NSUserDefaults standardUserDefaults] setObject:@"3.2.0" forKey:JPVideoPlayerSDKVersionKey];
         [[NSUserDefaults standardUserDefaults] synchronize];
         [JPMigration migrateToSDKVersion:@"3.1.1" block:^{
 
             [jpVideoPlayerManagerInstance.videoCache clearDiskOnCompletion:nil];
 
         }];
+        [JPMigration migrateToSDKVersion:@"3.2.0" block:^{
+
+            [jpVideoPlayerManagerInstance.videoCache upgradeLegacyIndexFilesOnCompletion:nil];
+
+        }];
     });
     return jpVideoPlayerManagerInstance;
 }
@@ -303,6 +308,10 @@ static NSString * const JPVideoPlayerSDKVersionKey = @"com.jpvideoplayer.sdk.ver
     return [self.videoPlayer seekToTime:time];
 }
 
+- (void)prefetchVideoDataForSeekingToTime:(NSTimeInterval)time {
+    [self.videoPlayer.playerModel.resourceLoader prefetchDataForSeekingToTime:time];
+}
+
 - (NSTimeInterval)elapsedSeconds {
     return [self.videoPlayer elapsedSeconds];
 }
@@ -325,7 +334,8 @@ static NSString * const JPVideoPlayerSDKVersionKey = @"com.jpvideoplayer.sdk.ver
 
 - (void)stopPlay {
     JPDispatchSyncOnMainQueue(^{
-        [self.videoDownloader cancel];
+        // the downloader is shared by the players, only cancel the download of this one.
+        [self.videoDownloader cancelRequestTasksWithCustomURL:self.managerModel.videoURL];
         [self.videoPlayer stopPlay];
         [self reset];
     });
@@ -335,8 +345,10 @@ static NSString * const JPVideoPlayerSDKVersionKey = @"com.jpvideoplayer.sdk.ver
 #pragma mark - JPVideoPlayerInternalDelegate
 
 - (void)videoPlayer:(nonnull JPVideoPlayer *)videoPlayer
-didReceiveLoadingRequestTask:(JPResourceLoadingRequestWebTask *)requestTask {
-    JPVideoPlayerDownloaderOptions downloaderOptions = [self fetchDownloadOptionsWithOptions:videoPlayer.playerModel.playerOptions];
+didReceiveLoadingRequestTask:(JPResourceLoadingRequestWebTask *)requestTask
+      playerOptions:(JPVideoPlayerOptions)playerOptions {
+    // called on the queue of resource loader, use the options captured by it, the player model belong to main queue.
+    JPVideoPlayerDownloaderOptions downloaderOptions = [self fetchDownloadOptionsWithOptions:playerOptions];
     [self.videoDownloader downloadVideoWithRequestTask:requestTask
                                        downloadOptions:downloaderOptions];
 }
@@ -416,6 +428,13 @@ didReceiveResponse:(NSURLResponse *)response {
                                                  error:nil];
 }
 
+- (void)downloader:(JPVideoPlayerDownloader *)downloader
+didUpdateBandwidthEstimate:(JPVideoPlayerBandwidthEstimate *)estimate {
+    if (self.delegate && [self.delegate respondsToSelector:@selector(videoPlayerManager:didUpdateBandwidthEstimate:)]) {
+        [self.delegate videoPlayerManager:self didUpdateBandwidthEstimate:estimate];
+    }
+}
+
 - (void)downloader:(JPVideoPlayerDownloader *)downloader
 didCompleteWithError:(NSError *)error {
     if (error){
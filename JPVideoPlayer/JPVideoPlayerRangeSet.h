@@ -0,0 +1,137 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A sorted collection of disjoint byte ranges.
+ * The ranges are kept in a flat array of 64-bit start/end pairs, so lookup is a binary search
+ * and adding a range merges it with the overlapping or adjacent ranges in place.
+ * Note this class is not thread safe.
+ */
+@interface JPVideoPlayerRangeSet : NSObject<NSCopying>
+
+/**
+ * Create a set contain given range.
+ *
+ * @param range A byte range.
+ *
+ * @return A range set.
+ */
++ (instancetype)rangeSetWithRange:(NSRange)range;
+
+/**
+ * The number of disjoint ranges in the set.
+ */
+@property (nonatomic, assign, readonly) NSUInteger count;
+
+/**
+ * The end point of the last range, 0 if the set is empty.
+ */
+@property (nonatomic, assign, readonly) NSUInteger upperBound;
+
+/**
+ * All ranges in ascending order.
+ */
+@property (nonatomic, strong, readonly) NSArray<NSValue *> *ranges;
+
+/**
+ * Add a range to the set, the range will be merged with the overlapping or adjacent ranges.
+ *
+ * @param range A byte range.
+ */
+- (void)addRange:(NSRange)range;
+
+/**
+ * Remove a range from the set, the ranges overlapping with it will be cut.
+ *
+ * @param range A byte range.
+ */
+- (void)removeRange:(NSRange)range;
+
+/**
+ * Remove all ranges.
+ */
+- (void)removeAllRanges;
+
+/**
+ * Fetch the range at given index.
+ *
+ * @param index The index of range, must be less than `count`.
+ *
+ * @return The range at given index.
+ */
+- (NSRange)rangeAtIndex:(NSUInteger)index;
+
+/**
+ * Fetch the range contain given position.
+ *
+ * @param position A position.
+ *
+ * @return The range contain given position, `JPInvalidRange` if no range contain the position.
+ */
+- (NSRange)rangeContainsPosition:(NSUInteger)position;
+
+/**
+ * Find the first range not in the set from given position.
+ *
+ * @param position   A position.
+ * @param upperBound The gap will never exceed this bound.
+ *
+ * @return The first range not in the set from given position, `JPInvalidRange` if not found.
+ */
+- (NSRange)firstGapFromPosition:(NSUInteger)position
+                     upperBound:(NSUInteger)upperBound;
+
+/**
+ * Add all ranges of given set to this set.
+ *
+ * @param rangeSet A range set.
+ */
+- (void)unionRangeSet:(JPVideoPlayerRangeSet *)rangeSet;
+
+/**
+ * Keep only the parts of ranges also in given set.
+ *
+ * @param rangeSet A range set.
+ */
+- (void)intersectRangeSet:(JPVideoPlayerRangeSet *)rangeSet;
+
+/**
+ * Remove all ranges of given set from this set.
+ *
+ * @param rangeSet A range set.
+ */
+- (void)subtractRangeSet:(JPVideoPlayerRangeSet *)rangeSet;
+
+/**
+ * Fetch the parts of ranges inside given range.
+ *
+ * @param range A byte range.
+ *
+ * @return A new range set.
+ */
+- (JPVideoPlayerRangeSet *)rangeSetInRange:(NSRange)range;
+
+/**
+ * Fetch the ranges inside given range but not in this set.
+ *
+ * @param range A byte range, such as [0, file length).
+ *
+ * @return A new range set.
+ */
+- (JPVideoPlayerRangeSet *)complementRangeSetInRange:(NSRange)range;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,389 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerRangeSet.h"
+#import "JPVideoPlayerCompat.h"
+
+@interface JPVideoPlayerRangeSet() {
+    // [start0, end0, start1, end1, ...], every range is half-open [start, end).
+    uint64_t *_bounds;
+    NSUInteger _count;
+    NSUInteger _capacity;
+}
+
+@end
+
+typedef NS_ENUM(NSUInteger, JPVideoPlayerRangeSetOperation) {
+    JPVideoPlayerRangeSetOperationUnion = 0,
+    JPVideoPlayerRangeSetOperationIntersect,
+    JPVideoPlayerRangeSetOperationSubtract,
+};
+
+static const NSUInteger kJPVideoPlayerRangeSetInitialCapacity = 8;
+@implementation JPVideoPlayerRangeSet
+
++ (instancetype)rangeSetWithRange:(NSRange)range {
+    JPVideoPlayerRangeSet *set = [self new];
+    [set addRange:range];
+    return set;
+}
+
+- (void)dealloc {
+    free(_bounds);
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _bounds = NULL;
+        _count = 0;
+        _capacity = 0;
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    JPVideoPlayerRangeSet *set = [[self.class allocWithZone:zone] init];
+    if (_count > 0) {
+        [set reserveCapacity:_count];
+        memcpy(set->_bounds, _bounds, _count * 2 * sizeof(uint64_t));
+        set->_count = _count;
+    }
+    return set;
+}
+
+
+#pragma mark - Properties
+
+- (NSUInteger)count {
+    return _count;
+}
+
+- (NSUInteger)upperBound {
+    if (_count == 0) {
+        return 0;
+    }
+    return (NSUInteger)_bounds[_count * 2 - 1];
+}
+
+- (NSArray<NSValue *> *)ranges {
+    NSMutableArray<NSValue *> *ranges = [NSMutableArray arrayWithCapacity:_count];
+    for (NSUInteger i = 0; i < _count; i++) {
+        [ranges addObject:[NSValue valueWithRange:[self rangeAtIndex:i]]];
+    }
+    return [ranges copy];
+}
+
+
+#pragma mark - Public
+
+- (void)addRange:(NSRange)range {
+    if (!JPValidFileRange(range)) {
+        return;
+    }
+
+    uint64_t start = range.location;
+    uint64_t end = (uint64_t)range.location + range.length;
+    // ranges in [lo, hi) overlap or touch the new range.
+    NSUInteger lo = [self indexOfFirstRangeEndNotLessThan:start];
+    NSUInteger hi = [self indexOfFirstRangeStartGreaterThan:end];
+    if (lo == hi) {
+        [self reserveCapacity:_count + 1];
+        memmove(_bounds + (lo + 1) * 2, _bounds + lo * 2, (_count - lo) * 2 * sizeof(uint64_t));
+        _bounds[lo * 2] = start;
+        _bounds[lo * 2 + 1] = end;
+        _count += 1;
+        return;
+    }
+
+    _bounds[lo * 2] = MIN(start, _bounds[lo * 2]);
+    _bounds[lo * 2 + 1] = MAX(end, _bounds[(hi - 1) * 2 + 1]);
+    NSUInteger removed = hi - lo - 1;
+    if (removed > 0) {
+        memmove(_bounds + (lo + 1) * 2, _bounds + hi * 2, (_count - hi) * 2 * sizeof(uint64_t));
+        _count -= removed;
+    }
+}
+
+- (void)removeRange:(NSRange)range {
+    if (!JPValidFileRange(range) || _count == 0) {
+        return;
+    }
+
+    uint64_t start = range.location;
+    uint64_t end = (uint64_t)range.location + range.length;
+    // ranges in [lo, hi) overlap the removed range.
+    NSUInteger lo = [self indexOfFirstRangeEndGreaterThan:start];
+    NSUInteger hi = [self indexOfFirstRangeStartNotLessThan:end];
+    if (lo >= hi) {
+        return;
+    }
+
+    uint64_t remnants[4];
+    NSUInteger remnantCount = 0;
+    if (_bounds[lo * 2] < start) {
+        remnants[remnantCount * 2] = _bounds[lo * 2];
+        remnants[remnantCount * 2 + 1] = start;
+        remnantCount++;
+    }
+    if (_bounds[(hi - 1) * 2 + 1] > end) {
+        remnants[remnantCount * 2] = end;
+        remnants[remnantCount * 2 + 1] = _bounds[(hi - 1) * 2 + 1];
+        remnantCount++;
+    }
+
+    NSUInteger newCount = _count - (hi - lo) + remnantCount;
+    [self reserveCapacity:newCount];
+    memmove(_bounds + (lo + remnantCount) * 2, _bounds + hi * 2, (_count - hi) * 2 * sizeof(uint64_t));
+    if (remnantCount) {
+        memcpy(_bounds + lo * 2, remnants, remnantCount * 2 * sizeof(uint64_t));
+    }
+    _count = newCount;
+}
+
+- (void)removeAllRanges {
+    _count = 0;
+}
+
+- (NSRange)rangeAtIndex:(NSUInteger)index {
+    NSParameterAssert(index < _count);
+    if (index >= _count) {
+        return JPInvalidRange;
+    }
+    return NSMakeRange((NSUInteger)_bounds[index * 2], (NSUInteger)(_bounds[index * 2 + 1] - _bounds[index * 2]));
+}
+
+- (NSRange)rangeContainsPosition:(NSUInteger)position {
+    NSUInteger index = [self indexOfFirstRangeEndGreaterThan:position];
+    if (index < _count && _bounds[index * 2] <= position) {
+        return [self rangeAtIndex:index];
+    }
+    return JPInvalidRange;
+}
+
+- (NSRange)firstGapFromPosition:(NSUInteger)position
+                     upperBound:(NSUInteger)upperBound {
+    uint64_t start = position;
+    NSUInteger index = [self indexOfFirstRangeEndGreaterThan:position];
+    if (index < _count && _bounds[index * 2] <= start) {
+        // the ranges never touch each other, so the next range always start after this end.
+        start = _bounds[index * 2 + 1];
+        index += 1;
+    }
+    if (start >= upperBound) {
+        return JPInvalidRange;
+    }
+
+    uint64_t end = upperBound;
+    if (index < _count) {
+        end = MIN(end, _bounds[index * 2]);
+    }
+    return NSMakeRange((NSUInteger)start, (NSUInteger)(end - start));
+}
+
+- (void)unionRangeSet:(JPVideoPlayerRangeSet *)rangeSet {
+    [self combineWithRangeSet:rangeSet operation:JPVideoPlayerRangeSetOperationUnion];
+}
+
+- (void)intersectRangeSet:(JPVideoPlayerRangeSet *)rangeSet {
+    [self combineWithRangeSet:rangeSet operation:JPVideoPlayerRangeSetOperationIntersect];
+}
+
+- (void)subtractRangeSet:(JPVideoPlayerRangeSet *)rangeSet {
+    [self combineWithRangeSet:rangeSet operation:JPVideoPlayerRangeSetOperationSubtract];
+}
+
+- (JPVideoPlayerRangeSet *)rangeSetInRange:(NSRange)range {
+    JPVideoPlayerRangeSet *set = [JPVideoPlayerRangeSet new];
+    if (!JPValidFileRange(range)) {
+        return set;
+    }
+
+    uint64_t start = range.location;
+    uint64_t end = (uint64_t)range.location + range.length;
+    NSUInteger lo = [self indexOfFirstRangeEndGreaterThan:start];
+    NSUInteger hi = [self indexOfFirstRangeStartNotLessThan:end];
+    if (lo >= hi) {
+        return set;
+    }
+
+    // only the first and the last range maybe cut.
+    [set reserveCapacity:hi - lo];
+    memcpy(set->_bounds, _bounds + lo * 2, (hi - lo) * 2 * sizeof(uint64_t));
+    set->_count = hi - lo;
+    set->_bounds[0] = MAX(set->_bounds[0], start);
+    set->_bounds[set->_count * 2 - 1] = MIN(set->_bounds[set->_count * 2 - 1], end);
+    return set;
+}
+
+- (JPVideoPlayerRangeSet *)complementRangeSetInRange:(NSRange)range {
+    JPVideoPlayerRangeSet *set = [JPVideoPlayerRangeSet new];
+    if (!JPValidFileRange(range)) {
+        return set;
+    }
+
+    uint64_t start = range.location;
+    uint64_t end = (uint64_t)range.location + range.length;
+    NSUInteger lo = [self indexOfFirstRangeEndGreaterThan:start];
+    NSUInteger hi = [self indexOfFirstRangeStartNotLessThan:end];
+    [set reserveCapacity:hi - lo + 1];
+    uint64_t position = start;
+    for (NSUInteger i = lo; i < hi; i++) {
+        if (_bounds[i * 2] > position) {
+            set->_bounds[set->_count * 2] = position;
+            set->_bounds[set->_count * 2 + 1] = _bounds[i * 2];
+            set->_count += 1;
+        }
+        position = _bounds[i * 2 + 1];
+    }
+    if (position < end) {
+        set->_bounds[set->_count * 2] = position;
+        set->_bounds[set->_count * 2 + 1] = end;
+        set->_count += 1;
+    }
+    return set;
+}
+
+
+#pragma mark - Private
+
+/**
+ * Sweep the bounds of both sets in ascending order, a position is in the result if the operation
+ * of whether it is in this set and whether it is in given set is true. O(n + m).
+ */
+- (void)combineWithRangeSet:(JPVideoPlayerRangeSet *)rangeSet
+                  operation:(JPVideoPlayerRangeSetOperation)operation {
+    if (!rangeSet) {
+        return;
+    }
+
+    const uint64_t *bounds = rangeSet->_bounds;
+    NSUInteger boundCount = _count * 2;
+    NSUInteger otherBoundCount = rangeSet->_count * 2;
+    NSUInteger capacity = MAX((boundCount + otherBoundCount) / 2, 1);
+    uint64_t *result = malloc(capacity * 2 * sizeof(uint64_t));
+    NSAssert(result, @"Out of memory when combine the range sets");
+    if (!result) {
+        return;
+    }
+
+    NSUInteger i = 0, j = 0, resultCount = 0;
+    BOOL inSelf = NO, inOther = NO, inResult = NO;
+    while (i < boundCount || j < otherBoundCount) {
+        uint64_t position = MIN(i < boundCount ? _bounds[i] : UINT64_MAX, j < otherBoundCount ? bounds[j] : UINT64_MAX);
+        // the ranges in one set never touch, so every set has at most one bound at a position.
+        if (i < boundCount && _bounds[i] == position) {
+            inSelf = !inSelf;
+            i++;
+        }
+        if (j < otherBoundCount && bounds[j] == position) {
+            inOther = !inOther;
+            j++;
+        }
+
+        BOOL inCombined;
+        switch (operation) {
+            case JPVideoPlayerRangeSetOperationUnion:
+                inCombined = inSelf || inOther;
+                break;
+
+            case JPVideoPlayerRangeSetOperationIntersect:
+                inCombined = inSelf && inOther;
+                break;
+
+            case JPVideoPlayerRangeSetOperationSubtract:
+                inCombined = inSelf && !inOther;
+                break;
+        }
+        if (inCombined != inResult) {
+            result[resultCount++] = position;
+            inResult = inCombined;
+        }
+    }
+
+    free(_bounds);
+    _bounds = result;
+    _capacity = capacity;
+    _count = resultCount / 2;
+}
+
+- (void)reserveCapacity:(NSUInteger)capacity {
+    if (capacity <= _capacity) {
+        return;
+    }
+
+    NSUInteger newCapacity = MAX(_capacity, kJPVideoPlayerRangeSetInitialCapacity);
+    while (newCapacity < capacity) {
+        newCapacity *= 2;
+    }
+    uint64_t *bounds = realloc(_bounds, newCapacity * 2 * sizeof(uint64_t));
+    NSAssert(bounds, @"Out of memory when grow the range set");
+    _bounds = bounds;
+    _capacity = newCapacity;
+}
+
+- (NSUInteger)indexOfFirstRangeEndGreaterThan:(uint64_t)position {
+    NSUInteger lo = 0, hi = _count;
+    while (lo < hi) {
+        NSUInteger mid = lo + (hi - lo) / 2;
+        if (_bounds[mid * 2 + 1] > position) {
+            hi = mid;
+        }
+        else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+- (NSUInteger)indexOfFirstRangeEndNotLessThan:(uint64_t)position {
+    NSUInteger lo = 0, hi = _count;
+    while (lo < hi) {
+        NSUInteger mid = lo + (hi - lo) / 2;
+        if (_bounds[mid * 2 + 1] >= position) {
+            hi = mid;
+        }
+        else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+- (NSUInteger)indexOfFirstRangeStartNotLessThan:(uint64_t)position {
+    NSUInteger lo = 0, hi = _count;
+    while (lo < hi) {
+        NSUInteger mid = lo + (hi - lo) / 2;
+        if (_bounds[mid * 2] >= position) {
+            hi = mid;
+        }
+        else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+- (NSUInteger)indexOfFirstRangeStartGreaterThan:(uint64_t)position {
+    NSUInteger lo = 0, hi = _count;
+    while (lo < hi) {
+        NSUInteger mid = lo + (hi - lo) / 2;
+        if (_bounds[mid * 2] > position) {
+            hi = mid;
+        }
+        else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+@end
@@ -11,6 +11,7 @@
 
 #import <Foundation/Foundation.h>
 #import <AVFoundation/AVFoundation.h>
+#import "JPVideoPlayerCompat.h"
 
 @class JPVideoPlayerResourceLoader,
        JPResourceLoadingRequestWebTask,
@@ -47,6 +48,100 @@ didReceiveLoadingRequestTask:(JPResourceLoadingRequestWebTask *)requestTask;
  */
 @property (nonatomic, strong, readonly) JPVideoPlayerCacheFile *cacheFile;
 
+/**
+ * The private serial queue the loading requests handled on, pass it to `-[AVAssetResourceLoader setDelegate:queue:]`.
+ * The request tasks report to this instance on this queue too, so nothing of loading data run on main queue.
+ */
+@property (nonatomic, strong, readonly) dispatch_queue_t delegateQueue;
+
+/**
+ * The maximum number of web requests run at the same time for the loading requests of this item [defaults to 3].
+ * The loading requests are served concurrently, the cached parts are answered at once and the web parts share this limit.
+ */
+@property (nonatomic, assign) NSUInteger maxConcurrentWebTaskCount;
+
+/**
+ * A flag represent split a large not cached range into segments and download them over several connections
+ * at the same time [defaults to NO]. The segments are written to cache file as they arrive, but responded to
+ * the player in order. The number of connections adapt to the measured throughput, and never exceed
+ * `maxConcurrentWebTaskCount`.
+ */
+@property (nonatomic, assign) BOOL parallelDownloadEnabled;
+
+/**
+ * The options of the player own this instance, set it before the loader handle any loading request.
+ * It is passed to the delegate with the web requests on `delegateQueue`, so the options is not read from the player state.
+ */
+@property (nonatomic, assign) JPVideoPlayerOptions playerOptions;
+
+/**
+ * The size of the first piece of cached data responded to a loading request [defaults to 32 KB].
+ * The following pieces double until `maximumLocalReadChunkSize`, keep the startup latency low for the first bytes
+ * and take less read calls for a large cached range.
+ */
+@property (nonatomic, assign) NSUInteger minimumLocalReadChunkSize;
+
+/**
+ * The maximum size of a piece of cached data responded to a loading request [defaults to 1 MB].
+ */
+@property (nonatomic, assign) NSUInteger maximumLocalReadChunkSize;
+
+/**
+ * The length of video data to download ahead of the range the player requested, in bytes [defaults to
+ * `readAheadLength` of cache configuration]. The read-ahead start when no loading request is in progress,
+ * download into cache file at low priority, and stop when a loading request out of it arrive.
+ */
+@property (nonatomic, assign) NSUInteger readAheadLength;
+
+/**
+ * The duration of video to download ahead, in seconds [defaults to `readAheadDuration` of cache configuration].
+ * Converted to bytes by the average bitrate, need `videoDuration`.
+ */
+@property (nonatomic, assign) NSTimeInterval readAheadDuration;
+
+/**
+ * The length of video data a web request keep downloading into cache after its loading request cancelled, in bytes
+ * [defaults to `backgroundFillLength` of cache configuration]. The request respond nothing anymore, and the loading
+ * requests arrive later receive the data from it if they overlap.
+ */
+@property (nonatomic, assign) NSUInteger backgroundFillLength;
+
+/**
+ * The maximum duration a web request keep downloading after its loading request cancelled, in seconds
+ * [defaults to `backgroundFillDuration` of cache configuration].
+ */
+@property (nonatomic, assign) NSTimeInterval backgroundFillDuration;
+
+/**
+ * The duration of the video, in seconds, set it when the duration become known.
+ */
+@property (nonatomic, assign) NSTimeInterval videoDuration;
+
+/**
+ * A flag represent stop the read-ahead, such as the player paused or hidden [defaults to NO].
+ */
+@property (nonatomic, assign, getter=isReadAheadPaused) BOOL readAheadPaused;
+
+/**
+ * The number of web requests served by a download already in flight for other loading request, instead of opening
+ * a new connection for the overlapping range.
+ */
+@property (nonatomic, assign, readonly) NSUInteger sharedDownloadCount;
+
+/**
+ * The number of bytes received from the downloads in flight for other loading requests, that is the bytes not
+ * downloaded twice.
+ */
+@property (nonatomic, assign, readonly) NSUInteger sharedDownloadByteCount;
+
+/**
+ * Download the data the player need to play from given time, call it when the user start dragging the progress,
+ * so the data is on the way before the player ask for it. Only work for a MP4 file whose `moov` box is cached.
+ *
+ * @param time The time the user is dragging to, in seconds.
+ */
+- (void)prefetchDataForSeekingToTime:(NSTimeInterval)time;
+
 /**
  * Convenience method to fetch instance of this class.
  *
@@ -13,38 +13,218 @@
 #import "JPVideoPlayerCompat.h"
 #import "JPVideoPlayerCacheFile.h"
 #import "JPVideoPlayerCachePath.h"
+#import "JPVideoPlayerCache.h"
 #import "JPVideoPlayerManager.h"
 #import "JPResourceLoadingRequestTask.h"
 #import "JPVideoPlayerSupportUtils.h"
-#import <pthread.h>
+#import "JPVideoPlayerMP4BoxWalker.h"
+#import "JPVideoPlayerMP4SeekIndex.h"
+
+/**
+ * Decide how many segments of a large uncached range are downloaded at the same time.
+ * The aggregate throughput of every sample is compared with the last sample, the connection count
+ * grows while the throughput grows, and backs off when the throughput drops.
+ */
+@interface JPVideoPlayerParallelDownloadPolicy : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger connectionCount;
+
+@property (nonatomic, assign) NSUInteger maxConnectionCount;
+
+- (void)segmentDidStart;
+
+- (void)segmentDidFinishWithLength:(NSUInteger)length;
+
+@end
+
+static const NSUInteger kJPVideoPlayerParallelDownloadInitialConnectionCount = 2;
+@implementation JPVideoPlayerParallelDownloadPolicy {
+    CFAbsoluteTime _sampleStartTime;
+    NSUInteger _sampleLength;
+    NSUInteger _sampleSegmentCount;
+    double _lastThroughput;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _connectionCount = kJPVideoPlayerParallelDownloadInitialConnectionCount;
+        _maxConnectionCount = kJPVideoPlayerParallelDownloadInitialConnectionCount;
+    }
+    return self;
+}
+
+- (NSUInteger)connectionCount {
+    return MAX(MIN(_connectionCount, self.maxConnectionCount), 1);
+}
+
+- (void)segmentDidStart {
+    if (_sampleStartTime == 0) {
+        _sampleStartTime = CFAbsoluteTimeGetCurrent();
+    }
+}
+
+- (void)segmentDidFinishWithLength:(NSUInteger)length {
+    if (_sampleStartTime == 0) {
+        return;
+    }
+
+    _sampleLength += length;
+    _sampleSegmentCount += 1;
+    // every connection finish two segments at least, so the sample cover the slow start of new connections.
+    NSUInteger connectionCount = self.connectionCount;
+    if (_sampleSegmentCount < connectionCount * 2) {
+        return;
+    }
+
+    CFAbsoluteTime duration = CFAbsoluteTimeGetCurrent() - _sampleStartTime;
+    double throughput = duration > 0 ? _sampleLength / duration : 0;
+    if (_lastThroughput == 0 || throughput > _lastThroughput * 1.1) {
+        _connectionCount = MIN(connectionCount + 1, MAX(self.maxConnectionCount, 1));
+    }
+    else if (throughput < _lastThroughput * 0.9 && connectionCount > 1) {
+        _connectionCount = connectionCount - 1;
+    }
+    JPDebugLog(@"Parallel download throughput: %.0f bytes/s, connection count: %ld", throughput, self.connectionCount);
+    _lastThroughput = throughput;
+    _sampleStartTime = CFAbsoluteTimeGetCurrent();
+    _sampleLength = 0;
+    _sampleSegmentCount = 0;
+}
+
+@end
 
 @interface JPVideoPlayerResourceLoader()<JPResourceLoadingRequestTaskDelegate>
 
+/**
+ * The loading requests in progress, in the order they arrived.
+ */
 @property (nonatomic, strong)NSMutableArray<AVAssetResourceLoadingRequest *> *loadingRequests;
 
-@property (nonatomic, strong) AVAssetResourceLoadingRequest *runningLoadingRequest;
-
 @property (nonatomic, strong) JPVideoPlayerCacheFile *cacheFile;
 
-@property (nonatomic, strong) NSMutableArray<JPResourceLoadingRequestTask *> *requestTasks;
+/**
+ * The tasks not finished of every loading request, the tasks of one loading request run one by one
+ * because the data must be responded in order, the first task is running or waiting for a connection.
+ */
+@property (nonatomic, strong) NSMapTable<AVAssetResourceLoadingRequest *, NSMutableArray<JPResourceLoadingRequestTask *> *> *requestTasks;
+
+@property (nonatomic, strong) NSMutableSet<JPResourceLoadingRequestTask *> *runningRequestTasks;
 
-@property (nonatomic, strong) JPResourceLoadingRequestTask *runningRequestTask;
+/**
+ * The result of the staged tasks finished before their turn, the value is the error or `NSNull`.
+ */
+@property (nonatomic, strong) NSMapTable<JPResourceLoadingRequestTask *, id> *stagedTaskResults;
+
+@property (nonatomic, strong) JPVideoPlayerParallelDownloadPolicy *parallelDownloadPolicy;
 
-@property (nonatomic) pthread_mutex_t lock;
+/**
+ * A flag represent the server ignore the range header, so no web task can be started ahead.
+ */
+@property (nonatomic, assign) BOOL stagingUnsupported;
+
+@property (nonatomic, assign) NSUInteger sharedDownloadCount;
+
+@property (nonatomic, assign) NSUInteger sharedDownloadByteCount;
+
+/**
+ * The web task downloading ahead of the player, it respond nothing, so it is not in `runningRequestTasks`.
+ */
+@property (nonatomic, strong) JPResourceLoadingRequestWebTask *readAheadTask;
+
+/**
+ * The end of the last range the player requested, the read-ahead window start from here.
+ */
+@property (nonatomic, assign) NSUInteger readAheadOffset;
+
+/**
+ * Walk the top level boxes of the cached data to locate the `moov` box of a MP4 file.
+ */
+@property (nonatomic, strong) JPVideoPlayerMP4BoxWalker *boxWalker;
+
+/**
+ * The box offset the walk stopped at because the cached data is too short for the box header,
+ * and the end of the cached data there, the data is not read again until more data cached.
+ */
+@property (nonatomic, assign) NSUInteger boxWalkerStalledOffset;
+
+@property (nonatomic, assign) NSUInteger boxWalkerStalledCachedEnd;
+
+/**
+ * The offset of the box at the tail whose header is downloaded to check it is `moov`, `NSNotFound` if none.
+ */
+@property (nonatomic, assign) NSUInteger moovProbeOffset;
+
+/**
+ * The web task download the `moov` box before the player ask for it, it respond nothing like the read-ahead task.
+ */
+@property (nonatomic, strong) JPResourceLoadingRequestWebTask *moovPrefetchTask;
+
+/**
+ * A flag represent the `moov` box is cached, or no need to prefetch it.
+ */
+@property (nonatomic, assign) BOOL moovPrefetchFinished;
+
+/**
+ * The time to byte index built from the cached `moov` box.
+ */
+@property (nonatomic, strong) JPVideoPlayerMP4SeekIndex *seekIndex;
+
+/**
+ * The web task download the data of the seek target while the user is dragging.
+ */
+@property (nonatomic, strong) JPResourceLoadingRequestWebTask *seekPrefetchTask;
+
+/**
+ * The web tasks keep downloading into cache file after their loading request cancelled.
+ */
+@property (nonatomic, strong) NSMutableSet<JPResourceLoadingRequestWebTask *> *backgroundFillTasks;
 
 @property (nonatomic, strong) dispatch_queue_t ioQueue;
 
 @end
 
+static const NSUInteger kJPVideoPlayerResourceLoaderMaxConcurrentWebTaskCount = 3;
+// the cancelled web tasks more than this are cancelled for real, the seeks in a row do not pile up connections.
+static const NSUInteger kJPVideoPlayerBackgroundFillMaxTaskCount = 2;
+static const NSUInteger kJPVideoPlayerParallelDownloadSegmentSize = 1024 * 1024;
+static const NSUInteger kJPVideoPlayerResourceLoaderMinimumLocalReadChunkSize = 1024 * 32;
+static const NSUInteger kJPVideoPlayerResourceLoaderMaximumLocalReadChunkSize = 1024 * 1024;
+// the data read from cache for box headers, the `ftyp` and the header of `mdat` are often in the first KB.
+static const NSUInteger kJPVideoPlayerMP4BoxHeaderReadLength = 1024;
+// the `moov` box at the end of file is prefetched only if the tail is shorter than this.
+static const NSUInteger kJPVideoPlayerMoovPrefetchMaxLength = 16 * 1024 * 1024;
+// the data downloaded to read the header of the box at the tail, the size, the type and the 64-bit large size.
+static const NSUInteger kJPVideoPlayerMP4BoxHeaderProbeLength = 16;
+// the duration of video prefetched around the seek target.
+static const NSTimeInterval kJPVideoPlayerSeekPrefetchWindow = 2;
+static const NSUInteger kJPVideoPlayerSeekPrefetchMaxLength = 4 * 1024 * 1024;
+// the web task after a local task longer than this is not started ahead, its connection would idle for long,
+// the staged data in memory is limited by the web task itself.
+static const NSUInteger kJPVideoPlayerPipelineMaxLocalTaskLength = 8 * 1024 * 1024;
+
+/**
+ * The web task receiving data from other web task do not open a connection.
+ */
+static BOOL JPRequestTaskNeedsConnection(JPResourceLoadingRequestTask *requestTask) {
+    return [requestTask isKindOfClass:[JPResourceLoadingRequestWebTask class]] && !((JPResourceLoadingRequestWebTask *)requestTask).sourceTask;
+}
+
 @implementation JPVideoPlayerResourceLoader
 
 - (void)dealloc {
-    if(self.runningRequestTask){
-        [self.runningRequestTask cancel];
-        [self removeCurrentRequestTaskAndResetAll];
+    [self.readAheadTask cancel];
+    [self.moovPrefetchTask cancel];
+    [self.seekPrefetchTask cancel];
+    for (JPResourceLoadingRequestTask *requestTask in self.backgroundFillTasks) {
+        [requestTask cancel];
     }
+    for (JPResourceLoadingRequestTask *requestTask in self.runningRequestTasks) {
+        [requestTask cancel];
+    }
+    [self.runningRequestTasks removeAllObjects];
+    [self.requestTasks removeAllObjects];
     self.loadingRequests = nil;
-    pthread_mutex_destroy(&_lock);
 }
 
 - (instancetype)init {
@@ -64,16 +244,35 @@
 
     self = [super init];
     if(self){
-        pthread_mutexattr_t mutexattr;
-        pthread_mutexattr_init(&mutexattr);
-        pthread_mutexattr_settype(&mutexattr, PTHREAD_MUTEX_RECURSIVE);
-        pthread_mutex_init(&_lock, &mutexattr);
-        _ioQueue = dispatch_queue_create("com.NewPan.jpvideoplayer.resource.loader.www", DISPATCH_QUEUE_SERIAL);
+        // the local tasks of different loading requests read the cache file at the same time.
+        _ioQueue = dispatch_queue_create("com.NewPan.jpvideoplayer.resource.loader.www", DISPATCH_QUEUE_CONCURRENT);
+        // the loading requests and tasks are only touched on this queue, so they need no lock.
+        _delegateQueue = dispatch_queue_create("com.NewPan.jpvideoplayer.resource.loader.delegate.www", DISPATCH_QUEUE_SERIAL);
         _customURL = customURL;
         _loadingRequests = [@[] mutableCopy];
+        _requestTasks = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                              valueOptions:NSPointerFunctionsStrongMemory];
+        _runningRequestTasks = [NSMutableSet set];
+        _backgroundFillTasks = [NSMutableSet set];
+        _boxWalkerStalledOffset = NSNotFound;
+        _moovProbeOffset = NSNotFound;
+        _stagedTaskResults = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                                   valueOptions:NSPointerFunctionsStrongMemory];
+        _parallelDownloadPolicy = [JPVideoPlayerParallelDownloadPolicy new];
+        _maxConcurrentWebTaskCount = kJPVideoPlayerResourceLoaderMaxConcurrentWebTaskCount;
+        _minimumLocalReadChunkSize = kJPVideoPlayerResourceLoaderMinimumLocalReadChunkSize;
+        _maximumLocalReadChunkSize = kJPVideoPlayerResourceLoaderMaximumLocalReadChunkSize;
         NSString *key = [JPVideoPlayerManager.sharedManager cacheKeyForURL:customURL];
         _cacheFile = [JPVideoPlayerCacheFile cacheFileWithFilePath:[JPVideoPlayerCachePath createVideoFileIfNeedThenFetchItForKey:key]
                                                      indexFilePath:[JPVideoPlayerCachePath createVideoIndexFileIfNeedThenFetchItForKey:key]];
+        JPVideoPlayerCacheConfiguration *cacheConfiguration = JPVideoPlayerCache.sharedCache.cacheConfiguration;
+        _cacheFile.preallocatesDiskSpace = cacheConfiguration.shouldPreallocateDiskSpace;
+        _cacheFile.streamingOnlyCacheSize = cacheConfiguration.streamingOnlyCacheSize;
+        _cacheFile.verifiesChecksum = cacheConfiguration.shouldVerifyCachedData;
+        _readAheadLength = cacheConfiguration.readAheadLength;
+        _readAheadDuration = cacheConfiguration.readAheadDuration;
+        _backgroundFillLength = cacheConfiguration.backgroundFillLength;
+        _backgroundFillDuration = cacheConfiguration.backgroundFillDuration;
     }
     return self;
 }
@@ -86,9 +285,14 @@ shouldWaitForLoadingOfRequestedResource:(AVAssetResourceLoadingRequest *)loading
     if (resourceLoader && loadingRequest){
         [self.loadingRequests addObject:loadingRequest];
         JPDebugLog(@"ResourceLoader 接收到新的请求, 当前请求数: %ld <<<<<<<<<<<<<<", self.loadingRequests.count);
-        if(!self.runningLoadingRequest){
-            [self findAndStartNextLoadingRequestIfNeed];
+        // do not wait for other loading requests, the player often send a probe request beside the streaming request.
+        NSRange dataRange = [self fetchRequestRangeWithRequest:loadingRequest];
+        [self updateReadAheadWithRequestRange:dataRange];
+        if (dataRange.length == NSUIntegerMax && self.cacheFile.isFileLengthValid) {
+            dataRange.length = [self.cacheFile fileLength] - dataRange.location;
         }
+        [self startLoadingRequest:loadingRequest
+                            range:dataRange];
     }
     return YES;
 }
@@ -96,21 +300,10 @@ shouldWaitForLoadingOfRequestedResource:(AVAssetResourceLoadingRequest *)loading
 - (void)resourceLoader:(AVAssetResourceLoader *)resourceLoader
 didCancelLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest {
     if ([self.loadingRequests containsObject:loadingRequest]) {
-        if(loadingRequest == self.runningLoadingRequest){
-            JPDebugLog(@"取消了一个正在进行的请求");
-            if(self.runningLoadingRequest && self.runningRequestTask){
-                [self.runningRequestTask cancel];
-            }
-            if([self.loadingRequests containsObject:self.runningLoadingRequest]){
-                [self.loadingRequests removeObject:self.runningLoadingRequest];
-            }
-            [self removeCurrentRequestTaskAndResetAll];
-            [self findAndStartNextLoadingRequestIfNeed];
-        }
-        else {
-            JPDebugLog(@"取消了一个不在进行的请求");
-            [self.loadingRequests removeObject:loadingRequest];
-        }
+        JPDebugLog(@"取消了一个正在进行的请求");
+        [self detachRequestTasksOfLoadingRequest:loadingRequest];
+        [self removeLoadingRequest:loadingRequest];
+        [self startRequestTasksIfNeed];
     }
     else {
         JPDebugLog(@"要取消的请求已经完成了");
@@ -122,120 +315,200 @@ didCancelLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest {
 
 - (void)requestTask:(JPResourceLoadingRequestTask *)requestTask
 didCompleteWithError:(NSError *)error {
-    if (error.code == NSURLErrorCancelled) {
+    if (requestTask == self.readAheadTask) {
+        self.readAheadTask = nil;
+        JPDebugLog(@"ResourceLoader 完成一个预读请求, error: %@", error);
+        // do not retry a failed read-ahead at once, it start again when next loading request finished.
+        if (!error) {
+            [self startReadAheadIfNeed];
+        }
+        return;
+    }
+    if (requestTask == self.moovPrefetchTask) {
+        self.moovPrefetchTask = nil;
+        JPDebugLog(@"ResourceLoader 完成预取 moov, error: %@", error);
+        if (error) {
+            // let the player fetch it as usual.
+            self.moovPrefetchFinished = YES;
+        }
+        [self startRequestTasksIfNeed];
+        return;
+    }
+    if ([self.backgroundFillTasks containsObject:requestTask]) {
+        [self.backgroundFillTasks removeObject:requestTask];
+        JPDebugLog(@"ResourceLoader 完成一个后台填充请求, 下载到: %ld, error: %@", ((JPResourceLoadingRequestWebTask *)requestTask).currentOffset, error);
+        [self startRequestTasksIfNeed];
+        return;
+    }
+    if (requestTask == self.seekPrefetchTask) {
+        self.seekPrefetchTask = nil;
+        JPDebugLog(@"ResourceLoader 完成预取拖动目标的数据, error: %@", error);
         return;
     }
-    if (![self.requestTasks containsObject:requestTask]) {
+    if (![self.runningRequestTasks containsObject:requestTask]) {
         JPDebugLog(@"完成的 task 不是正在进行的 task");
         return;
     }
-
-    if (error) {
-        [self finishCurrentRequestWithError:error];
+    [self.runningRequestTasks removeObject:requestTask];
+    [self recordSharedDownloadOfRequestTask:requestTask];
+    if ([error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorCancelled) {
+        // the tasks cancelled by loader itself are not running anymore, this one is cancelled by others, such as
+        // the downloader or the expired background task, handle it as a failed task so its loading request not hang.
+        JPDebugLog(@"ResourceLoader 一个正在进行的 task 被外部取消了: %@", requestTask);
     }
-    else {
-        [self finishCurrentRequestWithError:nil];
+    [self recordStagingOfRequestTask:requestTask
+                               error:error];
+    AVAssetResourceLoadingRequest *loadingRequest = requestTask.loadingRequest;
+    NSArray<JPResourceLoadingRequestTask *> *requestTasks = [self.requestTasks objectForKey:loadingRequest];
+    if (requestTasks.firstObject != requestTask) {
+        if ([requestTasks containsObject:requestTask]) {
+            // a staged task finished before its turn, finish it when the tasks before it finished.
+            [self.stagedTaskResults setObject:error ?: [NSNull null] forKey:requestTask];
+            [self startRequestTasksIfNeed];
+        }
+        return;
     }
+
+    [self finishRequestTask:requestTask
+                  withError:error];
+    [self startRequestTasksIfNeed];
 }
 
 
 #pragma mark - Finish Request
 
-- (void)finishCurrentRequestWithError:(NSError *)error {
+- (void)finishRequestTask:(JPResourceLoadingRequestTask *)requestTask
+                withError:(NSError *)error {
+    AVAssetResourceLoadingRequest *loadingRequest = requestTask.loadingRequest;
+    BOOL shouldRestart = error.code == JPVideoPlayerErrorCodeCachedDataInvalidated || error.code == JPVideoPlayerErrorCodeSharedDownloadStopped;
+    if ([error.domain isEqualToString:JPVideoPlayerErrorDomain] && shouldRestart) {
+        [self restartLoadingRequestFromCurrentOffset:loadingRequest];
+        return;
+    }
+
     if (error) {
         JPDebugLog(@"ResourceLoader 完成一个请求 error: %@", error);
-        [self.runningRequestTask.loadingRequest finishLoadingWithError:error];
-        [self.loadingRequests removeObject:self.runningLoadingRequest];
-        [self removeCurrentRequestTaskAndResetAll];
-        [self findAndStartNextLoadingRequestIfNeed];
+        [loadingRequest finishLoadingWithError:error];
+        [self removeLoadingRequest:loadingRequest];
+        return;
     }
-    else {
-        JPDebugLog(@"ResourceLoader 完成一个请求, 没有错误");
-        // 要所有的请求都完成了才行.
-        [self.requestTasks removeObject:self.runningRequestTask];
-        if(!self.requestTasks.count){ // 全部完成.
-            [self.runningRequestTask.loadingRequest finishLoading];
-            [self.loadingRequests removeObject:self.runningLoadingRequest];
-            [self removeCurrentRequestTaskAndResetAll];
-            [self findAndStartNextLoadingRequestIfNeed];
-        }
-        else { // 完成了一部分, 继续请求.
-            [self startNextTaskIfNeed];
-        }
+
+    JPDebugLog(@"ResourceLoader 完成一个请求, 没有错误");
+    // 要所有的请求都完成了才行.
+    NSMutableArray<JPResourceLoadingRequestTask *> *requestTasks = [self.requestTasks objectForKey:loadingRequest];
+    [requestTasks removeObject:requestTask];
+    if(!requestTasks.count){ // 全部完成.
+        [loadingRequest finishLoading];
+        [self removeLoadingRequest:loadingRequest];
     }
 }
 
 
 #pragma mark - Private
 
-- (void)findAndStartNextLoadingRequestIfNeed {
-    if(self.runningLoadingRequest || self.runningRequestTask){
-        return;
-    }
-    if (self.loadingRequests.count == 0) {
+- (void)startLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest
+                      range:(NSRange)dataRange {
+    if (![self planLoadingRequest:loadingRequest
+                            range:dataRange]) {
         return;
     }
 
-    self.runningLoadingRequest = [self.loadingRequests firstObject];
-    NSRange dataRange = [self fetchRequestRangeWithRequest:self.runningLoadingRequest];
-    if (dataRange.length == NSUIntegerMax) {
-        dataRange.length = [self.cacheFile fileLength] - dataRange.location;
-    }
-    [self startCurrentRequestWithLoadingRequest:self.runningLoadingRequest
-                                          range:dataRange];
+    // 发起请求.
+    [self startRequestTasksIfNeed];
 }
 
-- (void)startCurrentRequestWithLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest
-                                        range:(NSRange)dataRange {
+/**
+ * Split given loading request into tasks, the tasks are started by `startRequestTasksIfNeed`.
+ *
+ * @return NO if nothing to load, the loading request is finished.
+ */
+- (BOOL)planLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest
+                     range:(NSRange)dataRange {
     /// 是否已经完全缓存完成.
     BOOL isCompleted = self.cacheFile.isCompleted;
     JPDebugLog(@"ResourceLoader 处理新的请求, 数据范围是: %@, 是否已经缓存完成: %@", NSStringFromRange(dataRange), isCompleted ? @"是" : @"否");
+    [self cancelRequestTasksOfLoadingRequest:loadingRequest];
+    [self.requestTasks setObject:[@[] mutableCopy] forKey:loadingRequest];
+    [self fillContentInformationFromCacheIfNeed:loadingRequest
+                                          range:dataRange];
     if (dataRange.length == NSUIntegerMax) {
         [self addTaskWithLoadingRequest:loadingRequest
                                   range:NSMakeRange(dataRange.location, NSUIntegerMax)
                                  cached:NO];
     }
+    else if (loadingRequest.contentInformationRequest && !self.cacheFile.responseHeaders) {
+        // the cache file recovered after crash maybe lost the response headers, ask web to fill content information.
+        [self addTaskWithLoadingRequest:loadingRequest
+                                  range:dataRange
+                                 cached:NO];
+    }
     else {
+        // split the request into local tasks and web tasks by the cached partition of it.
         NSUInteger start = dataRange.location;
-        NSUInteger end = NSMaxRange(dataRange);
-        while (start < end) {
-            NSRange firstNotCachedRange = [self.cacheFile firstNotCachedRangeFromPosition:start];
-            if (!JPValidFileRange(firstNotCachedRange)) {
-                [self addTaskWithLoadingRequest:loadingRequest
-                                          range:dataRange
-                                         cached:self.cacheFile.cachedDataBound > 0];
-                start = end;
-            }
-            else if (firstNotCachedRange.location >= end) {
-                [self addTaskWithLoadingRequest:loadingRequest
-                                          range:dataRange
-                                         cached:YES];
-                start = end;
-            }
-            else if (firstNotCachedRange.location >= start) {
-                if (firstNotCachedRange.location > start) {
-                    [self addTaskWithLoadingRequest:loadingRequest
-                                              range:NSMakeRange(start, firstNotCachedRange.location - start)
-                                             cached:YES];
-                }
-                NSUInteger notCachedEnd = MIN(NSMaxRange(firstNotCachedRange), end);
-                [self addTaskWithLoadingRequest:loadingRequest
-                                          range:NSMakeRange(firstNotCachedRange.location, notCachedEnd - firstNotCachedRange.location)
-                                         cached:NO];
-                start = notCachedEnd;
-            }
-            else {
+        for (NSValue *value in [self.cacheFile missingRangesInRange:dataRange]) {
+            NSRange missingRange = value.rangeValue;
+            if (missingRange.location > start) {
                 [self addTaskWithLoadingRequest:loadingRequest
-                                          range:dataRange
+                                          range:NSMakeRange(start, missingRange.location - start)
                                          cached:YES];
-                start = end;
             }
+            [self addWebTasksWithLoadingRequest:loadingRequest
+                                          range:missingRange];
+            start = NSMaxRange(missingRange);
+        }
+        if (start < NSMaxRange(dataRange)) {
+            [self addTaskWithLoadingRequest:loadingRequest
+                                      range:NSMakeRange(start, NSMaxRange(dataRange) - start)
+                                     cached:YES];
         }
     }
 
+    if (![self.requestTasks objectForKey:loadingRequest].count) {
+        [loadingRequest finishLoading];
+        [self removeLoadingRequest:loadingRequest];
+        return NO;
+    }
+    return YES;
+}
 
-    // 发起请求.
-    [self startNextTaskIfNeed];
+/**
+ * Answer the content information from the response headers in cache index at once if the file length is known,
+ * the web task never fill it again, so the player do not wait for the network to be ready.
+ */
+- (void)fillContentInformationFromCacheIfNeed:(AVAssetResourceLoadingRequest *)loadingRequest
+                                        range:(NSRange)dataRange {
+    if (!loadingRequest.contentInformationRequest || loadingRequest.contentInformationRequest.contentType) {
+        return;
+    }
+    if (!self.cacheFile.isFileLengthValid) {
+        return;
+    }
+
+    if ([JPResourceLoadingRequestLocalTask fillContentInformationOfLoadingRequest:loadingRequest
+                                                                    requestRange:dataRange
+                                                                       cacheFile:self.cacheFile]) {
+        JPDebugLog(@"ResourceLoader 从缓存的响应头填充了 contentInformationRequest");
+    }
+}
+
+/**
+ * Plan the rest of given loading request again, the local tasks planned before maybe point to evicted data.
+ * Note this method only plan the tasks, the caller start them.
+ *
+ * @return NO if the loading request is finished.
+ */
+- (BOOL)restartLoadingRequestFromCurrentOffset:(AVAssetResourceLoadingRequest *)loadingRequest {
+    NSRange lastRange = [self.requestTasks objectForKey:loadingRequest].lastObject.requestRange;
+    NSUInteger offset = (NSUInteger)loadingRequest.dataRequest.currentOffset;
+    if (!JPValidFileRange(lastRange) || offset >= NSMaxRange(lastRange)) {
+        [loadingRequest finishLoadingWithError:JPErrorWithDescription(@"The cached video data is invalidated")];
+        [self removeLoadingRequest:loadingRequest];
+        return NO;
+    }
+
+    JPDebugLog(@"ResourceLoader 缓存数据失效, 重新处理剩余的请求, offset: %ld", offset);
+    return [self planLoadingRequest:loadingRequest
+                              range:NSMakeRange(offset, NSMaxRange(lastRange) - offset)];
 }
 
 - (void)addTaskWithLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest
@@ -244,11 +517,14 @@ didCompleteWithError:(NSError *)error {
     JPResourceLoadingRequestTask *task;
     if(cached){
         JPDebugLog(@"ResourceLoader 创建了一个本地请求");
-        task = [JPResourceLoadingRequestLocalTask requestTaskWithLoadingRequest:loadingRequest
-                                                                   requestRange:range
-                                                                      cacheFile:self.cacheFile
-                                                                      customURL:self.customURL
-                                                                         cached:cached];
+        JPResourceLoadingRequestLocalTask *localTask = [JPResourceLoadingRequestLocalTask requestTaskWithLoadingRequest:loadingRequest
+                                                                                                          requestRange:range
+                                                                                                             cacheFile:self.cacheFile
+                                                                                                             customURL:self.customURL
+                                                                                                                cached:cached];
+        localTask.minimumReadChunkSize = self.minimumLocalReadChunkSize;
+        localTask.maximumReadChunkSize = self.maximumLocalReadChunkSize;
+        task = localTask;
     }
     else {
         task = [JPResourceLoadingRequestWebTask requestTaskWithLoadingRequest:loadingRequest
@@ -261,37 +537,313 @@ didCompleteWithError:(NSError *)error {
             [self.delegate resourceLoader:self didReceiveLoadingRequestTask:(JPResourceLoadingRequestWebTask *)task];
         }
     }
-    int lock = pthread_mutex_trylock(&_lock);
     task.delegate = self;
-    if (!self.requestTasks) {
-        self.requestTasks = [@[] mutableCopy];
+    task.delegateQueue = self.delegateQueue;
+    [[self.requestTasks objectForKey:loadingRequest] addObject:task];
+}
+
+/**
+ * Add the web tasks for a not cached range, the parts already downloading by the running web tasks of other
+ * loading requests receive data from those tasks, only the rest are fetched by new connections.
+ */
+- (void)addWebTasksWithLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest
+                                range:(NSRange)range {
+    NSUInteger start = range.location;
+    while (start < NSMaxRange(range)) {
+        NSUInteger end = NSMaxRange(range);
+        JPResourceLoadingRequestWebTask *sourceTask = nil;
+        for (JPResourceLoadingRequestTask *requestTask in [self inFlightTasks]) {
+            if (!JPRequestTaskNeedsConnection(requestTask) || requestTask.loadingRequest == loadingRequest) {
+                continue;
+            }
+
+            // the running web task is downloading [currentOffset, end of its range).
+            JPResourceLoadingRequestWebTask *webTask = (JPResourceLoadingRequestWebTask *)requestTask;
+            NSUInteger inFlightStart = webTask.currentOffset;
+            NSUInteger inFlightEnd = webTask.endOffset;
+            if (inFlightStart <= start && start < inFlightEnd) {
+                sourceTask = webTask;
+                end = MIN(end, inFlightEnd);
+                break;
+            }
+            if (start < inFlightStart && inFlightStart < end) {
+                end = inFlightStart;
+            }
+        }
+
+        NSRange subrange = NSMakeRange(start, end - start);
+        if (sourceTask) {
+            [self addSharedTaskWithLoadingRequest:loadingRequest
+                                            range:subrange
+                                       sourceTask:sourceTask];
+        }
+        else {
+            [self addSegmentTasksWithLoadingRequest:loadingRequest
+                                              range:subrange];
+        }
+        start = end;
+    }
+}
+
+/**
+ * Add a web task receive the data of given range from the download in flight, no new connection.
+ */
+- (void)addSharedTaskWithLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest
+                                  range:(NSRange)range
+                             sourceTask:(JPResourceLoadingRequestWebTask *)sourceTask {
+    JPResourceLoadingRequestWebTask *task = [JPResourceLoadingRequestWebTask requestTaskWithLoadingRequest:loadingRequest
+                                                                                               requestRange:range
+                                                                                                  cacheFile:self.cacheFile
+                                                                                                  customURL:self.customURL
+                                                                                                     cached:NO];
+    task.sourceTask = sourceTask;
+    JPDebugLog(@"ResourceLoader 创建一个共享下载的网络请求, 数据范围是: %@", NSStringFromRange(range));
+    task.delegate = self;
+    task.delegateQueue = self.delegateQueue;
+    [[self.requestTasks objectForKey:loadingRequest] addObject:task];
+    self.sharedDownloadCount += 1;
+}
+
+/**
+ * Add the web tasks for a range nobody downloading, a large range is split into segments if parallel download enabled.
+ */
+- (void)addSegmentTasksWithLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest
+                                    range:(NSRange)range {
+    if (!self.parallelDownloadEnabled || range.length < kJPVideoPlayerParallelDownloadSegmentSize * 2) {
+        [self addTaskWithLoadingRequest:loadingRequest
+                                  range:range
+                                 cached:NO];
+        return;
     }
-    [self.requestTasks addObject:task];
-    if (!lock) {
-        pthread_mutex_unlock(&_lock);
+
+    NSUInteger start = range.location;
+    while (start < NSMaxRange(range)) {
+        NSUInteger length = MIN(kJPVideoPlayerParallelDownloadSegmentSize, NSMaxRange(range) - start);
+        // merge the short tail into the last segment.
+        if (NSMaxRange(range) - start - length < kJPVideoPlayerParallelDownloadSegmentSize / 2) {
+            length = NSMaxRange(range) - start;
+        }
+        [self addTaskWithLoadingRequest:loadingRequest
+                                  range:NSMakeRange(start, length)
+                                 cached:NO];
+        start += length;
     }
 }
 
-- (void)removeCurrentRequestTaskAndResetAll {
-    self.runningLoadingRequest = nil;
-    self.requestTasks = [@[] mutableCopy];
-    self.runningRequestTask = nil;
+- (void)cancelRequestTasksOfLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest {
+    for (JPResourceLoadingRequestTask *requestTask in [self.requestTasks objectForKey:loadingRequest]) {
+        [self.stagedTaskResults removeObjectForKey:requestTask];
+        if ([self.runningRequestTasks containsObject:requestTask]) {
+            [requestTask cancel];
+            [self.runningRequestTasks removeObject:requestTask];
+            [self recordSharedDownloadOfRequestTask:requestTask];
+        }
+    }
 }
 
-- (void)startNextTaskIfNeed {
-    int lock = pthread_mutex_trylock(&_lock);;
-    self.runningRequestTask = self.requestTasks.firstObject;
-    if ([self.runningRequestTask isKindOfClass:[JPResourceLoadingRequestLocalTask class]]) {
-        [self.runningRequestTask startOnQueue:self.ioQueue];
+/**
+ * Keep the running web tasks of a cancelled loading request downloading into cache file, in the byte budget.
+ */
+- (void)detachRequestTasksOfLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest {
+    if (!self.backgroundFillLength) {
+        return;
     }
-    else {
-        [self.runningRequestTask start];
+
+    for (JPResourceLoadingRequestTask *requestTask in [self.requestTasks objectForKey:loadingRequest]) {
+        if (self.backgroundFillTasks.count >= kJPVideoPlayerBackgroundFillMaxTaskCount) {
+            break;
+        }
+        if (![self.runningRequestTasks containsObject:requestTask] || !JPRequestTaskNeedsConnection(requestTask)) {
+            continue;
+        }
+
+        JPResourceLoadingRequestWebTask *webTask = (JPResourceLoadingRequestWebTask *)requestTask;
+        if ([webTask detachWithByteBudget:self.backgroundFillLength duration:self.backgroundFillDuration]) {
+            [self.stagedTaskResults removeObjectForKey:webTask];
+            [self.runningRequestTasks removeObject:webTask];
+            [self.backgroundFillTasks addObject:webTask];
+        }
+    }
+}
+
+- (void)removeLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest {
+    [self cancelRequestTasksOfLoadingRequest:loadingRequest];
+    [self.loadingRequests removeObject:loadingRequest];
+    [self.requestTasks removeObjectForKey:loadingRequest];
+}
+
+/**
+ * The running tasks, include the tasks download into cache file only, such as the read-ahead task.
+ */
+- (NSArray<JPResourceLoadingRequestTask *> *)inFlightTasks {
+    NSMutableArray<JPResourceLoadingRequestTask *> *inFlightTasks = [self.runningRequestTasks.allObjects mutableCopy];
+    [inFlightTasks addObjectsFromArray:self.backgroundFillTasks.allObjects];
+    for (JPResourceLoadingRequestWebTask *requestTask in @[self.readAheadTask ?: [NSNull null],
+                                                           self.moovPrefetchTask ?: [NSNull null],
+                                                           self.seekPrefetchTask ?: [NSNull null]]) {
+        if ([requestTask isKindOfClass:[JPResourceLoadingRequestWebTask class]]) {
+            [inFlightTasks addObject:requestTask];
+        }
+    }
+    return inFlightTasks;
+}
+
+- (void)recordSharedDownloadOfRequestTask:(JPResourceLoadingRequestTask *)requestTask {
+    if ([requestTask isKindOfClass:[JPResourceLoadingRequestWebTask class]]) {
+        self.sharedDownloadByteCount += ((JPResourceLoadingRequestWebTask *)requestTask).sharedDataLength;
+    }
+}
+
+- (void)recordStagingOfRequestTask:(JPResourceLoadingRequestTask *)requestTask
+                             error:(NSError *)error {
+    if (!JPRequestTaskNeedsConnection(requestTask)) {
+        return;
+    }
+
+    JPResourceLoadingRequestWebTask *webTask = (JPResourceLoadingRequestWebTask *)requestTask;
+    if (webTask.stagesResponse && [error.domain isEqualToString:JPVideoPlayerErrorDomain]) {
+        // the server ignore the range header, do not start any web task ahead anymore.
+        self.stagingUnsupported = YES;
     }
-    if (!lock) {
-        pthread_mutex_unlock(&_lock);
+    else if (!error && self.parallelDownloadEnabled && JPValidFileRange(webTask.requestRange)) {
+        [self.parallelDownloadPolicy segmentDidFinishWithLength:webTask.requestRange.length];
     }
 }
 
+/**
+ * Start the first task of every loading request, the local tasks start at once,
+ * the web tasks start in the order of loading requests until reach the connection limit.
+ */
+- (void)startRequestTasksIfNeed {
+    NSUInteger runningWebTaskCount = [self runningWebTaskCount];
+    for (AVAssetResourceLoadingRequest *loadingRequest in [self.loadingRequests copy]) {
+        [self startRequestTasksOfLoadingRequest:loadingRequest
+                            runningWebTaskCount:&runningWebTaskCount];
+    }
+    [self prefetchMoovIfNeed];
+    [self startReadAheadIfNeed];
+}
+
+- (NSUInteger)runningWebTaskCount {
+    NSUInteger runningWebTaskCount = 0;
+    for (JPResourceLoadingRequestTask *requestTask in self.runningRequestTasks) {
+        if (JPRequestTaskNeedsConnection(requestTask)) {
+            runningWebTaskCount++;
+        }
+    }
+    return runningWebTaskCount;
+}
+
+- (void)startRequestTasksOfLoadingRequest:(AVAssetResourceLoadingRequest *)loadingRequest
+                      runningWebTaskCount:(NSUInteger *)runningWebTaskCount {
+    NSUInteger maxConcurrentWebTaskCount = MAX(self.maxConcurrentWebTaskCount, 1);
+    JPResourceLoadingRequestTask *requestTask = [self.requestTasks objectForKey:loadingRequest].firstObject;
+    // the staged task become the first one, respond its staged data, and finish it if it finished before.
+    while ([requestTask isKindOfClass:[JPResourceLoadingRequestWebTask class]] && [(JPResourceLoadingRequestWebTask *)requestTask stagesResponse]) {
+        [(JPResourceLoadingRequestWebTask *)requestTask stopStagingResponse];
+        id result = [self.stagedTaskResults objectForKey:requestTask];
+        if (!result) {
+            break;
+        }
+
+        [self.stagedTaskResults removeObjectForKey:requestTask];
+        if (result != [NSNull null]) {
+            // the segment failed, plan the rest again, the segments finished are served from cache.
+            // the running tasks of it are cancelled by the planning, count them again and start the new tasks in this pass.
+            if ([self restartLoadingRequestFromCurrentOffset:loadingRequest]) {
+                *runningWebTaskCount = [self runningWebTaskCount];
+                [self startRequestTasksOfLoadingRequest:loadingRequest
+                                    runningWebTaskCount:runningWebTaskCount];
+            }
+            return;
+        }
+        [self finishRequestTask:requestTask
+                      withError:nil];
+        requestTask = [self.requestTasks objectForKey:loadingRequest].firstObject;
+    }
+    if (!requestTask) {
+        return;
+    }
+
+    if (![self.runningRequestTasks containsObject:requestTask]) {
+        if ([requestTask isKindOfClass:[JPResourceLoadingRequestLocalTask class]]) {
+            [self.runningRequestTasks addObject:requestTask];
+            [requestTask startOnQueue:self.ioQueue];
+        }
+        else if (!JPRequestTaskNeedsConnection(requestTask)) {
+            [self.runningRequestTasks addObject:requestTask];
+            [requestTask start];
+        }
+        else if (*runningWebTaskCount < maxConcurrentWebTaskCount) {
+            *runningWebTaskCount += 1;
+            [self.runningRequestTasks addObject:requestTask];
+            [self.parallelDownloadPolicy segmentDidStart];
+            [requestTask start];
+        }
+        else {
+            return;
+        }
+    }
+
+    NSArray<JPResourceLoadingRequestTask *> *requestTasks = [self.requestTasks objectForKey:loadingRequest];
+    if ([requestTask isKindOfClass:[JPResourceLoadingRequestLocalTask class]]) {
+        // connect the web task after the local task while the local data is serving, save the round trips of connect.
+        if (requestTasks.count > 1 && requestTask.requestRange.length <= kJPVideoPlayerPipelineMaxLocalTaskLength) {
+            [self startStagedRequestTask:requestTasks[1]
+                     runningWebTaskCount:runningWebTaskCount];
+        }
+        return;
+    }
+    if (!self.parallelDownloadEnabled) {
+        return;
+    }
+
+    // download the following segments ahead while the first one is downloading, keep at most `connectionCount` in flight.
+    self.parallelDownloadPolicy.maxConnectionCount = maxConcurrentWebTaskCount;
+    NSUInteger connectionCount = self.parallelDownloadPolicy.connectionCount;
+    for (NSUInteger i = 1; i < MIN(requestTasks.count, connectionCount); i++) {
+        if (![self startStagedRequestTask:requestTasks[i]
+                      runningWebTaskCount:runningWebTaskCount]) {
+            break;
+        }
+    }
+}
+
+/**
+ * Start a web task ahead of its turn, the data is staged until the tasks before it finished.
+ *
+ * @return NO if the task is not a web task or reach the connection limit.
+ */
+- (BOOL)startStagedRequestTask:(JPResourceLoadingRequestTask *)requestTask
+           runningWebTaskCount:(NSUInteger *)runningWebTaskCount {
+    if (self.stagingUnsupported || ![requestTask isKindOfClass:[JPResourceLoadingRequestWebTask class]]) {
+        return NO;
+    }
+    if ([self.runningRequestTasks containsObject:requestTask] || [self.stagedTaskResults objectForKey:requestTask]) {
+        return YES;
+    }
+
+    JPResourceLoadingRequestWebTask *webTask = (JPResourceLoadingRequestWebTask *)requestTask;
+    if (webTask.sourceTask) {
+        webTask.stagesResponse = YES;
+        [self.runningRequestTasks addObject:webTask];
+        [webTask start];
+        return YES;
+    }
+    if (*runningWebTaskCount >= MAX(self.maxConcurrentWebTaskCount, 1)) {
+        return NO;
+    }
+
+    *runningWebTaskCount += 1;
+    webTask.stagesResponse = YES;
+    [self.runningRequestTasks addObject:webTask];
+    if (self.parallelDownloadEnabled) {
+        [self.parallelDownloadPolicy segmentDidStart];
+    }
+    [webTask start];
+    return YES;
+}
+
 - (NSRange)fetchRequestRangeWithRequest:(AVAssetResourceLoadingRequest *)loadingRequest {
     NSUInteger location, length;
     // data range.
@@ -309,4 +861,327 @@ didCompleteWithError:(NSError *)error {
     return NSMakeRange(location, length);
 }
 
+
+#pragma mark - Read Ahead
+
+- (void)setReadAheadPaused:(BOOL)readAheadPaused {
+    // the read-ahead run on the delegate queue, the player set this on main queue.
+    dispatch_async(self.delegateQueue, ^{
+        self->_readAheadPaused = readAheadPaused;
+        if (readAheadPaused) {
+            [self cancelReadAhead];
+        }
+        else {
+            [self startReadAheadIfNeed];
+        }
+    });
+}
+
+- (NSUInteger)readAheadWindowLength {
+    NSUInteger windowLength = self.readAheadLength;
+    if (self.readAheadDuration > 0 && self.videoDuration > 0 && self.cacheFile.isFileLengthValid) {
+        double bytesPerSecond = self.cacheFile.fileLength / self.videoDuration;
+        windowLength = MAX(windowLength, (NSUInteger)(bytesPerSecond * self.readAheadDuration));
+    }
+    return windowLength;
+}
+
+/**
+ * Move the read-ahead window to the end of the range the player requested, the read-ahead task out of
+ * the new window is useless, such as the player seek to other position.
+ */
+- (void)updateReadAheadWithRequestRange:(NSRange)dataRange {
+    if (dataRange.length == NSUIntegerMax) {
+        // the player read to end by itself.
+        [self cancelReadAhead];
+        return;
+    }
+    if (self.cacheFile.isFileLengthValid && NSMaxRange(dataRange) >= self.cacheFile.fileLength) {
+        // the player read to end by itself, the read-ahead in the range download the same bytes.
+        [self cancelReadAhead];
+        self.readAheadOffset = self.cacheFile.fileLength;
+        return;
+    }
+
+    NSUInteger requestEnd = NSMaxRange(dataRange);
+    NSRange readAheadRange = self.readAheadTask.requestRange;
+    if (self.readAheadTask && (dataRange.location < readAheadRange.location || dataRange.location >= NSMaxRange(readAheadRange))) {
+        [self cancelReadAhead];
+    }
+    self.readAheadOffset = requestEnd;
+}
+
+- (void)startReadAheadIfNeed {
+    if (self.readAheadPaused || self.readAheadTask || self.loadingRequests.count) {
+        return;
+    }
+    if (!self.cacheFile.isFileLengthValid || self.cacheFile.isCompleted) {
+        return;
+    }
+
+    // the data beyond the cacheable length is dropped by cache file, read ahead it would download it again and again.
+    NSUInteger cacheableLength = self.cacheFile.cacheableLength;
+    NSUInteger windowLength = [self readAheadWindowLength];
+    if (!windowLength || self.readAheadOffset >= cacheableLength) {
+        return;
+    }
+
+    // download the first gap in the window, the next gap is downloaded when this one finished.
+    NSRange windowRange = NSMakeRange(self.readAheadOffset, MIN(windowLength, cacheableLength - self.readAheadOffset));
+    NSRange missingRange = [self.cacheFile missingRangesInRange:windowRange].firstObject.rangeValue;
+    if (!JPValidFileRange(missingRange)) {
+        return;
+    }
+
+    JPResourceLoadingRequestWebTask *requestTask = [JPResourceLoadingRequestWebTask readAheadTaskWithRequestRange:missingRange
+                                                                                                        cacheFile:self.cacheFile
+                                                                                                        customURL:self.customURL];
+    requestTask.internal = YES;
+    requestTask.delegate = self;
+    requestTask.delegateQueue = self.delegateQueue;
+    self.readAheadTask = requestTask;
+    JPDebugLog(@"ResourceLoader 创建一个预读请求, 数据范围是: %@", NSStringFromRange(missingRange));
+    if (self.delegate && [self.delegate respondsToSelector:@selector(resourceLoader:didReceiveLoadingRequestTask:)]) {
+        [self.delegate resourceLoader:self didReceiveLoadingRequestTask:requestTask];
+    }
+    [requestTask start];
+}
+
+- (void)cancelReadAhead {
+    if (!self.readAheadTask) {
+        return;
+    }
+
+    JPDebugLog(@"ResourceLoader 取消了预读请求");
+    [self.readAheadTask cancel];
+    self.readAheadTask = nil;
+}
+
+
+
+#pragma mark - Moov Prefetch
+
+/**
+ * Locate the `moov` box of a MP4 file from the cached box headers, and download it before the player ask for it.
+ * The player read `moov` before any sample, a file with `moov` at the end make the player request the head,
+ * then the tail, then stream, prefetch the tail save a round trip of the startup.
+ * The header of the box at the tail is downloaded first, the box is prefetched only if it is `moov`.
+ */
+- (void)prefetchMoovIfNeed {
+    if (self.moovPrefetchFinished || self.moovPrefetchTask) {
+        return;
+    }
+    if (self.cacheFile.isCompleted) {
+        self.moovPrefetchFinished = YES;
+        return;
+    }
+    if (!self.cacheFile.isFileLengthValid) {
+        return;
+    }
+
+    NSUInteger fileLength = self.cacheFile.fileLength;
+    if (!self.boxWalker) {
+        self.boxWalker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:fileLength];
+    }
+    JPVideoPlayerMP4BoxWalker *boxWalker = self.boxWalker;
+    while (!boxWalker.isFinished) {
+        NSUInteger offset = boxWalker.nextBoxOffset;
+        NSRange cachedRange = [self.cacheFile cachedRangeContainsPosition:offset];
+        if (!JPValidFileRange(cachedRange)) {
+            break;
+        }
+        if (offset == self.boxWalkerStalledOffset && NSMaxRange(cachedRange) == self.boxWalkerStalledCachedEnd) {
+            // nothing cached since last walk, do not read the disk on every scheduling pass.
+            break;
+        }
+
+        NSUInteger length = MIN(kJPVideoPlayerMP4BoxHeaderReadLength, NSMaxRange(cachedRange) - offset);
+        NSData *data = [self.cacheFile dataWithRange:NSMakeRange(offset, length)];
+        if (!data.length) {
+            break;
+        }
+        [boxWalker appendData:data atOffset:offset];
+        if (boxWalker.nextBoxOffset == offset && !boxWalker.isFinished) {
+            // the cached data is too short for the box header.
+            self.boxWalkerStalledOffset = offset;
+            self.boxWalkerStalledCachedEnd = NSMaxRange(cachedRange);
+            break;
+        }
+    }
+
+    NSRange moovRange = boxWalker.moovRange;
+    if (!boxWalker.isFinished) {
+        if (boxWalker.nextBoxOffset == 0 || fileLength - boxWalker.nextBoxOffset > kJPVideoPlayerMoovPrefetchMaxLength) {
+            // wait for the head of file, or the tail is too long to be `moov` only.
+            return;
+        }
+        // the box at the tail is not walked yet, it maybe the `mdat` of a small faststart file,
+        // download its header to check the type before prefetch the whole box.
+        [self probeMoovHeaderAtOffset:boxWalker.nextBoxOffset];
+        return;
+    }
+    if (!JPValidFileRange(moovRange)) {
+        self.moovPrefetchFinished = YES;
+        return;
+    }
+    if (NSMaxRange(moovRange) > self.cacheFile.cacheableLength) {
+        // the `moov` can not be cached, leave it to the player.
+        self.moovPrefetchFinished = YES;
+        return;
+    }
+
+    NSRange missingRange = [self.cacheFile missingRangesInRange:moovRange].firstObject.rangeValue;
+    if (!JPValidFileRange(missingRange)) {
+        self.moovPrefetchFinished = boxWalker.isFinished;
+        return;
+    }
+    if ([self isDownloadingPosition:missingRange.location]) {
+        // the player is fetching it already.
+        return;
+    }
+
+    JPResourceLoadingRequestWebTask *requestTask = [JPResourceLoadingRequestWebTask readAheadTaskWithRequestRange:missingRange
+                                                                                                        cacheFile:self.cacheFile
+                                                                                                        customURL:self.customURL];
+    // the player can not start without the `moov`.
+    requestTask.downloadPriority = JPVideoPlayerDownloadPriorityPlaying;
+    requestTask.internal = YES;
+    requestTask.delegate = self;
+    requestTask.delegateQueue = self.delegateQueue;
+    self.moovPrefetchTask = requestTask;
+    JPDebugLog(@"ResourceLoader 预取 moov, 数据范围是: %@", NSStringFromRange(missingRange));
+    if (self.delegate && [self.delegate respondsToSelector:@selector(resourceLoader:didReceiveLoadingRequestTask:)]) {
+        [self.delegate resourceLoader:self didReceiveLoadingRequestTask:requestTask];
+    }
+    [requestTask start];
+}
+
+- (void)probeMoovHeaderAtOffset:(NSUInteger)offset {
+    if (offset == self.moovProbeOffset) {
+        // the header downloaded is still not walked, such as not stored, let the player fetch the `moov` as usual.
+        self.moovPrefetchFinished = YES;
+        return;
+    }
+
+    NSRange headerRange = NSMakeRange(offset, MIN(kJPVideoPlayerMP4BoxHeaderProbeLength, self.cacheFile.fileLength - offset));
+    if (NSMaxRange(headerRange) > self.cacheFile.cacheableLength) {
+        self.moovPrefetchFinished = YES;
+        return;
+    }
+    if ([self isDownloadingPosition:offset]) {
+        // the player is fetching it already, walk it when cached.
+        return;
+    }
+
+    JPResourceLoadingRequestWebTask *requestTask = [JPResourceLoadingRequestWebTask readAheadTaskWithRequestRange:headerRange
+                                                                                                        cacheFile:self.cacheFile
+                                                                                                        customURL:self.customURL];
+    // the player can not start without the `moov`, the probe is only a few bytes.
+    requestTask.downloadPriority = JPVideoPlayerDownloadPriorityPlaying;
+    requestTask.internal = YES;
+    requestTask.delegate = self;
+    requestTask.delegateQueue = self.delegateQueue;
+    self.moovPrefetchTask = requestTask;
+    self.moovProbeOffset = offset;
+    JPDebugLog(@"ResourceLoader 下载末尾 box 的头部, 检查是否 moov, 数据范围是: %@", NSStringFromRange(headerRange));
+    if (self.delegate && [self.delegate respondsToSelector:@selector(resourceLoader:didReceiveLoadingRequestTask:)]) {
+        [self.delegate resourceLoader:self didReceiveLoadingRequestTask:requestTask];
+    }
+    [requestTask start];
+}
+
+- (BOOL)isDownloadingPosition:(NSUInteger)position {
+    for (JPResourceLoadingRequestTask *requestTask in [self inFlightTasks]) {
+        if (!JPRequestTaskNeedsConnection(requestTask)) {
+            continue;
+        }
+
+        JPResourceLoadingRequestWebTask *webTask = (JPResourceLoadingRequestWebTask *)requestTask;
+        if (webTask.currentOffset <= position && position < webTask.endOffset) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+
+
+#pragma mark - Seek Prefetch
+
+- (void)prefetchDataForSeekingToTime:(NSTimeInterval)time {
+    dispatch_async(self.delegateQueue, ^{
+        [self internalPrefetchDataForSeekingToTime:time];
+    });
+}
+
+- (void)internalPrefetchDataForSeekingToTime:(NSTimeInterval)time {
+    if (self.cacheFile.isCompleted || ![self buildSeekIndexIfNeed]) {
+        return;
+    }
+
+    NSRange dataRange = [self.seekIndex byteRangeForTime:time
+                                                  window:kJPVideoPlayerSeekPrefetchWindow];
+    if (!JPValidFileRange(dataRange)) {
+        return;
+    }
+
+    dataRange.length = MIN(dataRange.length, kJPVideoPlayerSeekPrefetchMaxLength);
+    NSUInteger cacheableLength = self.cacheFile.cacheableLength;
+    if (dataRange.location >= cacheableLength) {
+        return;
+    }
+    dataRange.length = MIN(dataRange.length, cacheableLength - dataRange.location);
+    NSRange missingRange = [self.cacheFile missingRangesInRange:dataRange].firstObject.rangeValue;
+    if (!JPValidFileRange(missingRange)) {
+        return;
+    }
+    NSRange prefetchRange = self.seekPrefetchTask.requestRange;
+    if (self.seekPrefetchTask && NSLocationInRange(missingRange.location, prefetchRange)) {
+        return;
+    }
+    if ([self isDownloadingPosition:missingRange.location]) {
+        return;
+    }
+
+    // the user dragged to other position, the data of the last position is useless.
+    [self.seekPrefetchTask cancel];
+    JPResourceLoadingRequestWebTask *requestTask = [JPResourceLoadingRequestWebTask readAheadTaskWithRequestRange:missingRange
+                                                                                                        cacheFile:self.cacheFile
+                                                                                                        customURL:self.customURL];
+    // the user is waiting for it.
+    requestTask.downloadPriority = JPVideoPlayerDownloadPrioritySeekTarget;
+    requestTask.internal = YES;
+    requestTask.delegate = self;
+    requestTask.delegateQueue = self.delegateQueue;
+    self.seekPrefetchTask = requestTask;
+    JPDebugLog(@"ResourceLoader 预取拖动目标的数据, 时间: %.2f, 数据范围是: %@", time, NSStringFromRange(missingRange));
+    if (self.delegate && [self.delegate respondsToSelector:@selector(resourceLoader:didReceiveLoadingRequestTask:)]) {
+        [self.delegate resourceLoader:self didReceiveLoadingRequestTask:requestTask];
+    }
+    [requestTask start];
+}
+
+/**
+ * Build the seek index from the cached `moov` box, the `moov` is located by the box walker.
+ *
+ * @return NO if the `moov` is not located or not cached yet.
+ */
+- (BOOL)buildSeekIndexIfNeed {
+    if (self.seekIndex) {
+        return YES;
+    }
+
+    NSRange moovRange = self.boxWalker.moovRange;
+    if (!JPValidFileRange(moovRange) || [self.cacheFile missingRangesInRange:moovRange].count) {
+        return NO;
+    }
+    NSData *moovData = [self.cacheFile dataWithRange:moovRange];
+    if (moovData.length != moovRange.length) {
+        return NO;
+    }
+    self.seekIndex = [JPVideoPlayerMP4SeekIndex seekIndexWithMoovData:moovData];
+    JPDebugLog(@"ResourceLoader 从缓存的 moov 创建了 seek index, 时长: %.2f", self.seekIndex.duration);
+    return self.seekIndex != nil;
+}
+
 @end
@@ -324,6 +324,13 @@ NS_ASSUME_NONNULL_BEGIN
 */
 - (BOOL)jp_seekToTime:(CMTime)time;
 
+/**
+ * Download the data of the time the user is dragging to, so the seek finish fast.
+ *
+ * @param time The time where will seek to, in seconds.
+ */
+- (void)jp_prefetchVideoDataForSeekingToTime:(NSTimeInterval)time;
+
 /**
  * Fetch the elapsed seconds of player.
  */
@@ -403,6 +403,10 @@
     return [[JPVideoPlayerManager sharedManager] seekToTime:time];
 }
 
+- (void)jp_prefetchVideoDataForSeekingToTime:(NSTimeInterval)time {
+    [[JPVideoPlayerManager sharedManager] prefetchVideoDataForSeekingToTime:time];
+}
+
 - (NSTimeInterval)jp_elapsedSeconds {
     return [JPVideoPlayerManager.sharedManager elapsedSeconds];
 }
@@ -0,0 +1,144 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerCacheFileTestCase.h"
+#import "JPCRC32C.h"
+
+static const NSUInteger kJPTestBlockSize = 128 * 1024;
+
+/**
+ * The bitwise reference of CRC-32C, slow but obviously right.
+ */
+static uint32_t JPCRC32CReference(const uint8_t *bytes, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= bytes[i];
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+@interface JPCRC32CTests : JPVideoPlayerCacheFileTestCase
+
+@end
+
+@implementation JPCRC32CTests
+
+- (void)corruptByteAtPosition:(NSUInteger)position {
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForUpdatingAtPath:self.filePath];
+    [fileHandle seekToFileOffset:position];
+    uint8_t byte = ((const uint8_t *)[fileHandle readDataOfLength:1].bytes)[0] ^ 0xFF;
+    [fileHandle seekToFileOffset:position];
+    [fileHandle writeData:[NSData dataWithBytes:&byte length:1]];
+    [fileHandle closeFile];
+}
+
+
+#pragma mark - Kernel
+
+- (void)testKnownVectors {
+    XCTAssertEqual(JPCRC32CUpdate(0, "123456789", 9), 0xE3069283);
+    XCTAssertEqual(JPCRC32CUpdate(0, "", 0), 0);
+
+    uint8_t bytes[32];
+    memset(bytes, 0, sizeof(bytes));
+    XCTAssertEqual(JPCRC32CUpdate(0, bytes, sizeof(bytes)), 0x8A9136AA);
+    memset(bytes, 0xFF, sizeof(bytes));
+    XCTAssertEqual(JPCRC32CUpdate(0, bytes, sizeof(bytes)), 0x62A8AB43);
+    for (uint8_t i = 0; i < sizeof(bytes); i++) {
+        bytes[i] = i;
+    }
+    XCTAssertEqual(JPCRC32CUpdate(0, bytes, sizeof(bytes)), 0x46DD794E);
+}
+
+- (void)testUnalignedBytesMatchReference {
+    NSData *data = [self videoDataInRange:NSMakeRange(0, 4096)];
+    const uint8_t *bytes = data.bytes;
+    for (NSUInteger offset = 0; offset < 16; offset++) {
+        for (NSUInteger length = 0; length < 80; length += 7) {
+            XCTAssertEqual(JPCRC32CUpdate(0, bytes + offset, length), JPCRC32CReference(bytes + offset, length));
+        }
+    }
+    XCTAssertEqual(JPCRC32CUpdate(0, bytes + 3, 4093), JPCRC32CReference(bytes + 3, 4093));
+}
+
+- (void)testIncrementalUpdateMatchOneShot {
+    NSData *data = [self videoDataInRange:NSMakeRange(0, 10000)];
+    const uint8_t *bytes = data.bytes;
+    uint32_t crc = 0;
+    for (NSUInteger offset = 0; offset < data.length; offset += 333) {
+        crc = JPCRC32CUpdate(crc, bytes + offset, MIN(333, data.length - offset));
+    }
+    XCTAssertEqual(crc, JPCRC32CUpdate(0, bytes, data.length));
+}
+
+
+#pragma mark - Cache File
+
+- (void)testCorruptBlockIsEvicted {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:4 * kJPTestBlockSize];
+    cacheFile.verifiesChecksum = YES;
+    [self storeVideoDataInRange:NSMakeRange(0, 2 * kJPTestBlockSize) toCacheFile:cacheFile synchronize:YES];
+    [self corruptByteAtPosition:kJPTestBlockSize + 100];
+
+    // serve the head before the corrupt block only.
+    NSData *data = [cacheFile dataWithRange:NSMakeRange(0, 2 * kJPTestBlockSize)];
+    XCTAssertEqualObjects(data, [self videoDataInRange:NSMakeRange(0, kJPTestBlockSize)]);
+    XCTAssertTrue([cacheFile isBlockCachedAtPosition:0]);
+    XCTAssertFalse([cacheFile isBlockCachedAtPosition:kJPTestBlockSize]);
+    XCTAssertNil([cacheFile dataWithRange:NSMakeRange(kJPTestBlockSize, 10)]);
+    XCTAssertEqualObjects(cacheFile.fragmentRanges, @[[NSValue valueWithRange:NSMakeRange(0, kJPTestBlockSize)]]);
+}
+
+- (void)testChecksumsStoredWithIndex {
+    @autoreleasepool {
+        JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:4 * kJPTestBlockSize];
+        cacheFile.verifiesChecksum = YES;
+        [self storeVideoDataInRange:NSMakeRange(0, 4 * kJPTestBlockSize) toCacheFile:cacheFile synchronize:YES];
+        XCTAssertTrue(cacheFile.isCompleted);
+    }
+    [self corruptByteAtPosition:3 * kJPTestBlockSize];
+
+    JPVideoPlayerCacheFile *cacheFile = [self openCacheFile];
+    cacheFile.verifiesChecksum = YES;
+    NSData *data = [cacheFile dataWithRange:NSMakeRange(kJPTestBlockSize, 3 * kJPTestBlockSize)];
+    XCTAssertEqualObjects(data, [self videoDataInRange:NSMakeRange(kJPTestBlockSize, 2 * kJPTestBlockSize)]);
+    XCTAssertFalse(cacheFile.isCompleted);
+    XCTAssertFalse([cacheFile isBlockCachedAtPosition:3 * kJPTestBlockSize]);
+}
+
+- (void)testBlocksWithoutChecksumNotVerified {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:4 * kJPTestBlockSize];
+    [self storeVideoDataInRange:NSMakeRange(0, kJPTestBlockSize) toCacheFile:cacheFile synchronize:YES];
+    cacheFile.verifiesChecksum = YES;
+    [self corruptByteAtPosition:100];
+
+    XCTAssertEqual([cacheFile dataWithRange:NSMakeRange(0, kJPTestBlockSize)].length, kJPTestBlockSize);
+    XCTAssertTrue([cacheFile isBlockCachedAtPosition:0]);
+}
+
+
+#pragma mark - Benchmark
+
+- (void)testChecksumPerformance {
+    NSData *data = [self videoDataInRange:NSMakeRange(0, 16 * 1024 * 1024)];
+    [self measureBlock:^{
+        uint32_t crc = 0;
+        for (NSUInteger offset = 0; offset < data.length; offset += kJPTestBlockSize) {
+            crc ^= JPCRC32CUpdate(0, (const uint8_t *)data.bytes + offset, kJPTestBlockSize);
+        }
+        XCTAssertNotEqual(crc, 0);
+    }];
+}
+
+@end
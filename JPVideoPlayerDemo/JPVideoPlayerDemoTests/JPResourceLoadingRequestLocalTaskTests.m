@@ -0,0 +1,222 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerCacheFileTestCase.h"
+#import "JPResourceLoadingRequestTask.h"
+
+static const NSUInteger kJPTestFileLength = 8 * 1024 * 1024;
+static const NSUInteger kJPTestBenchmarkFileLength = 64 * 1024 * 1024;
+
+/**
+ * A cache file record the ranges read by the local task.
+ */
+@interface JPTestRecordingCacheFile : JPVideoPlayerCacheFile
+
+@property (nonatomic, strong, readonly) NSMutableArray<NSValue *> *readRanges;
+
+@end
+
+@implementation JPTestRecordingCacheFile {
+    NSMutableArray<NSValue *> *_readRanges;
+}
+
+- (NSMutableArray<NSValue *> *)readRanges {
+    @synchronized (self) {
+        if (!_readRanges) {
+            _readRanges = [NSMutableArray array];
+        }
+        return _readRanges;
+    }
+}
+
+- (NSData *)dataWithRange:(NSRange)range {
+    @synchronized (self) {
+        [self.readRanges addObject:[NSValue valueWithRange:range]];
+    }
+    return [super dataWithRange:range];
+}
+
+@end
+
+@interface JPResourceLoadingRequestLocalTaskTests : JPVideoPlayerCacheFileTestCase<JPResourceLoadingRequestTaskDelegate>
+
+@property (nonatomic, strong) dispatch_queue_t queue;
+
+@property (nonatomic, strong, nullable) XCTestExpectation *completeExpectation;
+
+@property (nonatomic, strong, nullable) NSError *completeError;
+
+@end
+
+@implementation JPResourceLoadingRequestLocalTaskTests
+
+- (void)setUp {
+    [super setUp];
+    self.queue = dispatch_queue_create("com.jpvideoplayer.tests.local.task.www", DISPATCH_QUEUE_SERIAL);
+}
+
+/**
+ * Cache the video data in given range, then reopen the cache file as a recording one.
+ */
+- (JPTestRecordingCacheFile *)recordingCacheFileWithFileLength:(NSUInteger)fileLength
+                                                   cachedRange:(NSRange)cachedRange {
+    @autoreleasepool {
+        JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:fileLength];
+        [self storeVideoDataInRange:cachedRange toCacheFile:cacheFile synchronize:YES];
+    }
+    return [JPTestRecordingCacheFile cacheFileWithFilePath:self.filePath indexFilePath:self.indexFilePath];
+}
+
+- (NSError *)runLocalTaskWithRequestRange:(NSRange)requestRange
+                                cacheFile:(JPVideoPlayerCacheFile *)cacheFile
+                     minimumReadChunkSize:(NSUInteger)minimumReadChunkSize
+                     maximumReadChunkSize:(NSUInteger)maximumReadChunkSize {
+    JPResourceLoadingRequestLocalTask *requestTask = [JPResourceLoadingRequestLocalTask requestTaskWithLoadingRequest:nil
+                                                                                                         requestRange:requestRange
+                                                                                                            cacheFile:cacheFile
+                                                                                                            customURL:[NSURL URLWithString:@"http://www.example.com/video.mp4"]
+                                                                                                               cached:YES];
+    if (minimumReadChunkSize) {
+        requestTask.minimumReadChunkSize = minimumReadChunkSize;
+    }
+    if (maximumReadChunkSize) {
+        requestTask.maximumReadChunkSize = maximumReadChunkSize;
+    }
+    requestTask.delegate = self;
+    self.completeError = nil;
+    self.completeExpectation = [self expectationWithDescription:@"local task complete"];
+    [requestTask startOnQueue:self.queue];
+    [self waitForExpectationsWithTimeout:30 handler:nil];
+    return self.completeError;
+}
+
+- (void)assertReadRanges:(NSArray<NSValue *> *)readRanges
+     coverRequestRange:(NSRange)requestRange
+  minimumReadChunkSize:(NSUInteger)minimumReadChunkSize
+  maximumReadChunkSize:(NSUInteger)maximumReadChunkSize {
+    NSUInteger offset = requestRange.location;
+    NSUInteger chunkSize = MIN(minimumReadChunkSize, maximumReadChunkSize);
+    for (NSValue *value in readRanges) {
+        NSRange range = value.rangeValue;
+        XCTAssertEqual(range.location, offset);
+        XCTAssertEqual(range.length, MIN(chunkSize, NSMaxRange(requestRange) - offset));
+        offset = NSMaxRange(range);
+        chunkSize = MIN(chunkSize * 2, maximumReadChunkSize);
+    }
+    XCTAssertEqual(offset, NSMaxRange(requestRange));
+}
+
+
+#pragma mark - JPResourceLoadingRequestTaskDelegate
+
+- (void)requestTask:(JPResourceLoadingRequestTask *)requestTask
+didCompleteWithError:(NSError *)error {
+    self.completeError = error;
+    [self.completeExpectation fulfill];
+}
+
+
+#pragma mark - Chunk Size
+
+- (void)testReadChunkDoubleFromMinimumToMaximum {
+    JPTestRecordingCacheFile *cacheFile = [self recordingCacheFileWithFileLength:kJPTestFileLength
+                                                                     cachedRange:NSMakeRange(0, kJPTestFileLength)];
+    NSRange requestRange = NSMakeRange(0, kJPTestFileLength);
+    XCTAssertNil([self runLocalTaskWithRequestRange:requestRange
+                                          cacheFile:cacheFile
+                               minimumReadChunkSize:0
+                               maximumReadChunkSize:0]);
+
+    // 32 KB, 64 KB, ... 512 KB, then 1 MB until the end.
+    NSArray<NSValue *> *readRanges = [cacheFile.readRanges copy];
+    XCTAssertEqual(readRanges.firstObject.rangeValue.length, 32 * 1024);
+    XCTAssertEqual(readRanges.count, 13);
+    [self assertReadRanges:readRanges
+         coverRequestRange:requestRange
+      minimumReadChunkSize:32 * 1024
+      maximumReadChunkSize:1024 * 1024];
+}
+
+- (void)testCustomReadChunkSize {
+    JPTestRecordingCacheFile *cacheFile = [self recordingCacheFileWithFileLength:kJPTestFileLength
+                                                                     cachedRange:NSMakeRange(0, kJPTestFileLength)];
+    NSRange requestRange = NSMakeRange(100, 100 * 1024);
+    XCTAssertNil([self runLocalTaskWithRequestRange:requestRange
+                                          cacheFile:cacheFile
+                               minimumReadChunkSize:4 * 1024
+                               maximumReadChunkSize:16 * 1024]);
+    [self assertReadRanges:[cacheFile.readRanges copy]
+         coverRequestRange:requestRange
+      minimumReadChunkSize:4 * 1024
+      maximumReadChunkSize:16 * 1024];
+}
+
+- (void)testMinimumReadChunkSizeClampedToMaximum {
+    JPTestRecordingCacheFile *cacheFile = [self recordingCacheFileWithFileLength:kJPTestFileLength
+                                                                     cachedRange:NSMakeRange(0, kJPTestFileLength)];
+    NSRange requestRange = NSMakeRange(0, 100 * 1024);
+    XCTAssertNil([self runLocalTaskWithRequestRange:requestRange
+                                          cacheFile:cacheFile
+                               minimumReadChunkSize:64 * 1024
+                               maximumReadChunkSize:16 * 1024]);
+    NSArray<NSValue *> *readRanges = [cacheFile.readRanges copy];
+    XCTAssertEqual(readRanges.firstObject.rangeValue.length, 16 * 1024);
+    [self assertReadRanges:readRanges
+         coverRequestRange:requestRange
+      minimumReadChunkSize:16 * 1024
+      maximumReadChunkSize:16 * 1024];
+}
+
+- (void)testNotCachedDataFailWithInvalidatedError {
+    JPTestRecordingCacheFile *cacheFile = [self recordingCacheFileWithFileLength:kJPTestFileLength
+                                                                     cachedRange:NSMakeRange(0, 1024 * 1024)];
+    NSError *error = [self runLocalTaskWithRequestRange:NSMakeRange(0, 2 * 1024 * 1024)
+                                              cacheFile:cacheFile
+                                   minimumReadChunkSize:0
+                                   maximumReadChunkSize:0];
+    XCTAssertEqualObjects(error.domain, JPVideoPlayerErrorDomain);
+    XCTAssertEqual(error.code, JPVideoPlayerErrorCodeCachedDataInvalidated);
+    // the read reaching the end of cached data return the cached head, the next read find nothing.
+    XCTAssertEqual(cacheFile.readRanges.lastObject.rangeValue.location, 1024 * 1024);
+}
+
+
+#pragma mark - Benchmark
+
+- (void)measureLocalTaskWithMinimumReadChunkSize:(NSUInteger)minimumReadChunkSize
+                            maximumReadChunkSize:(NSUInteger)maximumReadChunkSize {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestBenchmarkFileLength];
+    // leave the last byte not cached, so the reads take the positional read path like a file being downloaded.
+    [self storeVideoDataInRange:NSMakeRange(0, kJPTestBenchmarkFileLength - 1) toCacheFile:cacheFile synchronize:YES];
+    dispatch_block_t block = ^{
+        XCTAssertNil([self runLocalTaskWithRequestRange:NSMakeRange(0, kJPTestBenchmarkFileLength - 1)
+                                              cacheFile:cacheFile
+                                   minimumReadChunkSize:minimumReadChunkSize
+                                   maximumReadChunkSize:maximumReadChunkSize]);
+    };
+    if (@available(iOS 13.0, *)) {
+        [self measureWithMetrics:@[[XCTCPUMetric new], [XCTClockMetric new]] block:block];
+    }
+    else {
+        [self measureBlock:block];
+    }
+}
+
+- (void)testAdaptiveReadChunkPerformance {
+    [self measureLocalTaskWithMinimumReadChunkSize:0 maximumReadChunkSize:0];
+}
+
+- (void)testFixedSmallReadChunkPerformance {
+    // the fixed 32 KB read of the old local task.
+    [self measureLocalTaskWithMinimumReadChunkSize:32 * 1024 maximumReadChunkSize:32 * 1024];
+}
+
+@end
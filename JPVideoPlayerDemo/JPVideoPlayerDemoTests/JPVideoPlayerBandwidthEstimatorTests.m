@@ -0,0 +1,217 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import <XCTest/XCTest.h>
+#import "JPVideoPlayerBandwidthEstimator.h"
+
+static NSString *const kJPTestHost = @"www.example.com";
+static NSString *const kJPTestOtherHost = @"cdn.example.com";
+// longer than the min duration of a throughput sample.
+static const useconds_t kJPTestSampleInterval = 250 * 1000;
+
+@interface JPVideoPlayerBandwidthEstimatorTests : XCTestCase
+
+@property (nonatomic, strong) JPVideoPlayerBandwidthEstimator *estimator;
+
+@end
+
+@implementation JPVideoPlayerBandwidthEstimatorTests
+
+- (void)setUp {
+    [super setUp];
+    self.estimator = [JPVideoPlayerBandwidthEstimator new];
+}
+
+
+#pragma mark - Latency
+
+- (void)testEstimateBeforeMeasured {
+    JPVideoPlayerBandwidthEstimate *estimate = [self.estimator estimate];
+    XCTAssertNil(estimate.host);
+    XCTAssertEqual(estimate.throughputSampleCount, 0);
+    XCTAssertEqual(estimate.throughput, 0);
+    XCTAssertEqual(estimate.timeToFirstByte, 0);
+    XCTAssertEqual(estimate.roundTripTime, 0);
+    XCTAssertEqual([estimate throughputAtPercentile:0.5], 0);
+    XCTAssertEqual([estimate timeToFirstByteAtPercentile:0.5], 0);
+    XCTAssertNil([self.estimator estimateForHost:kJPTestHost]);
+}
+
+- (void)testAverageIsExponentiallyWeighted {
+    [self.estimator recordTimeToFirstByte:1 forHost:kJPTestHost];
+    XCTAssertEqualWithAccuracy([self.estimator estimate].timeToFirstByte, 1, 1e-9);
+
+    // the new sample weight a quarter.
+    [self.estimator recordTimeToFirstByte:2 forHost:kJPTestHost];
+    XCTAssertEqualWithAccuracy([self.estimator estimate].timeToFirstByte, 1.25, 1e-9);
+    [self.estimator recordTimeToFirstByte:0.25 forHost:kJPTestHost];
+    XCTAssertEqualWithAccuracy([self.estimator estimate].timeToFirstByte, 1, 1e-9);
+
+    [self.estimator recordRoundTripTime:0.1 forHost:kJPTestHost];
+    [self.estimator recordRoundTripTime:0.5 forHost:kJPTestHost];
+    XCTAssertEqualWithAccuracy([self.estimator estimateForHost:kJPTestHost].roundTripTime, 0.2, 1e-9);
+}
+
+- (void)testPercentilesAreInterpolated {
+    for (NSUInteger i = 5; i > 0; i--) {
+        [self.estimator recordRoundTripTime:i forHost:kJPTestHost];
+    }
+
+    JPVideoPlayerBandwidthEstimate *estimate = [self.estimator estimateForHost:kJPTestHost];
+    XCTAssertEqualWithAccuracy([estimate roundTripTimeAtPercentile:0], 1, 1e-9);
+    XCTAssertEqualWithAccuracy([estimate roundTripTimeAtPercentile:0.1], 1.4, 1e-9);
+    XCTAssertEqualWithAccuracy([estimate roundTripTimeAtPercentile:0.5], 3, 1e-9);
+    XCTAssertEqualWithAccuracy([estimate roundTripTimeAtPercentile:1], 5, 1e-9);
+    // the percentile out of bounds is clamped.
+    XCTAssertEqualWithAccuracy([estimate roundTripTimeAtPercentile:-1], 1, 1e-9);
+    XCTAssertEqualWithAccuracy([estimate roundTripTimeAtPercentile:2], 5, 1e-9);
+}
+
+- (void)testPercentilesCoverLatestSamples {
+    for (NSUInteger i = 1; i <= 40; i++) {
+        [self.estimator recordTimeToFirstByte:i forHost:kJPTestHost];
+    }
+
+    // the window hold the latest 32 samples.
+    JPVideoPlayerBandwidthEstimate *estimate = [self.estimator estimate];
+    XCTAssertEqualWithAccuracy([estimate timeToFirstByteAtPercentile:0], 9, 1e-9);
+    XCTAssertEqualWithAccuracy([estimate timeToFirstByteAtPercentile:1], 40, 1e-9);
+}
+
+- (void)testNegativeSamplesAreIgnored {
+    [self.estimator recordTimeToFirstByte:-1 forHost:kJPTestHost];
+    [self.estimator recordRoundTripTime:-1 forHost:kJPTestHost];
+    XCTAssertNil([self.estimator estimateForHost:kJPTestHost]);
+    XCTAssertEqual([self.estimator estimate].timeToFirstByte, 0);
+    XCTAssertEqual([self.estimator estimate].roundTripTime, 0);
+}
+
+- (void)testEstimatesArePerHost {
+    [self.estimator recordTimeToFirstByte:1 forHost:kJPTestHost];
+    [self.estimator recordTimeToFirstByte:3 forHost:kJPTestOtherHost];
+
+    JPVideoPlayerBandwidthEstimate *estimate = [self.estimator estimateForHost:kJPTestHost];
+    XCTAssertEqualObjects(estimate.host, kJPTestHost);
+    XCTAssertEqualWithAccuracy(estimate.timeToFirstByte, 1, 1e-9);
+    XCTAssertEqualWithAccuracy([self.estimator estimateForHost:kJPTestOtherHost].timeToFirstByte, 3, 1e-9);
+    XCTAssertEqualWithAccuracy([[self.estimator estimate] timeToFirstByteAtPercentile:1], 3, 1e-9);
+}
+
+- (void)testEstimateIsSnapshot {
+    [self.estimator recordTimeToFirstByte:1 forHost:kJPTestHost];
+    JPVideoPlayerBandwidthEstimate *estimate = [self.estimator estimate];
+    [self.estimator recordTimeToFirstByte:5 forHost:kJPTestHost];
+
+    XCTAssertEqualWithAccuracy(estimate.timeToFirstByte, 1, 1e-9);
+    XCTAssertEqualWithAccuracy([estimate timeToFirstByteAtPercentile:1], 1, 1e-9);
+}
+
+- (void)testReset {
+    [self.estimator recordTimeToFirstByte:1 forHost:kJPTestHost];
+    [self.estimator reset];
+
+    XCTAssertNil([self.estimator estimateForHost:kJPTestHost]);
+    XCTAssertEqual([self.estimator estimate].timeToFirstByte, 0);
+}
+
+
+#pragma mark - Throughput
+
+- (void)testThroughputSample {
+    [self.estimator transferDidStartForHost:kJPTestHost];
+    // too short to be representative.
+    XCTAssertFalse([self.estimator transferDidReceiveDataWithLength:64 * 1024 forHost:kJPTestHost]);
+
+    usleep(kJPTestSampleInterval);
+    XCTAssertTrue([self.estimator transferDidReceiveDataWithLength:128 * 1024 forHost:kJPTestHost]);
+
+    JPVideoPlayerBandwidthEstimate *estimate = [self.estimator estimateForHost:kJPTestHost];
+    XCTAssertEqual(estimate.throughputSampleCount, 1);
+    XCTAssertGreaterThan(estimate.throughput, 0);
+    XCTAssertLessThanOrEqual(estimate.throughput, 192 * 1024 / (kJPTestSampleInterval / 1e6));
+    XCTAssertEqualWithAccuracy([estimate throughputAtPercentile:0.5], estimate.throughput, 1e-6);
+    XCTAssertEqual([self.estimator estimate].throughputSampleCount, 1);
+
+    // the sample restarts after measured.
+    XCTAssertFalse([self.estimator transferDidReceiveDataWithLength:128 * 1024 forHost:kJPTestHost]);
+    [self.estimator transferDidEndForHost:kJPTestHost];
+}
+
+- (void)testTailOfTransferIsSampled {
+    [self.estimator transferDidStartForHost:kJPTestHost];
+    XCTAssertFalse([self.estimator transferDidReceiveDataWithLength:64 * 1024 forHost:kJPTestHost]);
+    usleep(kJPTestSampleInterval);
+
+    XCTAssertTrue([self.estimator transferDidEndForHost:kJPTestHost]);
+    XCTAssertEqual([self.estimator estimateForHost:kJPTestHost].throughputSampleCount, 1);
+}
+
+- (void)testShortTailIsNotSampled {
+    [self.estimator transferDidStartForHost:kJPTestHost];
+    XCTAssertFalse([self.estimator transferDidReceiveDataWithLength:16 * 1024 forHost:kJPTestHost]);
+    usleep(kJPTestSampleInterval);
+
+    XCTAssertFalse([self.estimator transferDidEndForHost:kJPTestHost]);
+    XCTAssertEqual([self.estimator estimate].throughputSampleCount, 0);
+}
+
+- (void)testConcurrentTransfersAreMeasuredAsWhole {
+    [self.estimator transferDidStartForHost:kJPTestHost];
+    [self.estimator transferDidStartForHost:kJPTestHost];
+    XCTAssertFalse([self.estimator transferDidReceiveDataWithLength:64 * 1024 forHost:kJPTestHost]);
+    usleep(kJPTestSampleInterval);
+
+    // the other transfer is still receiving, the tail is not sampled yet.
+    XCTAssertFalse([self.estimator transferDidEndForHost:kJPTestHost]);
+    XCTAssertTrue([self.estimator transferDidEndForHost:kJPTestHost]);
+    // not paired with a start.
+    XCTAssertFalse([self.estimator transferDidEndForHost:kJPTestHost]);
+}
+
+- (void)testDataWithoutTransferIsIgnored {
+    usleep(kJPTestSampleInterval);
+    XCTAssertFalse([self.estimator transferDidReceiveDataWithLength:1024 * 1024 forHost:kJPTestHost]);
+    XCTAssertEqual([self.estimator estimate].throughputSampleCount, 0);
+}
+
+- (void)testIdleTimeIsNotCounted {
+    [self.estimator transferDidStartForHost:kJPTestHost];
+    [self.estimator transferDidEndForHost:kJPTestHost];
+    usleep(kJPTestSampleInterval);
+
+    // the sample starts from the new transfer, not long enough.
+    [self.estimator transferDidStartForHost:kJPTestHost];
+    XCTAssertFalse([self.estimator transferDidReceiveDataWithLength:1024 * 1024 forHost:kJPTestHost]);
+    [self.estimator transferDidEndForHost:kJPTestHost];
+}
+
+
+#pragma mark - Benchmark
+
+- (void)testLockContentionPerformance {
+    NSArray<NSString *> *hosts = @[kJPTestHost, kJPTestOtherHost];
+    [self measureBlock:^{
+        dispatch_apply(8, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+            NSString *host = hosts[i % hosts.count];
+            [self.estimator transferDidStartForHost:host];
+            for (NSUInteger j = 0; j < 10000; j++) {
+                [self.estimator transferDidReceiveDataWithLength:16 * 1024 forHost:host];
+                if (j % 100 == 0) {
+                    [self.estimator recordTimeToFirstByte:0.1 forHost:host];
+                }
+            }
+            [self.estimator transferDidEndForHost:host];
+        });
+    }];
+    XCTAssertEqualWithAccuracy([self.estimator estimate].timeToFirstByte, 0.1, 1e-9);
+}
+
+@end
@@ -0,0 +1,185 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import <XCTest/XCTest.h>
+#import "JPVideoPlayerBlockBitmap.h"
+
+@interface JPVideoPlayerBlockBitmapTests : XCTestCase
+
+@end
+
+/**
+ * A linear congruential generator, every run use the same blocks.
+ */
+static NSUInteger JPNextRandom(uint64_t *seed, NSUInteger bound) {
+    *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (NSUInteger)((*seed >> 33) % bound);
+}
+
+@implementation JPVideoPlayerBlockBitmapTests
+
+#pragma mark - Blocks
+
+- (void)testBlockCountRoundUp {
+    JPVideoPlayerBlockBitmap *bitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:1000 blockSize:100];
+    XCTAssertEqual(bitmap.blockCount, 10);
+    bitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:1001 blockSize:100];
+    XCTAssertEqual(bitmap.blockCount, 11);
+    bitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:0 blockSize:100];
+    XCTAssertEqual(bitmap.blockCount, 0);
+    XCTAssertEqual([bitmap firstClearBlockFromIndex:0], NSNotFound);
+    XCTAssertEqualObjects(bitmap.byteRanges, @[]);
+}
+
+- (void)testSetAndClearBlocksAcrossWords {
+    JPVideoPlayerBlockBitmap *bitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:200 * 10 blockSize:10];
+    [bitmap setBlocksInRange:NSMakeRange(60, 80)];
+    XCTAssertEqual(bitmap.setBlockCount, 80);
+    XCTAssertFalse([bitmap isBlockSetAtIndex:59]);
+    XCTAssertTrue([bitmap isBlockSetAtIndex:60]);
+    XCTAssertTrue([bitmap isBlockSetAtIndex:139]);
+    XCTAssertFalse([bitmap isBlockSetAtIndex:140]);
+
+    // set again do not count twice.
+    [bitmap setBlocksInRange:NSMakeRange(50, 20)];
+    XCTAssertEqual(bitmap.setBlockCount, 90);
+
+    [bitmap clearBlocksInRange:NSMakeRange(64, 64)];
+    XCTAssertEqual(bitmap.setBlockCount, 26);
+    XCTAssertTrue([bitmap isBlockSetAtIndex:63]);
+    XCTAssertFalse([bitmap isBlockSetAtIndex:64]);
+    XCTAssertFalse([bitmap isBlockSetAtIndex:127]);
+    XCTAssertTrue([bitmap isBlockSetAtIndex:128]);
+
+    [bitmap clearAllBlocks];
+    XCTAssertEqual(bitmap.setBlockCount, 0);
+    XCTAssertEqual([bitmap firstSetBlockFromIndex:0], NSNotFound);
+}
+
+- (void)testBlocksBeyondEndIgnored {
+    JPVideoPlayerBlockBitmap *bitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:70 * 10 blockSize:10];
+    [bitmap setBlocksInRange:NSMakeRange(60, 100)];
+    XCTAssertEqual(bitmap.setBlockCount, 10);
+    XCTAssertFalse([bitmap isBlockSetAtIndex:70]);
+    // the padding bits of the last word are never reported.
+    XCTAssertEqual([bitmap firstClearBlockFromIndex:60], NSNotFound);
+    XCTAssertEqual([bitmap firstSetBlockFromIndex:70], NSNotFound);
+}
+
+- (void)testContainsPosition {
+    JPVideoPlayerBlockBitmap *bitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:1000 blockSize:100];
+    [bitmap setBlocksInRange:NSMakeRange(2, 1)];
+    XCTAssertFalse([bitmap containsPosition:199]);
+    XCTAssertTrue([bitmap containsPosition:200]);
+    XCTAssertTrue([bitmap containsPosition:299]);
+    XCTAssertFalse([bitmap containsPosition:300]);
+    XCTAssertFalse([bitmap containsPosition:1000]);
+}
+
+
+#pragma mark - Scan
+
+- (void)testFirstSetAndClearBlock {
+    JPVideoPlayerBlockBitmap *bitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:300 blockSize:1];
+    [bitmap setBlocksInRange:NSMakeRange(0, 10)];
+    [bitmap setBlocksInRange:NSMakeRange(200, 100)];
+    XCTAssertEqual([bitmap firstSetBlockFromIndex:0], 0);
+    XCTAssertEqual([bitmap firstSetBlockFromIndex:5], 5);
+    XCTAssertEqual([bitmap firstSetBlockFromIndex:10], 200);
+    XCTAssertEqual([bitmap firstClearBlockFromIndex:0], 10);
+    XCTAssertEqual([bitmap firstClearBlockFromIndex:200], NSNotFound);
+    XCTAssertEqual([bitmap firstSetBlockFromIndex:300], NSNotFound);
+}
+
+
+#pragma mark - Byte Range
+
+- (void)testBlockRangeInsideByteRange {
+    JPVideoPlayerBlockBitmap *bitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:950 blockSize:100];
+    XCTAssertTrue(NSEqualRanges([bitmap blockRangeInsideByteRange:NSMakeRange(0, 100)], NSMakeRange(0, 1)));
+    XCTAssertTrue(NSEqualRanges([bitmap blockRangeInsideByteRange:NSMakeRange(50, 300)], NSMakeRange(1, 2)));
+    XCTAssertEqual([bitmap blockRangeInsideByteRange:NSMakeRange(150, 100)].length, 0);
+    // the last block is shorter, it is covered when the range reach the end of file.
+    XCTAssertTrue(NSEqualRanges([bitmap blockRangeInsideByteRange:NSMakeRange(900, 50)], NSMakeRange(9, 1)));
+    XCTAssertTrue(NSEqualRanges([bitmap blockRangeInsideByteRange:NSMakeRange(800, 1000)], NSMakeRange(8, 2)));
+}
+
+- (void)testBlockRangeOverlapByteRange {
+    JPVideoPlayerBlockBitmap *bitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:950 blockSize:100];
+    XCTAssertTrue(NSEqualRanges([bitmap blockRangeOverlapByteRange:NSMakeRange(150, 1)], NSMakeRange(1, 1)));
+    XCTAssertTrue(NSEqualRanges([bitmap blockRangeOverlapByteRange:NSMakeRange(50, 300)], NSMakeRange(0, 4)));
+    XCTAssertTrue(NSEqualRanges([bitmap blockRangeOverlapByteRange:NSMakeRange(900, 1000)], NSMakeRange(9, 1)));
+    XCTAssertEqual([bitmap blockRangeOverlapByteRange:NSMakeRange(1000, 10)].length, 0);
+}
+
+- (void)testByteRangeForBlockRangeClampedToLength {
+    JPVideoPlayerBlockBitmap *bitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:950 blockSize:100];
+    XCTAssertTrue(NSEqualRanges([bitmap byteRangeForBlockRange:NSMakeRange(2, 3)], NSMakeRange(200, 300)));
+    XCTAssertTrue(NSEqualRanges([bitmap byteRangeForBlockRange:NSMakeRange(8, 5)], NSMakeRange(800, 150)));
+}
+
+- (void)testByteRanges {
+    JPVideoPlayerBlockBitmap *bitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:950 blockSize:100];
+    [bitmap setBlocksInRange:NSMakeRange(0, 2)];
+    [bitmap setBlocksInRange:NSMakeRange(5, 1)];
+    [bitmap setBlocksInRange:NSMakeRange(8, 2)];
+    XCTAssertEqualObjects(bitmap.byteRanges, (@[[NSValue valueWithRange:NSMakeRange(0, 200)],
+                                                [NSValue valueWithRange:NSMakeRange(500, 100)],
+                                                [NSValue valueWithRange:NSMakeRange(800, 150)]]));
+}
+
+- (void)testRandomOperationsMatchIndexSet {
+    // `NSMutableIndexSet` is the reference model of the same bits.
+    uint64_t seed = 1;
+    NSUInteger blockCount = 1000;
+    JPVideoPlayerBlockBitmap *bitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:blockCount blockSize:1];
+    NSMutableIndexSet *model = [NSMutableIndexSet indexSet];
+    for (NSUInteger i = 0; i < 2000; i++) {
+        NSRange blockRange = NSMakeRange(JPNextRandom(&seed, blockCount), JPNextRandom(&seed, 130) + 1);
+        NSRange modelRange = NSMakeRange(blockRange.location, MIN(NSMaxRange(blockRange), blockCount) - blockRange.location);
+        if (JPNextRandom(&seed, 3) == 0) {
+            [bitmap clearBlocksInRange:blockRange];
+            [model removeIndexesInRange:modelRange];
+        }
+        else {
+            [bitmap setBlocksInRange:blockRange];
+            [model addIndexesInRange:modelRange];
+        }
+
+        NSUInteger index = JPNextRandom(&seed, blockCount);
+        NSUInteger setIndex = [model indexGreaterThanOrEqualToIndex:index];
+        XCTAssertEqual([bitmap firstSetBlockFromIndex:index], setIndex);
+    }
+    XCTAssertEqual(bitmap.setBlockCount, model.count);
+
+    NSMutableArray<NSValue *> *ranges = [NSMutableArray array];
+    [model enumerateRangesUsingBlock:^(NSRange range, BOOL *stop) {
+        [ranges addObject:[NSValue valueWithRange:range]];
+    }];
+    XCTAssertEqualObjects(bitmap.byteRanges, ranges);
+}
+
+
+#pragma mark - Benchmark
+
+- (void)testFindGapPerformance {
+    // a 4 GB video of 128 KB blocks, cached except the last block.
+    NSUInteger blockCount = 32 * 1024;
+    JPVideoPlayerBlockBitmap *bitmap = [[JPVideoPlayerBlockBitmap alloc] initWithLength:blockCount blockSize:1];
+    [bitmap setBlocksInRange:NSMakeRange(0, blockCount - 1)];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 1000; i++) {
+            XCTAssertEqual([bitmap firstClearBlockFromIndex:i], blockCount - 1);
+        }
+    }];
+}
+
+@end
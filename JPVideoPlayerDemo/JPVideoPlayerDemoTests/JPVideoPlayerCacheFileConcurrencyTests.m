@@ -0,0 +1,126 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerCacheFileTestCase.h"
+
+static const NSUInteger kJPTestFileLength = 8 * 1024 * 1024;
+static const NSUInteger kJPTestPieceLength = 64 * 1024;
+static const NSUInteger kJPTestReaderCount = 4;
+
+@interface JPVideoPlayerCacheFileConcurrencyTests : JPVideoPlayerCacheFileTestCase
+
+/**
+ * The readers stop when the writer finished.
+ */
+@property (atomic, assign) BOOL stopsReading;
+
+@end
+
+@implementation JPVideoPlayerCacheFileConcurrencyTests
+
+/**
+ * Read random ranges until `stopsReading` is set, every data read must match the video data at its position.
+ *
+ * @return The number of mismatched reads.
+ */
+- (NSUInteger)readRandomRangesOfCacheFile:(JPVideoPlayerCacheFile *)cacheFile
+                                     seed:(uint32_t)seed {
+    NSUInteger mismatchCount = 0;
+    NSUInteger readCount = 0;
+    while (!self.stopsReading || readCount < 100) {
+        @autoreleasepool {
+            seed = seed * 1103515245 + 12345;
+            NSUInteger location = seed % kJPTestFileLength;
+            NSUInteger length = MIN(seed % (2 * kJPTestPieceLength) + 1, kJPTestFileLength - location);
+            NSData *data = [cacheFile dataWithRange:NSMakeRange(location, length)];
+            readCount++;
+            if (!data) {
+                // not cached yet.
+                continue;
+            }
+            if (data.length > length || ![data isEqualToData:[self videoDataInRange:NSMakeRange(location, data.length)]]) {
+                mismatchCount++;
+            }
+        }
+    }
+    return mismatchCount;
+}
+
+- (void)testConcurrentReadsWhileWriting {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    dispatch_group_t group = dispatch_group_create();
+    __block NSUInteger mismatchCount = 0;
+    for (uint32_t i = 0; i < kJPTestReaderCount; i++) {
+        dispatch_group_async(group, queue, ^{
+            NSUInteger count = [self readRandomRangesOfCacheFile:cacheFile seed:i + 1];
+            @synchronized (self) {
+                mismatchCount += count;
+            }
+        });
+    }
+
+    // write the second half first, so the readers meet the gaps and the write-behind buffer.
+    for (NSUInteger offset = kJPTestFileLength / 2; offset < kJPTestFileLength; offset += kJPTestPieceLength) {
+        [self storeVideoDataInRange:NSMakeRange(offset, kJPTestPieceLength) toCacheFile:cacheFile synchronize:NO];
+    }
+    for (NSUInteger offset = 0; offset < kJPTestFileLength / 2; offset += kJPTestPieceLength) {
+        [self storeVideoDataInRange:NSMakeRange(offset, kJPTestPieceLength) toCacheFile:cacheFile synchronize:NO];
+    }
+    XCTAssertTrue([cacheFile synchronize]);
+    self.stopsReading = YES;
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+    XCTAssertEqual(mismatchCount, 0);
+    XCTAssertTrue(cacheFile.isCompleted);
+    XCTAssertEqualObjects([cacheFile dataWithRange:NSMakeRange(0, kJPTestFileLength)],
+                          [self videoDataInRange:NSMakeRange(0, kJPTestFileLength)]);
+}
+
+- (void)testDataWithRangeKeepNoState {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+    [self storeVideoDataInRange:NSMakeRange(0, 1024 * 1024) toCacheFile:cacheFile synchronize:YES];
+    [cacheFile seekToPosition:100];
+
+    XCTAssertEqualObjects([cacheFile dataWithRange:NSMakeRange(5000, 10)], [self videoDataInRange:NSMakeRange(5000, 10)]);
+    XCTAssertEqual(cacheFile.readOffset, 100);
+    XCTAssertEqualObjects([cacheFile readDataWithLength:10], [self videoDataInRange:NSMakeRange(100, 10)]);
+    XCTAssertEqual(cacheFile.readOffset, 110);
+}
+
+- (void)testDataWithRangeReturnCachedHead {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+    [self storeVideoDataInRange:NSMakeRange(0, 1024 * 1024) toCacheFile:cacheFile synchronize:YES];
+
+    XCTAssertEqualObjects([cacheFile dataWithRange:NSMakeRange(1000 * 1024, 100 * 1024)],
+                          [self videoDataInRange:NSMakeRange(1000 * 1024, 24 * 1024)]);
+    XCTAssertNil([cacheFile dataWithRange:NSMakeRange(1024 * 1024, 10)]);
+}
+
+- (void)testConcurrentReadPerformance {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+    // leave the last byte not cached, so the reads take the positional read path.
+    [self storeVideoDataInRange:NSMakeRange(0, kJPTestFileLength - 1) toCacheFile:cacheFile synchronize:YES];
+    XCTAssertFalse(cacheFile.isCompleted);
+
+    [self measureBlock:^{
+        dispatch_apply(kJPTestReaderCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t reader) {
+            for (NSUInteger offset = 0; offset + kJPTestPieceLength < kJPTestFileLength; offset += kJPTestPieceLength) {
+                @autoreleasepool {
+                    NSData *data = [cacheFile dataWithRange:NSMakeRange(offset, kJPTestPieceLength)];
+                    XCTAssertEqual(data.length, kJPTestPieceLength);
+                }
+            }
+        });
+    }];
+}
+
+@end
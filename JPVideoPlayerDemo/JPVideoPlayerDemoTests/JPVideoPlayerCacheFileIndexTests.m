@@ -0,0 +1,241 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerCacheFileTestCase.h"
+
+static const NSUInteger kJPTestFileLength = 4 * 1024 * 1024;
+
+@interface JPVideoPlayerCacheFileIndexTests : JPVideoPlayerCacheFileTestCase
+
+@end
+
+@implementation JPVideoPlayerCacheFileIndexTests
+
+- (NSArray<NSValue *> *)storeFragmentsToCacheFile:(JPVideoPlayerCacheFile *)cacheFile {
+    [self storeVideoDataInRange:NSMakeRange(0, 300 * 1024) toCacheFile:cacheFile synchronize:YES];
+    [self storeVideoDataInRange:NSMakeRange(1024 * 1024, 100 * 1024) toCacheFile:cacheFile synchronize:YES];
+    [self storeVideoDataInRange:NSMakeRange(2000 * 1024, 1) toCacheFile:cacheFile synchronize:YES];
+    return @[[NSValue valueWithRange:NSMakeRange(0, 300 * 1024)],
+             [NSValue valueWithRange:NSMakeRange(1024 * 1024, 100 * 1024)],
+             [NSValue valueWithRange:NSMakeRange(2000 * 1024, 1)]];
+}
+
+- (void)writeLegacyIndexWithFileLength:(NSUInteger)fileLength
+                                ranges:(NSArray<NSString *> *)ranges {
+    NSDictionary *index = @{
+            @"com.newpan.zone.key.www" : ranges,
+            @"com.newpan.size.key.www" : @(fileLength),
+            @"com.newpan.response.header.key.www" : @{@"Content-Type" : @"video/mp4"},
+    };
+    NSData *data = [NSJSONSerialization dataWithJSONObject:index options:0 error:NULL];
+    XCTAssertTrue([data writeToFile:self.indexFilePath atomically:YES]);
+    // the ranges beyond the video data file are dropped on open.
+    if (![[NSFileManager defaultManager] fileExistsAtPath:self.filePath]) {
+        [[NSFileManager defaultManager] createFileAtPath:self.filePath
+                                                contents:[NSMutableData dataWithLength:fileLength]
+                                              attributes:nil];
+    }
+}
+
+- (BOOL)isLegacyIndexFile {
+    NSData *data = [NSData dataWithContentsOfFile:self.indexFilePath];
+    return [NSJSONSerialization JSONObjectWithData:data options:0 error:NULL] != nil;
+}
+
+
+#pragma mark - Round Trip
+
+- (void)testIndexRoundTrip {
+    NSArray<NSValue *> *ranges = nil;
+    @autoreleasepool {
+        JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+        ranges = [self storeFragmentsToCacheFile:cacheFile];
+        XCTAssertEqualObjects(cacheFile.fragmentRanges, ranges);
+    }
+
+    NSData *indexData = [NSData dataWithContentsOfFile:self.indexFilePath];
+    XCTAssertGreaterThanOrEqual(indexData.length, 4);
+    XCTAssertEqual(memcmp(indexData.bytes, "JPVI", 4), 0);
+
+    JPVideoPlayerCacheFile *cacheFile = [self openCacheFile];
+    XCTAssertEqual(cacheFile.fileLength, kJPTestFileLength);
+    XCTAssertEqualObjects(cacheFile.fragmentRanges, ranges);
+    XCTAssertEqualObjects(cacheFile.responseHeaders[@"Content-Type"], @"video/mp4");
+    XCTAssertFalse(cacheFile.isCompleted);
+}
+
+- (void)testIndexRoundTripWithManyRanges {
+    NSMutableArray<NSValue *> *ranges = [NSMutableArray array];
+    @autoreleasepool {
+        JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+        // more ranges than the journal hold, the index file is rewritten on the way.
+        for (NSUInteger i = 0; i < 1000; i++) {
+            NSRange range = NSMakeRange(i * 4096, 1024);
+            [self storeVideoDataInRange:range toCacheFile:cacheFile synchronize:YES];
+            [ranges addObject:[NSValue valueWithRange:range]];
+        }
+    }
+
+    JPVideoPlayerCacheFile *cacheFile = [self openCacheFile];
+    XCTAssertEqualObjects(cacheFile.fragmentRanges, ranges);
+}
+
+- (void)testCompletedCacheFileRoundTrip {
+    @autoreleasepool {
+        JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+        [self storeVideoDataInRange:NSMakeRange(0, kJPTestFileLength) toCacheFile:cacheFile synchronize:YES];
+        XCTAssertTrue(cacheFile.isCompleted);
+    }
+
+    JPVideoPlayerCacheFile *cacheFile = [self openCacheFile];
+    XCTAssertTrue(cacheFile.isCompleted);
+    XCTAssertEqualObjects([cacheFile dataWithRange:NSMakeRange(1000, 1000)], [self videoDataInRange:NSMakeRange(1000, 1000)]);
+}
+
+
+#pragma mark - Journal
+
+- (void)testJournalAppendedBetweenIndexRewrites {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+    NSData *indexData = [NSData dataWithContentsOfFile:self.indexFilePath];
+    [self storeFragmentsToCacheFile:cacheFile];
+
+    // the new ranges are appended to the journal, the index file is not rewritten.
+    XCTAssertEqualObjects([NSData dataWithContentsOfFile:self.indexFilePath], indexData);
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:cacheFile.journalFilePath error:NULL];
+    XCTAssertGreaterThan(attributes.fileSize, 0);
+}
+
+- (void)testStoreSameResponseKeepIndexFile {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+    [self storeFragmentsToCacheFile:cacheFile];
+    NSData *indexData = [NSData dataWithContentsOfFile:self.indexFilePath];
+
+    // the response of every web task is stored, the same one must not rewrite the index file.
+    XCTAssertTrue([cacheFile storeResponse:[self responseWithFileLength:kJPTestFileLength]]);
+    XCTAssertEqualObjects([NSData dataWithContentsOfFile:self.indexFilePath], indexData);
+}
+
+- (void)testTornJournalTailIsDropped {
+    NSArray<NSValue *> *ranges = nil;
+    NSString *journalFilePath = nil;
+    @autoreleasepool {
+        JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+        ranges = [self storeFragmentsToCacheFile:cacheFile];
+        journalFilePath = cacheFile.journalFilePath;
+    }
+
+    // a record half written when the app killed.
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingAtPath:journalFilePath];
+    [fileHandle seekToEndOfFile];
+    [fileHandle writeData:[@"torn record" dataUsingEncoding:NSUTF8StringEncoding]];
+    [fileHandle closeFile];
+
+    JPVideoPlayerCacheFile *cacheFile = [self openCacheFile];
+    XCTAssertEqualObjects(cacheFile.fragmentRanges, ranges);
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:journalFilePath error:NULL];
+    XCTAssertEqual(attributes.fileSize % 24, 0);
+}
+
+- (void)testBrokenIndexRecoveredFromJournal {
+    NSArray<NSValue *> *ranges = nil;
+    @autoreleasepool {
+        JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+        ranges = [self storeFragmentsToCacheFile:cacheFile];
+    }
+
+    // flip a byte of the index file, the checksum mismatch.
+    NSMutableData *indexData = [NSMutableData dataWithContentsOfFile:self.indexFilePath];
+    ((uint8_t *)indexData.mutableBytes)[8] ^= 0xFF;
+    XCTAssertTrue([indexData writeToFile:self.indexFilePath atomically:YES]);
+
+    JPVideoPlayerCacheFile *cacheFile = [self openCacheFile];
+    XCTAssertEqual(cacheFile.fileLength, kJPTestFileLength);
+    XCTAssertEqualObjects(cacheFile.fragmentRanges, ranges);
+}
+
+- (void)testBrokenIndexWithoutJournalResetCache {
+    @autoreleasepool {
+        JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+        [self storeFragmentsToCacheFile:cacheFile];
+        [[NSFileManager defaultManager] removeItemAtPath:cacheFile.journalFilePath error:NULL];
+    }
+    XCTAssertTrue([[@"broken" dataUsingEncoding:NSUTF8StringEncoding] writeToFile:self.indexFilePath atomically:YES]);
+
+    JPVideoPlayerCacheFile *cacheFile = [self openCacheFile];
+    XCTAssertFalse(cacheFile.isFileLengthValid);
+    XCTAssertEqual(cacheFile.fragmentRanges.count, 0);
+}
+
+
+#pragma mark - Legacy Index
+
+- (void)testUpgradeLegacyIndexFile {
+    [self writeLegacyIndexWithFileLength:1000 ranges:@[@"{0, 100}", @"{200, 50}"]];
+    XCTAssertTrue([JPVideoPlayerCacheFile upgradeLegacyIndexFileAtPath:self.indexFilePath]);
+    XCTAssertFalse([self isLegacyIndexFile]);
+    // the binary index file is not upgraded again.
+    XCTAssertFalse([JPVideoPlayerCacheFile upgradeLegacyIndexFileAtPath:self.indexFilePath]);
+
+    JPVideoPlayerCacheFile *cacheFile = [self openCacheFile];
+    XCTAssertEqual(cacheFile.fileLength, 1000);
+    XCTAssertEqualObjects(cacheFile.fragmentRanges, (@[[NSValue valueWithRange:NSMakeRange(0, 100)],
+                                                       [NSValue valueWithRange:NSMakeRange(200, 50)]]));
+    XCTAssertEqualObjects(cacheFile.responseHeaders[@"Content-Type"], @"video/mp4");
+}
+
+- (void)testOpenLegacyIndexFile {
+    [self writeLegacyIndexWithFileLength:1000 ranges:@[@"{200, 50}", @"{0, 100}", @"{50, 100}"]];
+
+    JPVideoPlayerCacheFile *cacheFile = [self openCacheFile];
+    XCTAssertEqual(cacheFile.fileLength, 1000);
+    XCTAssertEqualObjects(cacheFile.fragmentRanges, (@[[NSValue valueWithRange:NSMakeRange(0, 150)],
+                                                       [NSValue valueWithRange:NSMakeRange(200, 50)]]));
+    // the cache file upgrade the index file by itself.
+    XCTAssertFalse([self isLegacyIndexFile]);
+}
+
+- (void)testUpgradeSkipOpenedIndexFile {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:1000];
+    [self writeLegacyIndexWithFileLength:1000 ranges:@[@"{0, 100}"]];
+
+    XCTAssertFalse([JPVideoPlayerCacheFile upgradeLegacyIndexFileAtPath:self.indexFilePath]);
+    XCTAssertTrue([self isLegacyIndexFile]);
+    XCTAssertEqual(cacheFile.fragmentRanges.count, 0);
+}
+
+- (void)testUpgradeInvalidIndexFile {
+    XCTAssertFalse([JPVideoPlayerCacheFile upgradeLegacyIndexFileAtPath:self.indexFilePath]);
+    XCTAssertTrue([[@"{\"com.newpan.size.key.www\" : 0}" dataUsingEncoding:NSUTF8StringEncoding] writeToFile:self.indexFilePath atomically:YES]);
+    XCTAssertFalse([JPVideoPlayerCacheFile upgradeLegacyIndexFileAtPath:self.indexFilePath]);
+}
+
+
+#pragma mark - Benchmark
+
+- (void)testOpenPerformanceWithManyRanges {
+    @autoreleasepool {
+        JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+        for (NSUInteger i = 0; i < 1000; i++) {
+            [self storeVideoDataInRange:NSMakeRange(i * 4096, 1024) toCacheFile:cacheFile synchronize:NO];
+        }
+        [cacheFile synchronize];
+    }
+
+    [self measureBlock:^{
+        @autoreleasepool {
+            JPVideoPlayerCacheFile *cacheFile = [self openCacheFile];
+            XCTAssertEqual(cacheFile.fragmentRanges.count, 1000);
+        }
+    }];
+}
+
+@end
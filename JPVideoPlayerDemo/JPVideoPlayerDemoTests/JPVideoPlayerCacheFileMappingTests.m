@@ -0,0 +1,99 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerCacheFileTestCase.h"
+
+static const NSUInteger kJPTestFileLength = 16 * 1024 * 1024;
+static const NSUInteger kJPTestReadLength = 256 * 1024;
+
+@interface JPVideoPlayerCacheFileMappingTests : JPVideoPlayerCacheFileTestCase
+
+@end
+
+@implementation JPVideoPlayerCacheFileMappingTests
+
+- (JPVideoPlayerCacheFile *)completedCacheFile {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+    [self storeVideoDataInRange:NSMakeRange(0, kJPTestFileLength) toCacheFile:cacheFile synchronize:YES];
+    XCTAssertTrue(cacheFile.isCompleted);
+    return cacheFile;
+}
+
+- (void)readWholeCacheFile:(JPVideoPlayerCacheFile *)cacheFile {
+    for (NSUInteger offset = 0; offset + kJPTestReadLength <= kJPTestFileLength; offset += kJPTestReadLength) {
+        @autoreleasepool {
+            NSData *data = [cacheFile dataWithRange:NSMakeRange(offset, kJPTestReadLength)];
+            XCTAssertEqual(data.length, kJPTestReadLength);
+        }
+    }
+}
+
+
+#pragma mark - Mapping
+
+- (void)testCompletedCacheFileReadFromMapping {
+    JPVideoPlayerCacheFile *cacheFile = [self completedCacheFile];
+    NSRange range = NSMakeRange(3 * 1024 * 1024 + 7, kJPTestReadLength);
+    NSData *data = [cacheFile dataWithRange:range];
+    XCTAssertEqualObjects(data, [self videoDataInRange:range]);
+
+    // the data is a view over the mapping, no bytes copied.
+    NSData *otherData = [cacheFile dataWithRange:range];
+    XCTAssertEqual(data.bytes, otherData.bytes);
+    NSData *headData = [cacheFile dataWithRange:NSMakeRange(0, 1)];
+    XCTAssertEqual((const uint8_t *)headData.bytes + range.location, (const uint8_t *)data.bytes);
+}
+
+- (void)testMappedDataOutliveCacheFile {
+    NSData *data = nil;
+    NSRange range = NSMakeRange(kJPTestFileLength - kJPTestReadLength, kJPTestReadLength);
+    @autoreleasepool {
+        JPVideoPlayerCacheFile *cacheFile = [self completedCacheFile];
+        data = [cacheFile dataWithRange:range];
+        [cacheFile removeCache];
+    }
+
+    // the mapping is kept alive by the data.
+    XCTAssertEqualObjects(data, [self videoDataInRange:range]);
+}
+
+- (void)testNotCompletedCacheFileNotMapped {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+    [self storeVideoDataInRange:NSMakeRange(0, kJPTestFileLength - 1) toCacheFile:cacheFile synchronize:YES];
+    XCTAssertFalse(cacheFile.isCompleted);
+
+    NSRange range = NSMakeRange(1024, 1024);
+    NSData *data = [cacheFile dataWithRange:range];
+    XCTAssertEqualObjects(data, [self videoDataInRange:range]);
+    XCTAssertNotEqual(data.bytes, [cacheFile dataWithRange:range].bytes);
+}
+
+
+#pragma mark - Benchmark
+
+- (void)testMappedReadPerformance {
+    JPVideoPlayerCacheFile *cacheFile = [self completedCacheFile];
+    [self measureBlock:^{
+        [self readWholeCacheFile:cacheFile];
+    }];
+}
+
+- (void)testPositionalReadPerformance {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength + 1];
+    // leave the last byte not cached, so the reads take the positional read path.
+    [self storeVideoDataInRange:NSMakeRange(0, kJPTestFileLength) toCacheFile:cacheFile synchronize:YES];
+    XCTAssertFalse(cacheFile.isCompleted);
+    [self measureBlock:^{
+        [self readWholeCacheFile:cacheFile];
+    }];
+}
+
+@end
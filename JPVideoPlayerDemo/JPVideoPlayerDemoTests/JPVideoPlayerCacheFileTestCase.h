@@ -0,0 +1,90 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import <XCTest/XCTest.h>
+#import "JPVideoPlayerCacheFile.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Fetch the video data in given range, every byte is derived from its position,
+ * so the data read back can be checked against it.
+ *
+ * @param range A range of video file.
+ *
+ * @return The video data.
+ */
+FOUNDATION_EXTERN NSData *JPVideoPlayerTestVideoData(NSRange range);
+
+/**
+ * The base class of the tests of `JPVideoPlayerCacheFile`, every test has its own cache directory,
+ * which is removed when the test finished.
+ */
+@interface JPVideoPlayerCacheFileTestCase : XCTestCase
+
+/**
+ * The video data file path of the cache file.
+ */
+@property (nonatomic, copy, readonly) NSString *filePath;
+
+/**
+ * The index file path of the cache file.
+ */
+@property (nonatomic, copy, readonly) NSString *indexFilePath;
+
+/**
+ * Open the cache file at `filePath`, the video data file is created if not exist.
+ *
+ * @return A instance of `JPVideoPlayerCacheFile`.
+ */
+- (JPVideoPlayerCacheFile *)openCacheFile;
+
+/**
+ * Open the cache file and store a response of given file length.
+ *
+ * @param fileLength The length of video.
+ *
+ * @return A instance of `JPVideoPlayerCacheFile`.
+ */
+- (JPVideoPlayerCacheFile *)cacheFileWithFileLength:(NSUInteger)fileLength;
+
+/**
+ * Fetch a response of a range request to a video of given length.
+ *
+ * @param fileLength The length of video.
+ *
+ * @return A response.
+ */
+- (NSHTTPURLResponse *)responseWithFileLength:(NSUInteger)fileLength;
+
+/**
+ * Fetch the video data in given range, same as `JPVideoPlayerTestVideoData`.
+ *
+ * @param range A range of video file.
+ *
+ * @return The video data.
+ */
+- (NSData *)videoDataInRange:(NSRange)range;
+
+/**
+ * Store the video data in given range to cache file, and assert no write failed.
+ *
+ * @param range       A range of video file.
+ * @param cacheFile   The cache file.
+ * @param synchronize A flag indicator store index to index file synchronize or not.
+ */
+- (void)storeVideoDataInRange:(NSRange)range
+                  toCacheFile:(JPVideoPlayerCacheFile *)cacheFile
+                  synchronize:(BOOL)synchronize;
+
+@end
+
+NS_ASSUME_NONNULL_END
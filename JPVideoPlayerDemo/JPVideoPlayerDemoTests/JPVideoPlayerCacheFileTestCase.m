@@ -0,0 +1,96 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerCacheFileTestCase.h"
+
+NSData *JPVideoPlayerTestVideoData(NSRange range) {
+    NSMutableData *data = [NSMutableData dataWithLength:range.length];
+    uint8_t *bytes = data.mutableBytes;
+    for (NSUInteger i = 0; i < range.length; i++) {
+        NSUInteger position = range.location + i;
+        bytes[i] = (uint8_t)(position ^ (position >> 8) ^ (position >> 16));
+    }
+    return data;
+}
+
+@interface JPVideoPlayerCacheFileTestCase()
+
+@property (nonatomic, copy) NSString *directoryPath;
+
+@property (nonatomic, copy) NSString *filePath;
+
+@property (nonatomic, copy) NSString *indexFilePath;
+
+@end
+
+@implementation JPVideoPlayerCacheFileTestCase
+
+- (void)setUp {
+    [super setUp];
+    self.directoryPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+    [[NSFileManager defaultManager] createDirectoryAtPath:self.directoryPath
+                              withIntermediateDirectories:YES
+                                               attributes:nil
+                                                    error:NULL];
+    self.filePath = [self.directoryPath stringByAppendingPathComponent:@"video.mp4"];
+    self.indexFilePath = [self.directoryPath stringByAppendingPathComponent:@"video.index"];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:self.directoryPath error:NULL];
+    [super tearDown];
+}
+
+- (JPVideoPlayerCacheFile *)openCacheFile {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    if (![fileManager fileExistsAtPath:self.filePath]) {
+        [fileManager createFileAtPath:self.filePath contents:nil attributes:nil];
+    }
+    JPVideoPlayerCacheFile *cacheFile = [JPVideoPlayerCacheFile cacheFileWithFilePath:self.filePath
+                                                                        indexFilePath:self.indexFilePath];
+    XCTAssertNotNil(cacheFile);
+    return cacheFile;
+}
+
+- (JPVideoPlayerCacheFile *)cacheFileWithFileLength:(NSUInteger)fileLength {
+    JPVideoPlayerCacheFile *cacheFile = [self openCacheFile];
+    XCTAssertTrue([cacheFile storeResponse:[self responseWithFileLength:fileLength]]);
+    XCTAssertEqual(cacheFile.fileLength, fileLength);
+    return cacheFile;
+}
+
+- (NSHTTPURLResponse *)responseWithFileLength:(NSUInteger)fileLength {
+    NSDictionary *headers = @{
+            @"Content-Type" : @"video/mp4",
+            @"Content-Range" : [NSString stringWithFormat:@"bytes 0-1/%tu", fileLength],
+    };
+    return [[NSHTTPURLResponse alloc] initWithURL:[NSURL URLWithString:@"http://www.example.com/video.mp4"]
+                                       statusCode:206
+                                      HTTPVersion:@"HTTP/1.1"
+                                     headerFields:headers];
+}
+
+- (NSData *)videoDataInRange:(NSRange)range {
+    return JPVideoPlayerTestVideoData(range);
+}
+
+- (void)storeVideoDataInRange:(NSRange)range
+                  toCacheFile:(JPVideoPlayerCacheFile *)cacheFile
+                  synchronize:(BOOL)synchronize {
+    [cacheFile storeVideoData:[self videoDataInRange:range]
+                     atOffset:range.location
+                  synchronize:synchronize
+             storedCompletion:^(NSError *error) {
+                 XCTAssertNil(error);
+             }];
+}
+
+@end
@@ -0,0 +1,202 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import <XCTest/XCTest.h>
+#import "JPVideoPlayerMP4BoxWalker.h"
+#import "JPVideoPlayerCompat.h"
+
+static const NSUInteger kJPTestFtypLength = 24;
+
+@interface JPVideoPlayerMP4BoxWalkerTests : XCTestCase
+
+@end
+
+static void JPAppendUInt32BigEndian(NSMutableData *data, uint32_t value) {
+    uint32_t bigEndian = CFSwapInt32HostToBig(value);
+    [data appendBytes:&bigEndian length:sizeof(uint32_t)];
+}
+
+/**
+ * Append the header of a box, the payload is not appended.
+ */
+static void JPAppendBoxHeader(NSMutableData *data, uint32_t size, const char *type) {
+    JPAppendUInt32BigEndian(data, size);
+    [data appendBytes:type length:4];
+}
+
+/**
+ * Append the header of a box with 64-bit size.
+ */
+static void JPAppendLargeBoxHeader(NSMutableData *data, uint64_t size, const char *type) {
+    JPAppendBoxHeader(data, 1, type);
+    JPAppendUInt32BigEndian(data, (uint32_t)(size >> 32));
+    JPAppendUInt32BigEndian(data, (uint32_t)size);
+}
+
+/**
+ * Append a `ftyp` box of `kJPTestFtypLength` bytes.
+ */
+static void JPAppendFtypBox(NSMutableData *data) {
+    JPAppendBoxHeader(data, kJPTestFtypLength, "ftyp");
+    [data appendBytes:"isom\0\0\0\1isomavc1" length:kJPTestFtypLength - 8];
+}
+
+@implementation JPVideoPlayerMP4BoxWalkerTests
+
+#pragma mark - Walk
+
+- (void)testFindMoovAtStart {
+    NSMutableData *data = [NSMutableData data];
+    JPAppendFtypBox(data);
+    JPAppendBoxHeader(data, 1000, "moov");
+    JPVideoPlayerMP4BoxWalker *walker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:100 * 1000];
+    [walker appendData:data atOffset:0];
+
+    XCTAssertTrue(walker.isFinished);
+    XCTAssertTrue(NSEqualRanges(walker.moovRange, NSMakeRange(kJPTestFtypLength, 1000)));
+}
+
+- (void)testJumpOverLargeMdatToMoovAtEnd {
+    // a mdat larger than 4 GB need the 64-bit size.
+    uint64_t mdatLength = 0x100000000ULL + 16;
+    NSUInteger moovOffset = (NSUInteger)(kJPTestFtypLength + mdatLength);
+    NSUInteger fileLength = moovOffset + 1000;
+    NSMutableData *data = [NSMutableData data];
+    JPAppendFtypBox(data);
+    JPAppendLargeBoxHeader(data, mdatLength, "mdat");
+    JPVideoPlayerMP4BoxWalker *walker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:fileLength];
+    [walker appendData:data atOffset:0];
+    XCTAssertFalse(walker.isFinished);
+    XCTAssertEqual(walker.nextBoxOffset, moovOffset);
+    XCTAssertFalse(JPValidFileRange(walker.moovRange));
+
+    NSMutableData *moovData = [NSMutableData data];
+    JPAppendBoxHeader(moovData, 1000, "moov");
+    [walker appendData:moovData atOffset:moovOffset];
+    XCTAssertTrue(walker.isFinished);
+    XCTAssertTrue(NSEqualRanges(walker.moovRange, NSMakeRange(moovOffset, 1000)));
+}
+
+- (void)testMoovOfSizeZeroRunToEndOfFile {
+    NSMutableData *data = [NSMutableData data];
+    JPAppendFtypBox(data);
+    JPAppendBoxHeader(data, 0, "moov");
+    JPVideoPlayerMP4BoxWalker *walker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:5000];
+    [walker appendData:data atOffset:0];
+    XCTAssertTrue(NSEqualRanges(walker.moovRange, NSMakeRange(kJPTestFtypLength, 5000 - kJPTestFtypLength)));
+}
+
+- (void)testFinishAtEndOfFileWithoutMoov {
+    NSMutableData *data = [NSMutableData data];
+    JPAppendFtypBox(data);
+    JPAppendBoxHeader(data, 0, "mdat");
+    JPVideoPlayerMP4BoxWalker *walker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:5000];
+    [walker appendData:data atOffset:0];
+    XCTAssertTrue(walker.isFinished);
+    XCTAssertEqual(walker.nextBoxOffset, 5000);
+    XCTAssertFalse(JPValidFileRange(walker.moovRange));
+}
+
+
+#pragma mark - Partial Data
+
+- (void)testSplitHeaderMakeNoProgress {
+    NSMutableData *data = [NSMutableData data];
+    JPAppendFtypBox(data);
+    JPAppendBoxHeader(data, 1000, "moov");
+    JPVideoPlayerMP4BoxWalker *walker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:5000];
+    [walker appendData:[data subdataWithRange:NSMakeRange(0, kJPTestFtypLength + 4)] atOffset:0];
+    XCTAssertFalse(walker.isFinished);
+    XCTAssertEqual(walker.nextBoxOffset, kJPTestFtypLength);
+
+    [walker appendData:[data subdataWithRange:NSMakeRange(kJPTestFtypLength, 8)] atOffset:kJPTestFtypLength];
+    XCTAssertTrue(NSEqualRanges(walker.moovRange, NSMakeRange(kJPTestFtypLength, 1000)));
+}
+
+- (void)testSplitLargeHeaderMakeNoProgress {
+    NSMutableData *data = [NSMutableData data];
+    JPAppendFtypBox(data);
+    JPAppendLargeBoxHeader(data, 1000, "mdat");
+    JPVideoPlayerMP4BoxWalker *walker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:5000];
+    [walker appendData:[data subdataWithRange:NSMakeRange(0, kJPTestFtypLength + 12)] atOffset:0];
+    XCTAssertFalse(walker.isFinished);
+    XCTAssertEqual(walker.nextBoxOffset, kJPTestFtypLength);
+
+    [walker appendData:[data subdataWithRange:NSMakeRange(kJPTestFtypLength, 16)] atOffset:kJPTestFtypLength];
+    XCTAssertEqual(walker.nextBoxOffset, kJPTestFtypLength + 1000);
+}
+
+- (void)testDataAfterNextBoxOffsetIgnored {
+    NSMutableData *data = [NSMutableData data];
+    JPAppendBoxHeader(data, 1000, "moov");
+    JPVideoPlayerMP4BoxWalker *walker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:5000];
+    [walker appendData:data atOffset:100];
+    XCTAssertFalse(walker.isFinished);
+    XCTAssertEqual(walker.nextBoxOffset, 0);
+}
+
+
+#pragma mark - Invalid File
+
+- (void)testFirstBoxMustBeFtyp {
+    NSMutableData *data = [NSMutableData data];
+    JPAppendBoxHeader(data, 1000, "moov");
+    JPVideoPlayerMP4BoxWalker *walker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:5000];
+    [walker appendData:data atOffset:0];
+    XCTAssertTrue(walker.isFinished);
+    XCTAssertFalse(JPValidFileRange(walker.moovRange));
+}
+
+- (void)testTruncatedBoxFinishWalk {
+    NSMutableData *data = [NSMutableData data];
+    JPAppendFtypBox(data);
+    JPAppendBoxHeader(data, 10000, "mdat");
+    JPVideoPlayerMP4BoxWalker *walker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:5000];
+    [walker appendData:data atOffset:0];
+    XCTAssertTrue(walker.isFinished);
+    XCTAssertFalse(JPValidFileRange(walker.moovRange));
+}
+
+- (void)testTruncatedLargeBoxFinishWalk {
+    NSMutableData *data = [NSMutableData data];
+    JPAppendFtypBox(data);
+    JPAppendLargeBoxHeader(data, 0x100000000ULL, "mdat");
+    JPVideoPlayerMP4BoxWalker *walker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:5000];
+    [walker appendData:data atOffset:0];
+    XCTAssertTrue(walker.isFinished);
+    XCTAssertFalse(JPValidFileRange(walker.moovRange));
+}
+
+- (void)testBoxSmallerThanHeaderFinishWalk {
+    NSMutableData *data = [NSMutableData data];
+    JPAppendFtypBox(data);
+    JPAppendBoxHeader(data, 4, "free");
+    JPVideoPlayerMP4BoxWalker *walker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:5000];
+    [walker appendData:data atOffset:0];
+    XCTAssertTrue(walker.isFinished);
+    XCTAssertEqual(walker.nextBoxOffset, kJPTestFtypLength);
+
+    // a large box smaller than its 16 bytes header.
+    data = [NSMutableData data];
+    JPAppendFtypBox(data);
+    JPAppendLargeBoxHeader(data, 12, "free");
+    walker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:5000];
+    [walker appendData:data atOffset:0];
+    XCTAssertTrue(walker.isFinished);
+}
+
+- (void)testFileShorterThanHeader {
+    JPVideoPlayerMP4BoxWalker *walker = [[JPVideoPlayerMP4BoxWalker alloc] initWithFileLength:7];
+    XCTAssertTrue(walker.isFinished);
+    XCTAssertFalse(JPValidFileRange(walker.moovRange));
+}
+
+@end
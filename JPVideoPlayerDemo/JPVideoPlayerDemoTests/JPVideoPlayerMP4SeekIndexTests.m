@@ -0,0 +1,269 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import <XCTest/XCTest.h>
+#import "JPVideoPlayerMP4SeekIndex.h"
+#import "JPVideoPlayerCompat.h"
+
+/**
+ * The test video is 10 seconds, chunk i of video start at `10000 + i * 20000` and the chunk i of audio follow it.
+ * The video track has 100 samples of 100 ms and 1000 bytes, 10 samples per chunk, a sync sample every 10 samples.
+ * The audio track has 50 samples of 200 ms and 500 bytes, 5 samples per chunk.
+ */
+static const uint32_t kJPTestTimescale = 1000;
+static const uint32_t kJPTestChunkCount = 10;
+static const uint64_t kJPTestVideoChunkOffset = 10000;
+static const uint64_t kJPTestAudioChunkOffset = 20000;
+static const uint64_t kJPTestChunkStride = 20000;
+static const uint64_t kJPTestLargeOffset = 0x140000000ULL;
+
+@interface JPVideoPlayerMP4SeekIndexTests : XCTestCase
+
+@end
+
+static void JPAppendUInt32(NSMutableData *data, uint32_t value) {
+    uint32_t bigEndian = CFSwapInt32HostToBig(value);
+    [data appendBytes:&bigEndian length:sizeof(uint32_t)];
+}
+
+static void JPAppendUInt64(NSMutableData *data, uint64_t value) {
+    JPAppendUInt32(data, (uint32_t)(value >> 32));
+    JPAppendUInt32(data, (uint32_t)value);
+}
+
+static NSData *JPBox(const char *type, NSData *payload) {
+    NSMutableData *box = [NSMutableData data];
+    JPAppendUInt32(box, (uint32_t)(8 + payload.length));
+    [box appendBytes:type length:4];
+    [box appendData:payload];
+    return box;
+}
+
+static NSData *JPContainerBox(const char *type, NSArray<NSData *> *children) {
+    NSMutableData *payload = [NSMutableData data];
+    for (NSData *child in children) {
+        [payload appendData:child];
+    }
+    return JPBox(type, payload);
+}
+
+/**
+ * A full box payload start with version and flags.
+ */
+static NSMutableData *JPFullBoxPayload(uint8_t version) {
+    NSMutableData *payload = [NSMutableData data];
+    JPAppendUInt32(payload, (uint32_t)version << 24);
+    return payload;
+}
+
+static NSData *JPMdhdBox(uint8_t version, uint32_t timescale, uint64_t duration) {
+    NSMutableData *payload = JPFullBoxPayload(version);
+    if (version == 1) {
+        JPAppendUInt64(payload, 0);
+        JPAppendUInt64(payload, 0);
+        JPAppendUInt32(payload, timescale);
+        JPAppendUInt64(payload, duration);
+    }
+    else {
+        JPAppendUInt32(payload, 0);
+        JPAppendUInt32(payload, 0);
+        JPAppendUInt32(payload, timescale);
+        JPAppendUInt32(payload, (uint32_t)duration);
+    }
+    JPAppendUInt32(payload, 0);
+    return JPBox("mdhd", payload);
+}
+
+static NSData *JPHdlrBox(const char *handlerType) {
+    NSMutableData *payload = JPFullBoxPayload(0);
+    JPAppendUInt32(payload, 0);
+    [payload appendBytes:handlerType length:4];
+    [payload appendData:[NSMutableData dataWithLength:13]];
+    return JPBox("hdlr", payload);
+}
+
+static NSData *JPSttsBox(uint32_t sampleCount, uint32_t sampleDelta) {
+    NSMutableData *payload = JPFullBoxPayload(0);
+    JPAppendUInt32(payload, 1);
+    JPAppendUInt32(payload, sampleCount);
+    JPAppendUInt32(payload, sampleDelta);
+    return JPBox("stts", payload);
+}
+
+static NSData *JPStscBox(uint32_t samplesPerChunk) {
+    NSMutableData *payload = JPFullBoxPayload(0);
+    JPAppendUInt32(payload, 1);
+    JPAppendUInt32(payload, 1);
+    JPAppendUInt32(payload, samplesPerChunk);
+    JPAppendUInt32(payload, 1);
+    return JPBox("stsc", payload);
+}
+
+/**
+ * A `stsz` box list the size of every sample, instead of a constant size.
+ */
+static NSData *JPStszBox(uint32_t sampleCount, uint32_t sampleSize) {
+    NSMutableData *payload = JPFullBoxPayload(0);
+    JPAppendUInt32(payload, 0);
+    JPAppendUInt32(payload, sampleCount);
+    for (uint32_t i = 0; i < sampleCount; i++) {
+        JPAppendUInt32(payload, sampleSize);
+    }
+    return JPBox("stsz", payload);
+}
+
+static NSData *JPChunkOffsetBox(uint64_t firstChunkOffset, BOOL largeOffset) {
+    NSMutableData *payload = JPFullBoxPayload(0);
+    JPAppendUInt32(payload, kJPTestChunkCount);
+    for (uint32_t i = 0; i < kJPTestChunkCount; i++) {
+        uint64_t offset = firstChunkOffset + i * kJPTestChunkStride;
+        if (largeOffset) {
+            JPAppendUInt64(payload, offset);
+        }
+        else {
+            JPAppendUInt32(payload, (uint32_t)offset);
+        }
+    }
+    return JPBox(largeOffset ? "co64" : "stco", payload);
+}
+
+static NSData *JPStssBox(uint32_t sampleCount, uint32_t interval) {
+    NSMutableData *payload = JPFullBoxPayload(0);
+    JPAppendUInt32(payload, sampleCount / interval);
+    for (uint32_t i = 0; i < sampleCount; i += interval) {
+        // the sample numbers start from 1.
+        JPAppendUInt32(payload, i + 1);
+    }
+    return JPBox("stss", payload);
+}
+
+static NSData *JPTrakBox(const char *handlerType, uint8_t mdhdVersion, NSArray<NSData *> *stblChildren) {
+    NSData *stbl = JPContainerBox("stbl", stblChildren);
+    NSData *minf = JPContainerBox("minf", @[stbl]);
+    NSData *mdia = JPContainerBox("mdia", @[JPMdhdBox(mdhdVersion, kJPTestTimescale, 10 * kJPTestTimescale),
+                                            JPHdlrBox(handlerType),
+                                            minf]);
+    return JPContainerBox("trak", @[JPBox("tkhd", [NSMutableData dataWithLength:84]), mdia]);
+}
+
+static NSData *JPVideoTrakBox(uint64_t firstChunkOffset, BOOL largeOffset) {
+    return JPTrakBox("vide", 0, @[JPSttsBox(100, 100),
+                                  JPStssBox(100, 10),
+                                  JPStscBox(10),
+                                  JPStszBox(100, 1000),
+                                  JPChunkOffsetBox(firstChunkOffset, largeOffset)]);
+}
+
+static NSData *JPAudioTrakBox(void) {
+    // a constant sample size in `stsz`, and the version 1 of `mdhd`.
+    NSMutableData *stszPayload = JPFullBoxPayload(0);
+    JPAppendUInt32(stszPayload, 500);
+    JPAppendUInt32(stszPayload, 50);
+    return JPTrakBox("soun", 1, @[JPSttsBox(50, 200),
+                                  JPStscBox(5),
+                                  JPBox("stsz", stszPayload),
+                                  JPChunkOffsetBox(kJPTestAudioChunkOffset, NO)]);
+}
+
+@implementation JPVideoPlayerMP4SeekIndexTests
+
+- (void)assertRange:(NSRange)range
+         equalRange:(NSRange)expectedRange {
+    XCTAssertTrue(NSEqualRanges(range, expectedRange), @"%@ is not %@", NSStringFromRange(range), NSStringFromRange(expectedRange));
+}
+
+
+#pragma mark - Lookup
+
+- (void)testDurationOfLongestTrack {
+    JPVideoPlayerMP4SeekIndex *seekIndex = [JPVideoPlayerMP4SeekIndex seekIndexWithMoovData:JPContainerBox("moov", @[JPBox("mvhd", [NSMutableData dataWithLength:100]),
+                                                                                                                   JPVideoTrakBox(kJPTestVideoChunkOffset, NO),
+                                                                                                                   JPAudioTrakBox()])];
+    XCTAssertNotNil(seekIndex);
+    XCTAssertEqualWithAccuracy(seekIndex.duration, 10, 0.001);
+}
+
+- (void)testRangeCoverAllTracks {
+    JPVideoPlayerMP4SeekIndex *seekIndex = [JPVideoPlayerMP4SeekIndex seekIndexWithMoovData:JPContainerBox("moov", @[JPVideoTrakBox(kJPTestVideoChunkOffset, NO),
+                                                                                                                   JPAudioTrakBox()])];
+    // video sample 50 is the first sample of chunk 5, audio sample 25 is the first sample of chunk 5.
+    [self assertRange:[seekIndex byteRangeForTime:5.05 window:0]
+           equalRange:NSMakeRange(110000, 120500 - 110000)];
+}
+
+- (void)testStartSnapToSyncSample {
+    JPVideoPlayerMP4SeekIndex *seekIndex = [JPVideoPlayerMP4SeekIndex seekIndexWithMoovData:JPContainerBox("moov", @[JPVideoTrakBox(kJPTestVideoChunkOffset, NO)])];
+    // sample 55, the decoding start from the sync sample 50.
+    [self assertRange:[seekIndex byteRangeForTime:5.55 window:0]
+           equalRange:NSMakeRange(110000, 6000)];
+}
+
+- (void)testWindowAroundTime {
+    JPVideoPlayerMP4SeekIndex *seekIndex = [JPVideoPlayerMP4SeekIndex seekIndexWithMoovData:JPContainerBox("moov", @[JPVideoTrakBox(kJPTestVideoChunkOffset, NO)])];
+    // from sample 40 in chunk 4 to sample 60 in chunk 6.
+    [self assertRange:[seekIndex byteRangeForTime:5 window:1]
+           equalRange:NSMakeRange(90000, 131000 - 90000)];
+    // the window before the start of video is clamped, from sample 0 to sample 10 in chunk 1.
+    [self assertRange:[seekIndex byteRangeForTime:0.05 window:1]
+           equalRange:NSMakeRange(kJPTestVideoChunkOffset, 31000 - kJPTestVideoChunkOffset)];
+}
+
+- (void)testLargeChunkOffsets {
+    JPVideoPlayerMP4SeekIndex *seekIndex = [JPVideoPlayerMP4SeekIndex seekIndexWithMoovData:JPContainerBox("moov", @[JPVideoTrakBox(kJPTestLargeOffset, YES)])];
+    XCTAssertNotNil(seekIndex);
+    [self assertRange:[seekIndex byteRangeForTime:5.55 window:0]
+           equalRange:NSMakeRange((NSUInteger)(kJPTestLargeOffset + 5 * kJPTestChunkStride), 6000)];
+}
+
+- (void)testTimeOutOfVideo {
+    JPVideoPlayerMP4SeekIndex *seekIndex = [JPVideoPlayerMP4SeekIndex seekIndexWithMoovData:JPContainerBox("moov", @[JPVideoTrakBox(kJPTestVideoChunkOffset, NO)])];
+    XCTAssertFalse(JPValidFileRange([seekIndex byteRangeForTime:-1 window:0]));
+    XCTAssertFalse(JPValidFileRange([seekIndex byteRangeForTime:10.5 window:0]));
+}
+
+
+#pragma mark - Invalid Moov
+
+- (void)testMoovWithoutTrack {
+    XCTAssertNil([JPVideoPlayerMP4SeekIndex seekIndexWithMoovData:JPContainerBox("moov", @[JPBox("mvhd", [NSMutableData dataWithLength:100])])]);
+    XCTAssertNil([JPVideoPlayerMP4SeekIndex seekIndexWithMoovData:[NSData data]]);
+}
+
+- (void)testSkipTrackNeitherVideoNorAudio {
+    NSData *textTrak = JPTrakBox("text", 0, @[JPSttsBox(10, 100),
+                                             JPStscBox(10),
+                                             JPStszBox(10, 100),
+                                             JPChunkOffsetBox(0, NO)]);
+    XCTAssertNil([JPVideoPlayerMP4SeekIndex seekIndexWithMoovData:JPContainerBox("moov", @[textTrak])]);
+    XCTAssertNotNil([JPVideoPlayerMP4SeekIndex seekIndexWithMoovData:JPContainerBox("moov", @[textTrak, JPAudioTrakBox()])]);
+}
+
+- (void)testTruncatedMoov {
+    NSData *moovData = JPContainerBox("moov", @[JPVideoTrakBox(kJPTestVideoChunkOffset, NO)]);
+    XCTAssertNil([JPVideoPlayerMP4SeekIndex seekIndexWithMoovData:[moovData subdataWithRange:NSMakeRange(0, moovData.length - 1)]]);
+}
+
+- (void)testSampleTableShorterThanSampleCount {
+    NSMutableData *stszPayload = JPFullBoxPayload(0);
+    JPAppendUInt32(stszPayload, 0);
+    JPAppendUInt32(stszPayload, 100);
+    // 99 entries only.
+    for (uint32_t i = 0; i < 99; i++) {
+        JPAppendUInt32(stszPayload, 1000);
+    }
+    NSData *trak = JPTrakBox("vide", 0, @[JPSttsBox(100, 100),
+                                         JPStscBox(10),
+                                         JPBox("stsz", stszPayload),
+                                         JPChunkOffsetBox(kJPTestVideoChunkOffset, NO)]);
+    XCTAssertNil([JPVideoPlayerMP4SeekIndex seekIndexWithMoovData:JPContainerBox("moov", @[trak])]);
+}
+
+@end
@@ -0,0 +1,197 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerCacheFileTestCase.h"
+#import "JPVideoPlayerTestURLProtocol.h"
+#import "JPVideoPlayerDownloader.h"
+#import "JPResourceLoadingRequestTask.h"
+
+static const NSUInteger kJPTestFileLength = 4 * 1024 * 1024;
+static const NSUInteger kJPTestBytesPerSecondPerConnection = 8 * 1024 * 1024;
+static const NSUInteger kJPTestMB = 1024 * 1024;
+
+/**
+ * The interface of the policy private to `JPVideoPlayerResourceLoader`.
+ */
+@protocol JPTestParallelDownloadPolicy<NSObject>
+
+@property (nonatomic, assign, readonly) NSUInteger connectionCount;
+
+@property (nonatomic, assign) NSUInteger maxConnectionCount;
+
+- (void)segmentDidStart;
+
+- (void)segmentDidFinishWithLength:(NSUInteger)length;
+
+@end
+
+@interface JPVideoPlayerParallelDownloadTests : JPVideoPlayerCacheFileTestCase<JPResourceLoadingRequestTaskDelegate>
+
+@property (nonatomic, strong) JPVideoPlayerDownloader *downloader;
+
+@property (nonatomic, strong) NSMapTable<JPResourceLoadingRequestTask *, XCTestExpectation *> *expectations;
+
+@end
+
+@implementation JPVideoPlayerParallelDownloadTests
+
+- (void)setUp {
+    [super setUp];
+    [JPVideoPlayerTestURLProtocol reset];
+    [JPVideoPlayerTestURLProtocol setFileLength:kJPTestFileLength];
+    [JPVideoPlayerTestURLProtocol setBytesPerSecondPerConnection:kJPTestBytesPerSecondPerConnection];
+    self.downloader = [[JPVideoPlayerDownloader alloc] initWithSessionConfiguration:[JPVideoPlayerTestURLProtocol sessionConfiguration]];
+    [self.downloader setMaxConcurrentDownloadCount:8 forPriority:JPVideoPlayerDownloadPriorityReadAhead];
+    self.expectations = [NSMapTable strongToStrongObjectsMapTable];
+}
+
+- (void)tearDown {
+    [self.downloader cancel];
+    self.downloader = nil;
+    [JPVideoPlayerTestURLProtocol reset];
+    [super tearDown];
+}
+
+- (id<JPTestParallelDownloadPolicy>)policy {
+    id<JPTestParallelDownloadPolicy> policy = [NSClassFromString(@"JPVideoPlayerParallelDownloadPolicy") new];
+    XCTAssertNotNil(policy);
+    return policy;
+}
+
+/**
+ * Download given range into cache file in `segmentCount` segments at the same time, the last segment start first.
+ */
+- (void)downloadRange:(NSRange)range
+         segmentCount:(NSUInteger)segmentCount
+          toCacheFile:(JPVideoPlayerCacheFile *)cacheFile {
+    NSUInteger segmentLength = (range.length + segmentCount - 1) / segmentCount;
+    NSMutableArray<JPResourceLoadingRequestWebTask *> *requestTasks = [NSMutableArray array];
+    for (NSUInteger start = range.location; start < NSMaxRange(range); start += segmentLength) {
+        NSRange segmentRange = NSMakeRange(start, MIN(segmentLength, NSMaxRange(range) - start));
+        JPResourceLoadingRequestWebTask *requestTask = [JPResourceLoadingRequestWebTask readAheadTaskWithRequestRange:segmentRange
+                                                                                                          cacheFile:cacheFile
+                                                                                                          customURL:[JPVideoPlayerTestURLProtocol videoURL]];
+        requestTask.internal = YES;
+        requestTask.delegate = self;
+        [self.expectations setObject:[self expectationWithDescription:NSStringFromRange(segmentRange)] forKey:requestTask];
+        [requestTasks insertObject:requestTask atIndex:0];
+    }
+    for (JPResourceLoadingRequestWebTask *requestTask in requestTasks) {
+        [self.downloader downloadVideoWithRequestTask:requestTask downloadOptions:0];
+        [requestTask start];
+    }
+    [self waitForExpectationsWithTimeout:30 handler:nil];
+    [cacheFile synchronize];
+}
+
+
+#pragma mark - JPResourceLoadingRequestTaskDelegate
+
+- (void)requestTask:(JPResourceLoadingRequestTask *)requestTask
+didCompleteWithError:(NSError *)error {
+    XCTAssertNil(error);
+    [[self.expectations objectForKey:requestTask] fulfill];
+    [self.expectations removeObjectForKey:requestTask];
+}
+
+
+#pragma mark - Policy
+
+- (void)testPolicyStartWithTwoConnections {
+    id<JPTestParallelDownloadPolicy> policy = [self policy];
+    XCTAssertEqual(policy.connectionCount, 2);
+    policy.maxConnectionCount = 1;
+    XCTAssertEqual(policy.connectionCount, 1);
+    policy.maxConnectionCount = 0;
+    XCTAssertEqual(policy.connectionCount, 1);
+}
+
+- (void)testPolicyIgnoreSegmentNotStarted {
+    id<JPTestParallelDownloadPolicy> policy = [self policy];
+    policy.maxConnectionCount = 8;
+    for (NSUInteger i = 0; i < 10; i++) {
+        [policy segmentDidFinishWithLength:kJPTestMB];
+    }
+    XCTAssertEqual(policy.connectionCount, 2);
+}
+
+- (void)testPolicyGrowWhileThroughputGrow {
+    id<JPTestParallelDownloadPolicy> policy = [self policy];
+    policy.maxConnectionCount = 8;
+    [policy segmentDidStart];
+    // every connection finish two segments for a sample, the first sample always grow.
+    [NSThread sleepForTimeInterval:0.1];
+    for (NSUInteger i = 0; i < 4; i++) {
+        [policy segmentDidFinishWithLength:kJPTestMB];
+    }
+    XCTAssertEqual(policy.connectionCount, 3);
+
+    [NSThread sleepForTimeInterval:0.01];
+    for (NSUInteger i = 0; i < 6; i++) {
+        [policy segmentDidFinishWithLength:kJPTestMB];
+    }
+    XCTAssertEqual(policy.connectionCount, 4);
+
+    // the throughput drop, back off.
+    [NSThread sleepForTimeInterval:0.5];
+    for (NSUInteger i = 0; i < 8; i++) {
+        [policy segmentDidFinishWithLength:kJPTestMB];
+    }
+    XCTAssertEqual(policy.connectionCount, 3);
+}
+
+- (void)testPolicyNotExceedMaxConnectionCount {
+    id<JPTestParallelDownloadPolicy> policy = [self policy];
+    [policy segmentDidStart];
+    [NSThread sleepForTimeInterval:0.01];
+    for (NSUInteger i = 0; i < 4; i++) {
+        [policy segmentDidFinishWithLength:kJPTestMB];
+    }
+    XCTAssertEqual(policy.connectionCount, 2);
+}
+
+
+#pragma mark - Download
+
+- (void)testSegmentsStoredOutOfOrder {
+    JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+    [self downloadRange:NSMakeRange(0, kJPTestFileLength) segmentCount:4 toCacheFile:cacheFile];
+
+    XCTAssertEqual([JPVideoPlayerTestURLProtocol requestCount], 4);
+    XCTAssertGreaterThan([JPVideoPlayerTestURLProtocol maxConcurrentConnectionCount], 1);
+    XCTAssertTrue(cacheFile.isCompleted);
+    XCTAssertEqualObjects([cacheFile dataWithRange:NSMakeRange(0, kJPTestFileLength)],
+                          [self videoDataInRange:NSMakeRange(0, kJPTestFileLength)]);
+}
+
+
+#pragma mark - Benchmark
+
+- (void)measureDownloadWithSegmentCount:(NSUInteger)segmentCount {
+    [self measureBlock:^{
+        @autoreleasepool {
+            JPVideoPlayerCacheFile *cacheFile = [self cacheFileWithFileLength:kJPTestFileLength];
+            [self downloadRange:NSMakeRange(0, kJPTestFileLength) segmentCount:segmentCount toCacheFile:cacheFile];
+            XCTAssertTrue(cacheFile.isCompleted);
+            [cacheFile removeCache];
+        }
+    }];
+}
+
+- (void)testSingleConnectionThroughput {
+    [self measureDownloadWithSegmentCount:1];
+}
+
+- (void)testFourConnectionsThroughput {
+    [self measureDownloadWithSegmentCount:4];
+}
+
+@end
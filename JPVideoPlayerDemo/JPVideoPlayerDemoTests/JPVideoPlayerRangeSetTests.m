@@ -0,0 +1,274 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import <XCTest/XCTest.h>
+#import "JPVideoPlayerRangeSet.h"
+#import "JPVideoPlayerCompat.h"
+
+@interface JPVideoPlayerRangeSetTests : XCTestCase
+
+@end
+
+/**
+ * A set of `count` disjoint ranges, the range at index i is [i * 16, i * 16 + 8).
+ */
+static JPVideoPlayerRangeSet *JPRangeSetWithRangeCount(NSUInteger count) {
+    JPVideoPlayerRangeSet *set = [JPVideoPlayerRangeSet new];
+    for (NSUInteger i = 0; i < count; i++) {
+        [set addRange:NSMakeRange(i * 16, 8)];
+    }
+    return set;
+}
+
+/**
+ * A linear congruential generator, the benchmarks use the same positions every run.
+ */
+static NSUInteger JPNextRandom(uint64_t *seed, NSUInteger bound) {
+    *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (NSUInteger)((*seed >> 33) % bound);
+}
+
+@implementation JPVideoPlayerRangeSetTests
+
+- (void)assertRangeSet:(JPVideoPlayerRangeSet *)set
+          equalsRanges:(NSArray<NSValue *> *)ranges {
+    XCTAssertEqualObjects(set.ranges, ranges);
+    XCTAssertEqual(set.count, ranges.count);
+    XCTAssertEqual(set.upperBound, ranges.count ? NSMaxRange(ranges.lastObject.rangeValue) : 0);
+}
+
+
+#pragma mark - Add
+
+- (void)testAddRangeKeepRangesSorted {
+    JPVideoPlayerRangeSet *set = [JPVideoPlayerRangeSet new];
+    [set addRange:NSMakeRange(40, 10)];
+    [set addRange:NSMakeRange(0, 10)];
+    [set addRange:NSMakeRange(20, 10)];
+    [self assertRangeSet:set equalsRanges:@[[NSValue valueWithRange:NSMakeRange(0, 10)],
+                                            [NSValue valueWithRange:NSMakeRange(20, 10)],
+                                            [NSValue valueWithRange:NSMakeRange(40, 10)]]];
+}
+
+- (void)testAddRangeMergeOverlappingAndAdjacentRanges {
+    JPVideoPlayerRangeSet *set = [JPVideoPlayerRangeSet new];
+    [set addRange:NSMakeRange(0, 10)];
+    [set addRange:NSMakeRange(10, 10)];
+    [self assertRangeSet:set equalsRanges:@[[NSValue valueWithRange:NSMakeRange(0, 20)]]];
+
+    [set addRange:NSMakeRange(30, 10)];
+    [set addRange:NSMakeRange(50, 10)];
+    [set addRange:NSMakeRange(15, 40)];
+    [self assertRangeSet:set equalsRanges:@[[NSValue valueWithRange:NSMakeRange(0, 60)]]];
+}
+
+- (void)testAddRangeInsideExistingRange {
+    JPVideoPlayerRangeSet *set = [JPVideoPlayerRangeSet rangeSetWithRange:NSMakeRange(0, 100)];
+    [set addRange:NSMakeRange(10, 10)];
+    [self assertRangeSet:set equalsRanges:@[[NSValue valueWithRange:NSMakeRange(0, 100)]]];
+}
+
+- (void)testAddInvalidRange {
+    JPVideoPlayerRangeSet *set = [JPVideoPlayerRangeSet new];
+    [set addRange:NSMakeRange(10, 0)];
+    [set addRange:JPInvalidRange];
+    [set addRange:NSMakeRange(0, NSUIntegerMax)];
+    [self assertRangeSet:set equalsRanges:@[]];
+}
+
+
+#pragma mark - Remove
+
+- (void)testRemoveRangeCutRanges {
+    JPVideoPlayerRangeSet *set = [JPVideoPlayerRangeSet rangeSetWithRange:NSMakeRange(0, 100)];
+    [set removeRange:NSMakeRange(40, 20)];
+    [self assertRangeSet:set equalsRanges:@[[NSValue valueWithRange:NSMakeRange(0, 40)],
+                                            [NSValue valueWithRange:NSMakeRange(60, 40)]]];
+
+    [set removeRange:NSMakeRange(30, 40)];
+    [self assertRangeSet:set equalsRanges:@[[NSValue valueWithRange:NSMakeRange(0, 30)],
+                                            [NSValue valueWithRange:NSMakeRange(70, 30)]]];
+
+    [set removeRange:NSMakeRange(0, 200)];
+    [self assertRangeSet:set equalsRanges:@[]];
+}
+
+- (void)testRemoveRangeNotInSet {
+    JPVideoPlayerRangeSet *set = [JPVideoPlayerRangeSet rangeSetWithRange:NSMakeRange(10, 10)];
+    [set removeRange:NSMakeRange(0, 10)];
+    [set removeRange:NSMakeRange(20, 10)];
+    [self assertRangeSet:set equalsRanges:@[[NSValue valueWithRange:NSMakeRange(10, 10)]]];
+}
+
+- (void)testRemoveAllRanges {
+    JPVideoPlayerRangeSet *set = JPRangeSetWithRangeCount(10);
+    [set removeAllRanges];
+    [self assertRangeSet:set equalsRanges:@[]];
+    [set addRange:NSMakeRange(5, 5)];
+    [self assertRangeSet:set equalsRanges:@[[NSValue valueWithRange:NSMakeRange(5, 5)]]];
+}
+
+
+#pragma mark - Lookup
+
+- (void)testRangeContainsPosition {
+    JPVideoPlayerRangeSet *set = JPRangeSetWithRangeCount(4);
+    XCTAssertTrue(NSEqualRanges([set rangeContainsPosition:0], NSMakeRange(0, 8)));
+    XCTAssertTrue(NSEqualRanges([set rangeContainsPosition:7], NSMakeRange(0, 8)));
+    XCTAssertTrue(NSEqualRanges([set rangeContainsPosition:8], JPInvalidRange));
+    XCTAssertTrue(NSEqualRanges([set rangeContainsPosition:50], NSMakeRange(48, 8)));
+    XCTAssertTrue(NSEqualRanges([set rangeContainsPosition:1000], JPInvalidRange));
+}
+
+- (void)testFirstGapFromPosition {
+    JPVideoPlayerRangeSet *set = JPRangeSetWithRangeCount(2);
+    XCTAssertTrue(NSEqualRanges([set firstGapFromPosition:0 upperBound:100], NSMakeRange(8, 8)));
+    XCTAssertTrue(NSEqualRanges([set firstGapFromPosition:10 upperBound:100], NSMakeRange(10, 6)));
+    XCTAssertTrue(NSEqualRanges([set firstGapFromPosition:16 upperBound:100], NSMakeRange(24, 76)));
+    XCTAssertTrue(NSEqualRanges([set firstGapFromPosition:0 upperBound:12], NSMakeRange(8, 4)));
+    XCTAssertTrue(NSEqualRanges([set firstGapFromPosition:0 upperBound:8], JPInvalidRange));
+    XCTAssertTrue(NSEqualRanges([[JPVideoPlayerRangeSet new] firstGapFromPosition:5 upperBound:10], NSMakeRange(5, 5)));
+}
+
+
+#pragma mark - Algebra
+
+- (void)testUnionRangeSet {
+    JPVideoPlayerRangeSet *set = JPRangeSetWithRangeCount(2);
+    JPVideoPlayerRangeSet *other = [JPVideoPlayerRangeSet rangeSetWithRange:NSMakeRange(4, 8)];
+    [other addRange:NSMakeRange(24, 6)];
+    [set unionRangeSet:other];
+    [self assertRangeSet:set equalsRanges:@[[NSValue valueWithRange:NSMakeRange(0, 12)],
+                                            [NSValue valueWithRange:NSMakeRange(16, 14)]]];
+}
+
+- (void)testIntersectRangeSet {
+    JPVideoPlayerRangeSet *set = JPRangeSetWithRangeCount(3);
+    [set intersectRangeSet:[JPVideoPlayerRangeSet rangeSetWithRange:NSMakeRange(4, 16)]];
+    [self assertRangeSet:set equalsRanges:@[[NSValue valueWithRange:NSMakeRange(4, 4)],
+                                            [NSValue valueWithRange:NSMakeRange(16, 4)]]];
+
+    [set intersectRangeSet:[JPVideoPlayerRangeSet new]];
+    [self assertRangeSet:set equalsRanges:@[]];
+}
+
+- (void)testSubtractRangeSet {
+    JPVideoPlayerRangeSet *set = [JPVideoPlayerRangeSet rangeSetWithRange:NSMakeRange(0, 40)];
+    [set subtractRangeSet:JPRangeSetWithRangeCount(2)];
+    [self assertRangeSet:set equalsRanges:@[[NSValue valueWithRange:NSMakeRange(8, 8)],
+                                            [NSValue valueWithRange:NSMakeRange(24, 16)]]];
+}
+
+- (void)testRangeSetInRange {
+    JPVideoPlayerRangeSet *set = JPRangeSetWithRangeCount(4);
+    [self assertRangeSet:[set rangeSetInRange:NSMakeRange(4, 16)]
+            equalsRanges:@[[NSValue valueWithRange:NSMakeRange(4, 4)],
+                           [NSValue valueWithRange:NSMakeRange(16, 4)]]];
+    [self assertRangeSet:[set rangeSetInRange:NSMakeRange(8, 8)] equalsRanges:@[]];
+    // the set itself is not changed.
+    XCTAssertEqual(set.count, 4);
+}
+
+- (void)testComplementRangeSetInRange {
+    JPVideoPlayerRangeSet *set = JPRangeSetWithRangeCount(2);
+    [self assertRangeSet:[set complementRangeSetInRange:NSMakeRange(0, 40)]
+            equalsRanges:@[[NSValue valueWithRange:NSMakeRange(8, 8)],
+                           [NSValue valueWithRange:NSMakeRange(24, 16)]]];
+    [self assertRangeSet:[set complementRangeSetInRange:NSMakeRange(2, 4)] equalsRanges:@[]];
+    [self assertRangeSet:[[JPVideoPlayerRangeSet new] complementRangeSetInRange:NSMakeRange(2, 4)]
+            equalsRanges:@[[NSValue valueWithRange:NSMakeRange(2, 4)]]];
+}
+
+- (void)testCopyIsIndependent {
+    JPVideoPlayerRangeSet *set = JPRangeSetWithRangeCount(2);
+    JPVideoPlayerRangeSet *copy = [set copy];
+    [set addRange:NSMakeRange(0, 100)];
+    [self assertRangeSet:copy equalsRanges:@[[NSValue valueWithRange:NSMakeRange(0, 8)],
+                                             [NSValue valueWithRange:NSMakeRange(16, 8)]]];
+}
+
+- (void)testRandomOperationsMatchIndexSet {
+    // `NSMutableIndexSet` is the reference model of the same algebra.
+    uint64_t seed = 1;
+    JPVideoPlayerRangeSet *set = [JPVideoPlayerRangeSet new];
+    NSMutableIndexSet *model = [NSMutableIndexSet indexSet];
+    for (NSUInteger i = 0; i < 2000; i++) {
+        NSRange range = NSMakeRange(JPNextRandom(&seed, 4000), JPNextRandom(&seed, 64) + 1);
+        if (JPNextRandom(&seed, 3) == 0) {
+            [set removeRange:range];
+            [model removeIndexesInRange:range];
+        }
+        else {
+            [set addRange:range];
+            [model addIndexesInRange:range];
+        }
+    }
+
+    NSMutableArray<NSValue *> *ranges = [NSMutableArray array];
+    [model enumerateRangesUsingBlock:^(NSRange range, BOOL *stop) {
+        [ranges addObject:[NSValue valueWithRange:range]];
+    }];
+    [self assertRangeSet:set equalsRanges:ranges];
+}
+
+
+#pragma mark - Benchmark
+
+- (void)measureLookupWithRangeCount:(NSUInteger)count {
+    JPVideoPlayerRangeSet *set = JPRangeSetWithRangeCount(count);
+    [self measureBlock:^{
+        uint64_t seed = 1;
+        NSUInteger found = 0;
+        for (NSUInteger i = 0; i < 100000; i++) {
+            found += JPValidFileRange([set rangeContainsPosition:JPNextRandom(&seed, count * 16)]);
+        }
+        XCTAssertGreaterThan(found, 0);
+    }];
+}
+
+- (void)measureInsertWithRangeCount:(NSUInteger)count {
+    JPVideoPlayerRangeSet *set = JPRangeSetWithRangeCount(count);
+    [self measureBlock:^{
+        JPVideoPlayerRangeSet *copy = [set copy];
+        uint64_t seed = 1;
+        // fill the gaps at random, every insert merge with the neighbours.
+        for (NSUInteger i = 0; i < 1000; i++) {
+            [copy addRange:NSMakeRange(JPNextRandom(&seed, count) * 16 + 8, 8)];
+        }
+        XCTAssertLessThanOrEqual(copy.count, count);
+    }];
+}
+
+- (void)testLookupPerformanceWith10Ranges {
+    [self measureLookupWithRangeCount:10];
+}
+
+- (void)testLookupPerformanceWith1000Ranges {
+    [self measureLookupWithRangeCount:1000];
+}
+
+- (void)testLookupPerformanceWith100000Ranges {
+    [self measureLookupWithRangeCount:100000];
+}
+
+- (void)testInsertPerformanceWith10Ranges {
+    [self measureInsertWithRangeCount:10];
+}
+
+- (void)testInsertPerformanceWith1000Ranges {
+    [self measureInsertWithRangeCount:1000];
+}
+
+- (void)testInsertPerformanceWith100000Ranges {
+    [self measureInsertWithRangeCount:100000];
+}
+
+@end
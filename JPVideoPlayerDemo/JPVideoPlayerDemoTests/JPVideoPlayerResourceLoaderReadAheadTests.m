@@ -0,0 +1,281 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerCacheFileTestCase.h"
+#import "JPVideoPlayerTestURLProtocol.h"
+#import "JPVideoPlayerResourceLoader.h"
+#import "JPVideoPlayerDownloader.h"
+#import "JPResourceLoadingRequestTask.h"
+
+static const NSUInteger kJPTestFileLength = 8 * 1024 * 1024;
+static const NSUInteger kJPTestReadAheadLength = 1024 * 1024;
+static const NSUInteger kJPTestRequestLength = 64 * 1024;
+static const NSUInteger kJPTestBenchmarkRequestCount = 1000;
+
+/**
+ * The read-ahead methods private to `JPVideoPlayerResourceLoader`, must call them on its delegate queue.
+ */
+@interface JPVideoPlayerResourceLoader (JPTestReadAhead)
+
+- (NSUInteger)readAheadWindowLength;
+
+- (void)updateReadAheadWithRequestRange:(NSRange)dataRange;
+
+- (void)startReadAheadIfNeed;
+
+@end
+
+@interface JPVideoPlayerResourceLoaderReadAheadTests : JPVideoPlayerCacheFileTestCase<JPVideoPlayerResourceLoaderDelegate>
+
+@property (nonatomic, strong) JPVideoPlayerResourceLoader *resourceLoader;
+
+@property (nonatomic, strong) NSMutableArray<JPResourceLoadingRequestWebTask *> *requestTasks;
+
+/**
+ * The downloader the read-ahead tasks handed to, the tasks fail at once if nil.
+ */
+@property (nonatomic, strong, nullable) JPVideoPlayerDownloader *downloader;
+
+@end
+
+@implementation JPVideoPlayerResourceLoaderReadAheadTests
+
+- (void)setUp {
+    [super setUp];
+    [JPVideoPlayerTestURLProtocol reset];
+    [JPVideoPlayerTestURLProtocol setFileLength:kJPTestFileLength];
+    self.requestTasks = [NSMutableArray array];
+    // every test has its own cache file in the shared cache directory.
+    NSString *URLString = [NSString stringWithFormat:@"%@?test=%@", [JPVideoPlayerTestURLProtocol videoURL].absoluteString, [NSUUID UUID].UUIDString];
+    self.resourceLoader = [JPVideoPlayerResourceLoader resourceLoaderWithCustomURL:[NSURL URLWithString:URLString]];
+    self.resourceLoader.delegate = self;
+    self.resourceLoader.readAheadLength = kJPTestReadAheadLength;
+    self.resourceLoader.readAheadDuration = 0;
+    XCTAssertTrue([self.resourceLoader.cacheFile storeResponse:[self responseWithFileLength:kJPTestFileLength]]);
+}
+
+- (void)tearDown {
+    [self.downloader cancel];
+    self.downloader = nil;
+    [self.resourceLoader.cacheFile removeCache];
+    self.resourceLoader = nil;
+    [JPVideoPlayerTestURLProtocol reset];
+    [super tearDown];
+}
+
+/**
+ * Pretend the player requested given range and finished it, then start the read-ahead.
+ */
+- (void)finishLoadingRequestWithRange:(NSRange)range {
+    dispatch_sync(self.resourceLoader.delegateQueue, ^{
+        [self.resourceLoader updateReadAheadWithRequestRange:range];
+        [self.resourceLoader startReadAheadIfNeed];
+    });
+}
+
+- (NSArray<JPResourceLoadingRequestWebTask *> *)capturedRequestTasks {
+    // the tasks are captured on the delegate queue.
+    __block NSArray<JPResourceLoadingRequestWebTask *> *requestTasks = nil;
+    dispatch_sync(self.resourceLoader.delegateQueue, ^{
+        requestTasks = [self.requestTasks copy];
+    });
+    return requestTasks;
+}
+
+
+#pragma mark - JPVideoPlayerResourceLoaderDelegate
+
+- (void)resourceLoader:(JPVideoPlayerResourceLoader *)resourceLoader
+didReceiveLoadingRequestTask:(JPResourceLoadingRequestWebTask *)requestTask {
+    [self.requestTasks addObject:requestTask];
+    if (self.downloader) {
+        [self.downloader downloadVideoWithRequestTask:requestTask downloadOptions:0];
+    }
+}
+
+
+#pragma mark - Window
+
+- (void)testReadAheadWindowByLength {
+    [self finishLoadingRequestWithRange:NSMakeRange(0, kJPTestRequestLength)];
+
+    NSArray<JPResourceLoadingRequestWebTask *> *requestTasks = [self capturedRequestTasks];
+    XCTAssertEqual(requestTasks.count, 1);
+    JPResourceLoadingRequestWebTask *requestTask = requestTasks.firstObject;
+    XCTAssertTrue(NSEqualRanges(requestTask.requestRange, NSMakeRange(kJPTestRequestLength, kJPTestReadAheadLength)));
+    XCTAssertNil(requestTask.loadingRequest);
+    XCTAssertTrue(requestTask.isInternal);
+    XCTAssertEqual(requestTask.downloadPriority, JPVideoPlayerDownloadPriorityReadAhead);
+}
+
+- (void)testReadAheadWindowByDuration {
+    self.resourceLoader.readAheadLength = 0;
+    self.resourceLoader.readAheadDuration = 2;
+    self.resourceLoader.videoDuration = 8;
+    // 8 MB in 8 seconds, 2 seconds is 2 MB.
+    XCTAssertEqual([self.resourceLoader readAheadWindowLength], 2 * 1024 * 1024);
+
+    // the larger one of the two windows win.
+    self.resourceLoader.readAheadLength = 4 * 1024 * 1024;
+    XCTAssertEqual([self.resourceLoader readAheadWindowLength], 4 * 1024 * 1024);
+}
+
+- (void)testReadAheadWindowClampedToEndOfFile {
+    [self finishLoadingRequestWithRange:NSMakeRange(kJPTestFileLength - kJPTestRequestLength * 2, kJPTestRequestLength)];
+    XCTAssertTrue(NSEqualRanges([self capturedRequestTasks].firstObject.requestRange,
+                                NSMakeRange(kJPTestFileLength - kJPTestRequestLength, kJPTestRequestLength)));
+}
+
+- (void)testReadAheadSkipCachedData {
+    [self storeVideoDataInRange:NSMakeRange(kJPTestRequestLength, kJPTestReadAheadLength / 2)
+                    toCacheFile:self.resourceLoader.cacheFile
+                    synchronize:YES];
+    [self finishLoadingRequestWithRange:NSMakeRange(0, kJPTestRequestLength)];
+
+    // only the first gap in the window.
+    XCTAssertTrue(NSEqualRanges([self capturedRequestTasks].firstObject.requestRange,
+                                NSMakeRange(kJPTestRequestLength + kJPTestReadAheadLength / 2, kJPTestReadAheadLength / 2)));
+}
+
+
+#pragma mark - Stop
+
+- (void)testNoReadAheadWhenWindowCached {
+    [self storeVideoDataInRange:NSMakeRange(kJPTestRequestLength, kJPTestReadAheadLength)
+                    toCacheFile:self.resourceLoader.cacheFile
+                    synchronize:YES];
+    [self finishLoadingRequestWithRange:NSMakeRange(0, kJPTestRequestLength)];
+    XCTAssertEqual([self capturedRequestTasks].count, 0);
+}
+
+- (void)testNoReadAheadWhenCompleted {
+    [self storeVideoDataInRange:NSMakeRange(0, kJPTestFileLength)
+                    toCacheFile:self.resourceLoader.cacheFile
+                    synchronize:YES];
+    XCTAssertTrue(self.resourceLoader.cacheFile.isCompleted);
+    [self finishLoadingRequestWithRange:NSMakeRange(0, kJPTestRequestLength)];
+    XCTAssertEqual([self capturedRequestTasks].count, 0);
+}
+
+- (void)testNoReadAheadAtEndOfFile {
+    [self finishLoadingRequestWithRange:NSMakeRange(kJPTestFileLength - kJPTestRequestLength, kJPTestRequestLength)];
+    XCTAssertEqual([self capturedRequestTasks].count, 0);
+}
+
+- (void)testNoReadAheadWhilePaused {
+    self.resourceLoader.readAheadPaused = YES;
+    [self finishLoadingRequestWithRange:NSMakeRange(0, kJPTestRequestLength)];
+    XCTAssertEqual([self capturedRequestTasks].count, 0);
+
+    // resume start the read-ahead of the window at once.
+    self.resourceLoader.readAheadPaused = NO;
+    XCTAssertEqual([self capturedRequestTasks].count, 1);
+}
+
+- (void)testReadAheadCancelledWhenPlayerReadToEnd {
+    // slow enough to keep the read-ahead downloading.
+    [JPVideoPlayerTestURLProtocol setBytesPerSecondPerConnection:64 * 1024];
+    self.downloader = [[JPVideoPlayerDownloader alloc] initWithSessionConfiguration:[JPVideoPlayerTestURLProtocol sessionConfiguration]];
+    [self finishLoadingRequestWithRange:NSMakeRange(0, kJPTestRequestLength)];
+    JPResourceLoadingRequestWebTask *readAheadTask = [self capturedRequestTasks].firstObject;
+    XCTAssertNotNil(readAheadTask);
+    XCTAssertFalse(readAheadTask.isCancelled);
+
+    // the player read from inside the window to the end of file, it download the window by itself.
+    dispatch_sync(self.resourceLoader.delegateQueue, ^{
+        [self.resourceLoader updateReadAheadWithRequestRange:NSMakeRange(kJPTestRequestLength * 2, kJPTestFileLength - kJPTestRequestLength * 2)];
+    });
+    XCTAssertTrue(readAheadTask.isCancelled);
+}
+
+
+#pragma mark - Download
+
+- (void)testReadAheadFillWindowFromWeb {
+    [JPVideoPlayerTestURLProtocol setBytesPerSecondPerConnection:4 * 1024 * 1024];
+    self.downloader = [[JPVideoPlayerDownloader alloc] initWithSessionConfiguration:[JPVideoPlayerTestURLProtocol sessionConfiguration]];
+    JPVideoPlayerCacheFile *cacheFile = self.resourceLoader.cacheFile;
+    NSRange windowRange = NSMakeRange(kJPTestRequestLength, kJPTestReadAheadLength);
+    [self expectationForPredicate:[NSPredicate predicateWithBlock:^BOOL(id object, NSDictionary *bindings) {
+        return [cacheFile missingRangesInRange:windowRange].count == 0;
+    }]
+              evaluatedWithObject:cacheFile
+                          handler:nil];
+    [self finishLoadingRequestWithRange:NSMakeRange(0, kJPTestRequestLength)];
+    [self waitForExpectationsWithTimeout:30 handler:nil];
+
+    // the next requests of the player in the window are served from cache, no rebuffer waiting for web.
+    XCTAssertEqual([JPVideoPlayerTestURLProtocol requestCount], 1);
+    XCTAssertEqualObjects([cacheFile dataWithRange:windowRange], [self videoDataInRange:windowRange]);
+}
+
+
+
+#pragma mark - Benchmark
+
+/**
+ * Store every other request length of video data, the cache file look like the one of a video seeked around.
+ */
+- (void)fragmentCacheFile {
+    for (NSUInteger offset = 0; offset < kJPTestFileLength; offset += kJPTestRequestLength * 2) {
+        [self storeVideoDataInRange:NSMakeRange(offset, kJPTestRequestLength)
+                        toCacheFile:self.resourceLoader.cacheFile
+                        synchronize:NO];
+    }
+    [self.resourceLoader.cacheFile synchronize];
+}
+
+/**
+ * The bookkeeping of a loading request, plan the requested range from cache and move the read-ahead window.
+ */
+- (void)handleRequestAtIndex:(NSUInteger)index {
+    NSUInteger location = (index * kJPTestRequestLength) % (kJPTestFileLength - kJPTestReadAheadLength);
+    [self.resourceLoader.cacheFile missingRangesInRange:NSMakeRange(location, kJPTestReadAheadLength)];
+    [self.resourceLoader updateReadAheadWithRequestRange:NSMakeRange(location, kJPTestRequestLength)];
+}
+
+/**
+ * The main queue time of the loading requests handled on main queue, the way before the loader has its own queue.
+ * Compare with `testMainQueueTimeOffMainPerformance`, the difference is the frame time the scrolling get back.
+ */
+- (void)testMainQueueTimeOnMainPerformance {
+    [self fragmentCacheFile];
+    [self measureMetrics:@[XCTPerformanceMetric_WallClockTime] automaticallyStartMeasuring:NO forBlock:^{
+        [self startMeasuring];
+        for (NSUInteger i = 0; i < kJPTestBenchmarkRequestCount; i++) {
+            // main queue wait for the work, the same as doing it on main queue.
+            dispatch_sync(self.resourceLoader.delegateQueue, ^{
+                [self handleRequestAtIndex:i];
+            });
+        }
+        [self stopMeasuring];
+    }];
+}
+
+/**
+ * The main queue time of the loading requests handled on the delegate queue of loader.
+ */
+- (void)testMainQueueTimeOffMainPerformance {
+    [self fragmentCacheFile];
+    [self measureMetrics:@[XCTPerformanceMetric_WallClockTime] automaticallyStartMeasuring:NO forBlock:^{
+        [self startMeasuring];
+        for (NSUInteger i = 0; i < kJPTestBenchmarkRequestCount; i++) {
+            dispatch_async(self.resourceLoader.delegateQueue, ^{
+                [self handleRequestAtIndex:i];
+            });
+        }
+        [self stopMeasuring];
+        // drain the queue out of the measuring.
+        dispatch_sync(self.resourceLoader.delegateQueue, ^{});
+    }];
+}
+
+@end
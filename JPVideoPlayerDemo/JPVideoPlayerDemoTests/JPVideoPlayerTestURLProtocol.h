@@ -0,0 +1,66 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A local stand-in of a range capable HTTP server, it serve the video at `videoURL` to the sessions
+ * created with `sessionConfiguration`, the bytes are the same as `JPVideoPlayerTestVideoData`.
+ * Every connection is throttled apart, like a single TCP stream to a high latency CDN.
+ */
+@interface JPVideoPlayerTestURLProtocol : NSURLProtocol
+
+/**
+ * The URL of the video served.
+ */
++ (NSURL *)videoURL;
+
+/**
+ * Set the length of the video served [defaults to 4 MB].
+ *
+ * @param fileLength The length of video.
+ */
++ (void)setFileLength:(NSUInteger)fileLength;
+
+/**
+ * Set the bytes sent by one connection per second, 0 for no limit [defaults to 0].
+ *
+ * @param bytesPerSecond The bytes per second.
+ */
++ (void)setBytesPerSecondPerConnection:(NSUInteger)bytesPerSecond;
+
+/**
+ * The number of requests received since the last reset.
+ */
++ (NSUInteger)requestCount;
+
+/**
+ * The maximum number of connections sending at the same time since the last reset.
+ */
++ (NSUInteger)maxConcurrentConnectionCount;
+
+/**
+ * Fetch a session configuration which route the requests to this stand-in.
+ *
+ * @return A session configuration.
+ */
++ (NSURLSessionConfiguration *)sessionConfiguration;
+
+/**
+ * Restore the defaults and clear the counters.
+ */
++ (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
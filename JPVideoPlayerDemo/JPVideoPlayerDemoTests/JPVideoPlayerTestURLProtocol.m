@@ -0,0 +1,209 @@
+/*
+ * This file is part of the JPVideoPlayer package.
+ * (c) NewPan <13246884282@163.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ *
+ * Click https://github.com/newyjp
+ * or http://www.jianshu.com/users/e2f2d779c022/latest_articles to contact me.
+ */
+
+#import "JPVideoPlayerTestURLProtocol.h"
+#import "JPVideoPlayerCacheFileTestCase.h"
+#import <pthread.h>
+
+static const NSUInteger kJPTestDefaultFileLength = 4 * 1024 * 1024;
+static const NSUInteger kJPTestUnlimitedChunkSize = 64 * 1024;
+static const NSTimeInterval kJPTestSendInterval = 0.01;
+
+static NSUInteger JPTestFileLength = kJPTestDefaultFileLength;
+static NSUInteger JPTestBytesPerSecondPerConnection = 0;
+static NSUInteger JPTestRequestCount = 0;
+static NSUInteger JPTestConnectionCount = 0;
+static NSUInteger JPTestMaxConcurrentConnectionCount = 0;
+static pthread_mutex_t JPTestLock = PTHREAD_MUTEX_INITIALIZER;
+
+@interface JPVideoPlayerTestURLProtocol()
+
+@property (nonatomic, assign) NSRange sendRange;
+
+@property (nonatomic, assign) NSUInteger sentLength;
+
+@property (nonatomic, assign) NSUInteger chunkSize;
+
+@property (nonatomic, strong, nullable) NSTimer *timer;
+
+@end
+
+@implementation JPVideoPlayerTestURLProtocol
+
++ (NSURL *)videoURL {
+    return [NSURL URLWithString:@"http://stand-in.jpvideoplayer.test/video.mp4"];
+}
+
++ (NSUInteger)fileLength {
+    pthread_mutex_lock(&JPTestLock);
+    NSUInteger fileLength = JPTestFileLength;
+    pthread_mutex_unlock(&JPTestLock);
+    return fileLength;
+}
+
++ (void)setFileLength:(NSUInteger)fileLength {
+    pthread_mutex_lock(&JPTestLock);
+    JPTestFileLength = fileLength;
+    pthread_mutex_unlock(&JPTestLock);
+}
+
++ (NSUInteger)bytesPerSecondPerConnection {
+    pthread_mutex_lock(&JPTestLock);
+    NSUInteger bytesPerSecond = JPTestBytesPerSecondPerConnection;
+    pthread_mutex_unlock(&JPTestLock);
+    return bytesPerSecond;
+}
+
++ (void)setBytesPerSecondPerConnection:(NSUInteger)bytesPerSecond {
+    pthread_mutex_lock(&JPTestLock);
+    JPTestBytesPerSecondPerConnection = bytesPerSecond;
+    pthread_mutex_unlock(&JPTestLock);
+}
+
++ (NSUInteger)requestCount {
+    pthread_mutex_lock(&JPTestLock);
+    NSUInteger requestCount = JPTestRequestCount;
+    pthread_mutex_unlock(&JPTestLock);
+    return requestCount;
+}
+
++ (NSUInteger)maxConcurrentConnectionCount {
+    pthread_mutex_lock(&JPTestLock);
+    NSUInteger count = JPTestMaxConcurrentConnectionCount;
+    pthread_mutex_unlock(&JPTestLock);
+    return count;
+}
+
++ (NSURLSessionConfiguration *)sessionConfiguration {
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    configuration.protocolClasses = @[[JPVideoPlayerTestURLProtocol class]];
+    // the throttled connections are the bottleneck under test, not the connection limit of session.
+    configuration.HTTPMaximumConnectionsPerHost = 16;
+    return configuration;
+}
+
++ (void)reset {
+    pthread_mutex_lock(&JPTestLock);
+    JPTestFileLength = kJPTestDefaultFileLength;
+    JPTestBytesPerSecondPerConnection = 0;
+    JPTestRequestCount = 0;
+    JPTestMaxConcurrentConnectionCount = 0;
+    pthread_mutex_unlock(&JPTestLock);
+}
+
+
+#pragma mark - NSURLProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+    return [request.URL.host isEqualToString:[self videoURL].host];
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+    return request;
+}
+
+- (void)startLoading {
+    NSUInteger fileLength = [JPVideoPlayerTestURLProtocol fileLength];
+    NSUInteger bytesPerSecond = [JPVideoPlayerTestURLProtocol bytesPerSecondPerConnection];
+    NSString *rangeValue = [self.request valueForHTTPHeaderField:@"Range"];
+    NSRange range = NSMakeRange(0, fileLength);
+    BOOL isRangeRequest = [self parseRangeValue:rangeValue fileLength:fileLength range:&range];
+
+    NSMutableDictionary *headers = [@{
+            @"Content-Type" : @"video/mp4",
+            @"Content-Length" : [NSString stringWithFormat:@"%tu", range.length],
+            @"Accept-Ranges" : @"bytes",
+    } mutableCopy];
+    if (isRangeRequest) {
+        headers[@"Content-Range"] = [NSString stringWithFormat:@"bytes %tu-%tu/%tu", range.location, NSMaxRange(range) - 1, fileLength];
+    }
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.request.URL
+                                                              statusCode:isRangeRequest ? 206 : 200
+                                                             HTTPVersion:@"HTTP/1.1"
+                                                            headerFields:headers];
+    pthread_mutex_lock(&JPTestLock);
+    JPTestRequestCount += 1;
+    JPTestConnectionCount += 1;
+    JPTestMaxConcurrentConnectionCount = MAX(JPTestMaxConcurrentConnectionCount, JPTestConnectionCount);
+    pthread_mutex_unlock(&JPTestLock);
+
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    self.sendRange = range;
+    self.sentLength = 0;
+    self.chunkSize = bytesPerSecond ? MAX((NSUInteger)(bytesPerSecond * kJPTestSendInterval), 1) : kJPTestUnlimitedChunkSize;
+    // the client must be called on the thread of `startLoading`, send on the run loop of it.
+    self.timer = [NSTimer timerWithTimeInterval:kJPTestSendInterval
+                                         target:self
+                                       selector:@selector(sendNextChunk)
+                                       userInfo:nil
+                                        repeats:YES];
+    NSRunLoop *runLoop = [NSRunLoop currentRunLoop];
+    [runLoop addTimer:self.timer forMode:NSDefaultRunLoopMode];
+    if (runLoop.currentMode && ![runLoop.currentMode isEqualToString:NSDefaultRunLoopMode]) {
+        [runLoop addTimer:self.timer forMode:runLoop.currentMode];
+    }
+}
+
+- (void)stopLoading {
+    if (!self.timer) {
+        return;
+    }
+
+    [self.timer invalidate];
+    self.timer = nil;
+    pthread_mutex_lock(&JPTestLock);
+    JPTestConnectionCount -= 1;
+    pthread_mutex_unlock(&JPTestLock);
+}
+
+
+#pragma mark - Private
+
+- (void)sendNextChunk {
+    NSUInteger length = MIN(self.chunkSize, self.sendRange.length - self.sentLength);
+    if (length) {
+        NSRange chunkRange = NSMakeRange(self.sendRange.location + self.sentLength, length);
+        [self.client URLProtocol:self didLoadData:JPVideoPlayerTestVideoData(chunkRange)];
+        self.sentLength += length;
+    }
+    if (self.sentLength >= self.sendRange.length) {
+        [self stopLoading];
+        [self.client URLProtocolDidFinishLoading:self];
+    }
+}
+
+/**
+ * Parse a single range of the form `bytes=a-b` or `bytes=a-`.
+ *
+ * @return NO if no valid range, the whole file is sent.
+ */
+- (BOOL)parseRangeValue:(NSString *)rangeValue
+             fileLength:(NSUInteger)fileLength
+                  range:(NSRange *)range {
+    if (![rangeValue hasPrefix:@"bytes="]) {
+        return NO;
+    }
+
+    NSArray<NSString *> *components = [[rangeValue substringFromIndex:6] componentsSeparatedByString:@"-"];
+    if (components.count != 2 || !components[0].length) {
+        return NO;
+    }
+    unsigned long long start = strtoull(components[0].UTF8String, NULL, 10);
+    unsigned long long end = components[1].length ? strtoull(components[1].UTF8String, NULL, 10) : fileLength - 1;
+    end = MIN(end, fileLength - 1);
+    if (start > end) {
+        return NO;
+    }
+    *range = NSMakeRange((NSUInteger)start, (NSUInteger)(end - start + 1));
+    return YES;
+}
+
+@end